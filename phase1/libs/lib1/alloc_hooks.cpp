@@ -0,0 +1,81 @@
+// Replacement global operator new/delete that feed alloc_stats.
+//
+// Linked into myLib1 when configured with -DHD_COUNT_ALLOCATIONS=ON, and
+// always into the unit tests. Must not be linked twice into one binary.
+
+#include "alloc_stats.hpp"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+void* countedAlloc(std::size_t size) {
+  if (size == 0) size = 1;
+  for (;;) {
+    if (void* p = std::malloc(size)) {
+      alloc_stats::detail::onAllocate(size);
+      return p;
+    }
+    std::new_handler h = std::get_new_handler();
+    if (!h) throw std::bad_alloc();
+    h();
+  }
+}
+
+void* countedAlignedAlloc(std::size_t size, std::align_val_t al) {
+  const std::size_t a = static_cast<std::size_t>(al);
+  // aligned_alloc wants a size that is a multiple of the alignment.
+  const std::size_t rounded = (size + a - 1) / a * a;
+  for (;;) {
+    if (void* p = std::aligned_alloc(a, rounded ? rounded : a)) {
+      alloc_stats::detail::onAllocate(size);
+      return p;
+    }
+    std::new_handler h = std::get_new_handler();
+    if (!h) throw std::bad_alloc();
+    h();
+  }
+}
+
+void countedFree(void* p) noexcept {
+  if (!p) return;
+  alloc_stats::detail::onDeallocate();
+  std::free(p);
+}
+
+struct MarkEnabled {
+  MarkEnabled() { alloc_stats::detail::markEnabled(); }
+} mark_enabled;
+
+}  // namespace
+
+void* operator new(std::size_t n) { return countedAlloc(n); }
+void* operator new[](std::size_t n) { return countedAlloc(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+  try { return countedAlloc(n); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+  try { return countedAlloc(n); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t n, std::align_val_t al) { return countedAlignedAlloc(n, al); }
+void* operator new[](std::size_t n, std::align_val_t al) { return countedAlignedAlloc(n, al); }
+void* operator new(std::size_t n, std::align_val_t al, const std::nothrow_t&) noexcept {
+  try { return countedAlignedAlloc(n, al); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t n, std::align_val_t al, const std::nothrow_t&) noexcept {
+  try { return countedAlignedAlloc(n, al); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { countedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { countedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { countedFree(p); }
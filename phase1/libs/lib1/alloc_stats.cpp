@@ -0,0 +1,60 @@
+#include "alloc_stats.hpp"
+
+#include <atomic>
+
+namespace alloc_stats {
+
+namespace {
+
+// Constant-initialized, so touching it from inside operator new is safe even
+// while a thread is still starting up.
+thread_local Counters tls_counters{};
+std::atomic<std::uint64_t> process_allocations{0};
+std::atomic<std::uint64_t> process_deallocations{0};
+std::atomic<std::uint64_t> process_bytes{0};
+std::atomic<bool> hooks_enabled{false};
+
+}  // namespace
+
+bool enabled() { return hooks_enabled.load(std::memory_order_relaxed); }
+
+Counters thisThread() { return tls_counters; }
+
+Counters process() {
+  return {process_allocations.load(std::memory_order_relaxed),
+          process_deallocations.load(std::memory_order_relaxed),
+          process_bytes.load(std::memory_order_relaxed)};
+}
+
+Scope::Scope(Threads which) : which_(which), start_(now()) {}
+
+void Scope::restart() { start_ = now(); }
+
+Counters Scope::now() const { return which_ == Threads::All ? process() : thisThread(); }
+
+Counters Scope::delta() const {
+  const Counters n = now();
+  return {n.allocations - start_.allocations,
+          n.deallocations - start_.deallocations,
+          n.bytes - start_.bytes};
+}
+
+namespace detail {
+
+void onAllocate(std::size_t bytes) noexcept {
+  ++tls_counters.allocations;
+  tls_counters.bytes += bytes;
+  process_allocations.fetch_add(1, std::memory_order_relaxed);
+  process_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void onDeallocate() noexcept {
+  ++tls_counters.deallocations;
+  process_deallocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void markEnabled() noexcept { hooks_enabled.store(true, std::memory_order_relaxed); }
+
+}  // namespace detail
+
+}  // namespace alloc_stats
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @file alloc_stats.hpp
+ * @brief Debug counters of heap allocations, per thread and process-wide.
+ *
+ * @details
+ * The counters are only fed when the replacement global operator new/delete
+ * in alloc_hooks.cpp is linked into the binary: configure with
+ * -DHD_COUNT_ALLOCATIONS=ON to put it in myLib1 (the unit tests always link
+ * it). Otherwise enabled() is false and every count stays zero.
+ *
+ * Every allocation is counted twice: in thread_local counters, which never
+ * contend, and in process-wide relaxed atomics. A default Scope measures only
+ * what the calling thread allocated, so work it hands to other threads (e.g.
+ * cv::parallel_for_ workers) is invisible to it; Scope(Threads::All) sees
+ * every thread, unrelated ones included. The shared atomics add one contended
+ * increment per allocation, which is acceptable only because the hooks are a
+ * debug option.
+ *
+ * \code{.cpp}
+ *   alloc_stats::Scope frame;
+ *   process(frame_bgr);
+ *   if (frame.delta().allocations) { ... }   // something allocated this frame
+ * \endcode
+ */
+namespace alloc_stats {
+
+struct Counters {
+  std::uint64_t allocations = 0;    ///< Calls to operator new (all forms).
+  std::uint64_t deallocations = 0;  ///< Calls to operator delete on non-null pointers.
+  std::uint64_t bytes = 0;          ///< Bytes requested from operator new.
+};
+
+/** @brief Whether the counting hooks are linked in. */
+bool enabled();
+
+/** @brief Running totals for the calling thread. */
+Counters thisThread();
+
+/** @brief Running totals over every thread of the process. */
+Counters process();
+
+/**
+ * @brief Measures allocations since construction (or restart()), of the
+ *        calling thread or of the whole process.
+ */
+class Scope {
+public:
+  enum class Threads { Calling, All };
+
+  explicit Scope(Threads which = Threads::Calling);
+  void restart();
+  Counters delta() const;
+
+private:
+  Counters now() const;
+
+  Threads which_;
+  Counters start_;
+};
+
+namespace detail {
+// Called by the hooks in alloc_hooks.cpp; not for general use.
+void onAllocate(std::size_t bytes) noexcept;
+void onDeallocate() noexcept;
+void markEnabled() noexcept;
+}  // namespace detail
+
+}  // namespace alloc_stats
@@ -0,0 +1,175 @@
+#include "annotated_recorder.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+#include <opencv2/imgproc.hpp>
+
+void drawOverlay(cv::Mat& img, const Overlay& ov) {
+  if (ov.show_box) {
+    cv::rectangle(img, ov.box, cv::Scalar(0,255,255), 2);
+  }
+
+  for (const auto& p : ov.features) {
+    cv::circle(img, p, 3, cv::Scalar(0,255,0), cv::FILLED, cv::LINE_AA);
+  }
+
+  for (const auto& b : ov.people) {
+    cv::rectangle(img, b, cv::Scalar(255,0,255), 2);
+  }
+
+  for (const auto& r : ov.rois) {
+    cv::rectangle(img, r, cv::Scalar(255,128,0), 1);
+  }
+  for (const auto& p : ov.roi_features) {
+    cv::circle(img, p, 2, cv::Scalar(255,128,0), cv::FILLED, cv::LINE_AA);
+  }
+
+  if (ov.has_chosen) {
+    cv::circle(img, ov.chosen, 6, cv::Scalar(0,0,255), 2, cv::LINE_AA);
+  }
+
+  if (ov.hud != Overlay::Hud::None) {
+    int y = 22;
+    auto put = [&](const char* s) {
+      cv::putText(img, s, {10,y}, cv::FONT_HERSHEY_SIMPLEX, 0.6,
+                  cv::Scalar(255,255,255), 2, cv::LINE_AA);
+      y += 24;
+    };
+    if (ov.hud == Overlay::Hud::DrawBox) {
+      put("Step 1: Drag a rectangle (Left mouse). Release to finalize.");
+      put("Or press 'f' to detect features over the full frame.");
+    } else {
+      put("Step 2: Click a feature dot to select it. Press 'r' to redo box.");
+      put("(Z=fy*h/(v-cy), X=Z*(u-cx)/fx)");
+    }
+  }
+}
+
+AnnotatedRecorder::AnnotatedRecorder(const std::string& path)
+: AnnotatedRecorder(path, Params{}) {}
+
+AnnotatedRecorder::AnnotatedRecorder(const std::string& path, const Params& p)
+: path_(path), params_(p) {
+  if (params_.queue_size < 1) {
+    throw std::invalid_argument("AnnotatedRecorder: queue_size must be >= 1");
+  }
+  if (params_.fourcc.size() != 4) {
+    throw std::invalid_argument("AnnotatedRecorder: fourcc must be 4 characters");
+  }
+  // One slot more than the queue holds: the writer owns it while encoding.
+  slots_.resize(params_.queue_size + 1);
+  for (int i = static_cast<int>(slots_.size()) - 1; i >= 0; --i) free_.push_back(i);
+  filled_.reserve(slots_.size());
+  worker_ = std::thread(&AnnotatedRecorder::run, this);
+}
+
+AnnotatedRecorder::~AnnotatedRecorder() { close(); }
+
+bool AnnotatedRecorder::submit(const cv::Mat& frame, const Overlay& overlay) {
+  int slot = -1;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++stats_.submitted;
+    if (params_.policy == DropPolicy::Block) {
+      cv_.wait(lock, [&] { return !free_.empty() || stop_; });
+    }
+    if (stop_ || failed_.load(std::memory_order_relaxed)) {
+      ++stats_.dropped;
+      return false;
+    }
+    if (!free_.empty()) {
+      slot = free_.back();
+      free_.pop_back();
+    } else if (params_.policy == DropPolicy::DropOldest && !filled_.empty()) {
+      slot = filled_.front();
+      filled_.erase(filled_.begin());
+      ++stats_.dropped;
+    } else {
+      ++stats_.dropped;
+      return false;
+    }
+  }
+
+  // The slot is in neither list while it is filled, so copy without the lock.
+  frame.copyTo(slots_[slot].image);   // reuses the slot's buffer once warm
+  slots_[slot].overlay = overlay;     // vector assignment keeps capacity
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_) {
+      // close() raced with this submit; the writer may already be gone.
+      free_.push_back(slot);
+      ++stats_.dropped;
+      return false;
+    }
+    filled_.push_back(slot);
+  }
+  cv_.notify_all();
+  return true;
+}
+
+void AnnotatedRecorder::run() {
+  for (;;) {
+    int slot = -1;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&] { return !filled_.empty() || stop_; });
+      if (filled_.empty()) return;  // stopped and drained
+      slot = filled_.front();
+      filled_.erase(filled_.begin());
+    }
+
+    Slot& s = slots_[slot];
+    bool wrote = false;
+    if (!failed_.load(std::memory_order_relaxed)) {
+      if (!writer_.isOpened()) {
+        const std::string& f = params_.fourcc;
+        frame_size_ = s.image.size();
+        writer_.open(path_, cv::VideoWriter::fourcc(f[0], f[1], f[2], f[3]),
+                     params_.fps, frame_size_, s.image.channels() == 3);
+        if (!writer_.isOpened()) {
+          std::cerr << "Error: could not open " << path_ << " for recording" << std::endl;
+          failed_.store(true, std::memory_order_relaxed);
+        }
+      }
+      if (writer_.isOpened()) {
+        drawOverlay(s.image, s.overlay);
+        if (s.image.size() != frame_size_) {
+          cv::resize(s.image, resized_, frame_size_, 0, 0, cv::INTER_AREA);
+          writer_.write(resized_);
+        } else {
+          writer_.write(s.image);
+        }
+        wrote = true;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      free_.push_back(slot);
+      if (wrote) ++stats_.written;
+      else ++stats_.dropped;
+    }
+    cv_.notify_all();
+  }
+}
+
+void AnnotatedRecorder::close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (worker_.joinable()) worker_.join();
+  writer_.release();
+}
+
+bool AnnotatedRecorder::ok() const { return !failed_.load(std::memory_order_relaxed); }
+
+AnnotatedRecorder::Stats AnnotatedRecorder::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+const AnnotatedRecorder::Params& AnnotatedRecorder::params() const { return params_; }
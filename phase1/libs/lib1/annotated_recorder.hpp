@@ -0,0 +1,163 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+/**
+ * @file annotated_recorder.hpp
+ * @brief Background writer for annotated video, fed by a bounded frame queue.
+ *
+ * @details
+ * The processing thread hands over a frame plus an Overlay, a plain
+ * description of what HumanDetector::redraw() would draw (ROI, features,
+ * people, chosen point, HUD). submit() only copies both into a recycled queue
+ * slot. A dedicated thread draws the overlay with drawOverlay() and encodes
+ * the result with cv::VideoWriter, so neither drawing nor encoding runs on
+ * the hot path.
+ *
+ * When the encoder falls behind and the queue is full, Params::policy decides
+ * what happens: drop the new frame, drop the oldest queued frame, or wait.
+ * Only DropPolicy::Block can stall the caller; use it for offline runs where
+ * every frame must be kept.
+ *
+ * Typical use:
+ * \code{.cpp}
+ *   AnnotatedRecorder rec("run.avi");
+ *   hd.attachRecorder(&rec);
+ *   while (src.acquire(f)) {
+ *     hd.setFrame(*f.image);
+ *     // ... detection ...
+ *     hd.recordFrame();
+ *     src.release(f);
+ *   }
+ *   rec.close();  // drain and finalize the file
+ * \endcode
+ */
+
+/**
+ * @brief Everything drawn on top of a frame, in the frame's pixel coordinates.
+ */
+struct Overlay {
+  /// Which instruction lines the HUD shows.
+  enum class Hud {
+    None,        ///< No HUD.
+    DrawBox,     ///< Step 1 text (HumanDetector::Mode::DRAW_BOX).
+    PickFeature  ///< Step 2 text (HumanDetector::Mode::PICK_FEATURE).
+  };
+
+  std::uint64_t frame_id = 0;           ///< Source frame id (not drawn).
+  bool show_box = false;                ///< Draw @ref box.
+  cv::Rect box;                         ///< ROI being drawn or finalized.
+  std::vector<cv::Point2f> features;    ///< Detected corners.
+  std::vector<cv::Rect> people;         ///< People boxes.
+  std::vector<cv::Rect> rois;           ///< detectInRois() rectangles.
+  std::vector<cv::Point2f> roi_features;///< Corners of all @ref rois, concatenated.
+  bool has_chosen = false;              ///< Draw @ref chosen.
+  cv::Point2f chosen{};                 ///< Selected feature.
+  Hud hud = Hud::None;                  ///< HUD text to draw.
+};
+
+/**
+ * @brief Draw @p ov onto @p img (BGR) in place.
+ *
+ * @details Shared by HumanDetector::redraw() and the recorder thread, so the
+ *          window and the recorded video look the same.
+ */
+void drawOverlay(cv::Mat& img, const Overlay& ov);
+
+class AnnotatedRecorder {
+public:
+  /**
+   * @brief What submit() does when the queue is full.
+   */
+  enum class DropPolicy {
+    DropNewest,  ///< Discard the submitted frame (cheapest; keeps older frames).
+    DropOldest,  ///< Discard the oldest queued frame to make room (keeps the latest).
+    Block        ///< Wait for the writer; never drops, but can stall the caller.
+  };
+
+  struct Params {
+    int         queue_size = 8;                       ///< Frames buffered ahead of the encoder.
+    DropPolicy  policy     = DropPolicy::DropNewest;  ///< Behavior when the queue is full.
+    double      fps        = 30.0;                    ///< Frame rate written to the file.
+    std::string fourcc     = "MJPG";                  ///< Codec; must be 4 characters.
+  };
+
+  /**
+   * @brief Counters since construction.
+   */
+  struct Stats {
+    std::uint64_t submitted = 0;  ///< submit() calls.
+    std::uint64_t written   = 0;  ///< Frames handed to the encoder.
+    std::uint64_t dropped   = 0;  ///< Frames discarded by the drop policy.
+  };
+
+  /**
+   * @brief Start the writer thread; the file is opened with the first frame's size.
+   *
+   * @throws std::invalid_argument if Params::queue_size < 1 or fourcc is not 4 characters.
+   */
+  explicit AnnotatedRecorder(const std::string& path);
+  AnnotatedRecorder(const std::string& path, const Params& p);
+  ~AnnotatedRecorder();
+
+  AnnotatedRecorder(const AnnotatedRecorder&) = delete;
+  AnnotatedRecorder& operator=(const AnnotatedRecorder&) = delete;
+
+  /**
+   * @brief Queue @p frame with @p overlay for annotation and encoding.
+   *
+   * @details Copies both into a reused slot; the caller keeps ownership of
+   *          its buffers. Frames of a different size than the first are
+   *          resized on the writer thread.
+   * @return false if the frame was dropped (queue full under DropNewest,
+   *         recorder closed, or the file could not be opened).
+   */
+  bool submit(const cv::Mat& frame, const Overlay& overlay);
+
+  /**
+   * @brief Encode everything still queued, then stop the thread and close the file.
+   *
+   * @details Idempotent; also called by the destructor.
+   */
+  void close();
+
+  /**
+   * @brief False once the writer failed to open the output file.
+   */
+  bool ok() const;
+
+  Stats stats() const;
+  const Params& params() const;
+
+private:
+  struct Slot {
+    cv::Mat image;
+    Overlay overlay;
+  };
+
+  void run();
+
+  std::string path_;
+  Params params_;
+  cv::VideoWriter writer_;     ///< Only touched by the writer thread.
+  cv::Size frame_size_{};      ///< Size the file was opened with.
+  cv::Mat resized_;            ///< Writer-thread scratch for off-size frames.
+
+  // ---- Queue: slots cycle free -> filled (FIFO) -> encoding -> free ----
+  std::vector<Slot> slots_;
+  std::vector<int> free_;
+  std::vector<int> filled_;    ///< FIFO of queued slots, oldest first.
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+  std::atomic<bool> failed_{false};
+  Stats stats_;
+  std::thread worker_;
+};
@@ -1,7 +1,10 @@
 #include "camera_model.hpp"
 #include "config_class.hpp"
+#include "frame_source.hpp"
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <cmath>
 #include <opencv2/opencv.hpp>
 CameraModel::CameraModel(std::string intrinsics_path){
   filepath = intrinsics_path;
@@ -10,7 +13,7 @@ CameraModel::CameraModel(std::string intrinsics_path){
     loadFromFile();
   }
 
-  else if (filetype == "mp4" || filetype == "MOV"){
+  else if (filetype == "mp4" || filetype == "MOV" || filetype == "avi"){
     calibrateFromFile();
   }
 
@@ -24,27 +27,28 @@ CameraModel::CameraModel(std::string intrinsics_path){
 
 void CameraModel::calibrateFromFile(){
   std::cout << "Calibrating from file" << std::endl;
+  calibration_stats = CalibrationStats{};
 
   int checkerboard_samples = 150;
   int calibrate_samples = 30;
   cv::Size patternSize(6,8);
 
-  cv::VideoCapture capture(filepath);
+  FrameSource::Params source_params;
+  source_params.build_index = false;
+  FrameSource source(filepath, source_params);
 
-  if (!capture.isOpened()) {
+  if (!source.open()) {
       std::cerr << "Error: could not open video file" << std::endl;
       return;
   }
 
-  cv::Mat frame;
-  capture >> frame;
-  if (frame.empty()) {
+  if (source.frameSize().area() <= 0) {
       std::cerr << "Error: could not read first frame" << std::endl;
       return;
   }
 
-  int image_w = frame.cols;
-  int image_h = frame.rows;
+  int image_w = source.frameSize().width;
+  int image_h = source.frameSize().height;
   
   
   cv::TermCriteria criteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.001);
@@ -61,36 +65,34 @@ void CameraModel::calibrateFromFile(){
   std::vector<std::vector<cv::Point2f>> imgpoints;
 
 
-  int frame_count = static_cast<int>(capture.get(cv::CAP_PROP_FRAME_COUNT));
+  int frame_count = static_cast<int>(source.frameCount());
   int checkerboard_step = frame_count/checkerboard_samples;
   if (checkerboard_step < 1) {checkerboard_step = 1;}
 
-
-  int i = 0;
-  while (true) {
-      capture >> frame;
-
-      if (frame.empty()) {
-          break;
+  // Only every checkerboard_step-th frame is decoded; the rest are skipped
+  // by the background decoder while the previous sample is being processed.
+  source.setStride(checkerboard_step);
+
+  cv::Mat gray;
+  FrameSource::Frame frame;
+  auto t0 = std::chrono::steady_clock::now();
+  while (source.acquire(frame)) {
+      ++calibration_stats.frames_decoded;
+      cv::cvtColor(*frame.image, gray, cv::COLOR_BGR2GRAY);
+      source.release(frame);
+
+      std::vector<cv::Point2f> corners;
+      bool found = cv::findChessboardCorners(gray, patternSize, corners, cv::CALIB_CB_ADAPTIVE_THRESH + cv::CALIB_CB_NORMALIZE_IMAGE);
+      if (found) {
+
+          cv::cornerSubPix(gray, corners, cv::Size(5,5), cv::Size(-1,-1), criteria);
+          objpoints.push_back(objp);
+          imgpoints.push_back(corners);
       }
-
-      if (i%checkerboard_step==0){ 
-          cv::Mat gray;
-          cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
-
-
-          std::vector<cv::Point2f> corners;
-          bool found = cv::findChessboardCorners(gray, patternSize, corners, cv::CALIB_CB_ADAPTIVE_THRESH + cv::CALIB_CB_NORMALIZE_IMAGE);
-          if (found) {
-
-              cv::cornerSubPix(gray, corners, cv::Size(5,5), cv::Size(-1,-1), criteria);
-              objpoints.push_back(objp);
-              imgpoints.push_back(corners);
-          }
-      }
-      i++;
-
     }
+  calibration_stats.detect_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - t0).count();
+  calibration_stats.boards_found = static_cast<int>(objpoints.size());
 
   if (objpoints.empty() || imgpoints.empty()) {
   std::cerr << "No corners were found — calibration aborted." << std::endl;
@@ -133,9 +135,15 @@ void CameraModel::calibrateFromFile(){
 
   }
 
-  cv::calibrateCamera(objpoints_sampled, imgpoints_sampled, cv::Size(image_w, image_h),K_mat, D_mat, rvecs, tvecs);
+  calibration_stats.samples_used = static_cast<int>(objpoints_sampled.size());
+  t0 = std::chrono::steady_clock::now();
+  calibration_stats.rms_px = cv::calibrateCamera(objpoints_sampled, imgpoints_sampled, cv::Size(image_w, image_h),K_mat, D_mat, rvecs, tvecs);
+  calibration_stats.solve_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - t0).count();
+  native_size_ = cv::Size(image_w, image_h);
   K_mat.convertTo(K_mat, CV_32F);
   D_mat.convertTo(D_mat,CV_32F);
+  syncIntrinsics();
 
   return;
 
@@ -180,7 +188,9 @@ void CameraModel::loadFromFile(){
   }
 
 
-  for (int i=9; i<14; i++ ){
+  // 5 coefficients (k1 k2 p1 p2 k3), or 8 for the rational model (+ k4 k5 k6).
+  const int n_coeffs = values.size() >= 17 ? 8 : 5;
+  for (int i=9; i<9+n_coeffs; i++ ){
     dcoeff_values.push_back(values[i]);
   }
 
@@ -194,24 +204,117 @@ void CameraModel::loadFromFile(){
 
   }
 
-  for (int i = 0; i<5; i++) {
+  D_mat = cv::Mat::zeros(1, n_coeffs, CV_32F);
+  for (int i = 0; i<n_coeffs; i++) {
     D_mat.at<float>(0,i) = dcoeff_values[i];
   }
+  syncIntrinsics();
   return;
   
 }
 
-cv::Mat CameraModel::undistort(cv::Mat img) {
+void CameraModel::setIntrinsics(const cv::Mat& K, const cv::Mat& D) {
+  K.convertTo(K_mat, CV_32F);
+  D.convertTo(D_mat, CV_32F);
+  syncIntrinsics();
+}
 
-  int image_w = img.cols;
-  int image_h = img.rows;
+void CameraModel::syncIntrinsics() {
+  intrinsics = Intrinsics::fromMats(K_mat, D_mat);
+  if (native_size_.area() > 0) {
+    const cv::Size proc = processingSize(native_size_);
+    scale_x_ = static_cast<double>(proc.width) / native_size_.width;
+    scale_y_ = static_cast<double>(proc.height) / native_size_.height;
+    processing_intrinsics = intrinsics.scaledTo(native_size_, proc);
+  } else {
+    scale_x_ = scale_y_ = processing_scale_;
+    processing_intrinsics = intrinsics.scaled(static_cast<float>(processing_scale_));
+  }
+  distortion_kind = distortion::detectKind(intrinsics);
+  undistort_size_ = cv::Size();  // K/D or scale changed: rebuild remap tables
+}
 
-  cv::Mat newCameraMatrix = cv::getOptimalNewCameraMatrix(K_mat, D_mat, cv::Size(image_h,image_w),0);
-  cv::Mat dst;
-  cv::undistort(img, dst, K_mat, D_mat, newCameraMatrix);
+void CameraModel::setProcessingScale(double scale) {
+  if (!(scale > 0.0 && scale <= 1.0)) {
+    std::cerr << "Error: processing scale must be in (0, 1]" << std::endl;
+    return;
+  }
+  processing_scale_ = scale;
+  syncIntrinsics();
+}
+
+double CameraModel::processingScale() const { return processing_scale_; }
+
+void CameraModel::setNativeSize(const cv::Size& size) {
+  if (size == native_size_) return;
+  native_size_ = size;
+  syncIntrinsics();
+}
+
+cv::Size CameraModel::nativeSize() const { return native_size_; }
+
+cv::Size CameraModel::processingSize(const cv::Size& native) const {
+  if (processing_scale_ == 1.0) return native;
+  return {static_cast<int>(std::lround(native.width * processing_scale_)),
+          static_cast<int>(std::lround(native.height * processing_scale_))};
+}
+
+Intrinsics CameraModel::intrinsicsFor(const cv::Size& size) const {
+  if (native_size_.area() <= 0) return processing_intrinsics;
+  if (size == native_size_) return intrinsics;
+  if (size == processingSize(native_size_)) return processing_intrinsics;
+  return intrinsics.scaledTo(native_size_, size);
+}
+
+void CameraModel::toProcessing(const cv::Mat& native, cv::Mat& out) const {
+  if (processing_scale_ == 1.0) {
+    native.copyTo(out);
+    return;
+  }
+  cv::resize(native, out, processingSize(native.size()), 0, 0, cv::INTER_AREA);
+}
+
+cv::Point2f CameraModel::toNative(const cv::Point2f& p) const {
+  const float inv_x = static_cast<float>(1.0 / scale_x_);
+  const float inv_y = static_cast<float>(1.0 / scale_y_);
+  return {(p.x + 0.5f) * inv_x - 0.5f, (p.y + 0.5f) * inv_y - 0.5f};
+}
+
+cv::Point2f CameraModel::toProcessing(const cv::Point2f& p) const {
+  const float sx = static_cast<float>(scale_x_), sy = static_cast<float>(scale_y_);
+  return {(p.x + 0.5f) * sx - 0.5f, (p.y + 0.5f) * sy - 0.5f};
+}
 
+void CameraModel::undistortPoints(const std::vector<cv::Point2f>& in,
+                                  std::vector<cv::Point2f>& out) const {
+  out.resize(in.size());
+  distortion::undistortPoints(distortion_kind, processing_intrinsics, in.data(), in.size(), out.data());
+}
+
+cv::Mat CameraModel::undistort(cv::Mat img) {
+  cv::Mat dst;
+  undistort(img, dst);
   return dst;
+}
+
+void CameraModel::undistort(const cv::Mat& img, cv::Mat& dst) {
+
+  if (distortion_kind == DistortionKind::None) {
+    img.copyTo(dst);  // rectified camera: the remap would be the identity
+    return;
+  }
+
+  if (img.size() != undistort_size_) {
+    const Intrinsics in = intrinsicsFor(img.size());
+    const cv::Mat K(in.K());
+    const cv::Mat newCameraMatrix = cv::getOptimalNewCameraMatrix(K, D_mat, img.size(), 0);
+    distortion::buildUndistortMap(distortion_kind, in,
+                                  Intrinsics::fromMats(newCameraMatrix, cv::Mat()),
+                                  img.size(), undistort_map1_, undistort_map2_);
+    undistort_size_ = img.size();
+  }
 
+  cv::remap(img, dst, undistort_map1_, undistort_map2_, cv::INTER_LINEAR);
 }
 
 
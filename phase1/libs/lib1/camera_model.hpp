@@ -3,24 +3,81 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include <string>
+#include "intrinsics.hpp"
+#include "distortion_model.hpp"
 
 
 class CameraModel {
 
   public:
     CameraModel(std::string intrinsics_path);
+    virtual ~CameraModel() = default;
     std::string filepath;
     cv::Mat K_mat = cv::Mat::zeros(3,3,CV_32F);
     cv::Mat D_mat = cv::Mat::zeros(1,5,CV_32F);
     std::vector<cv::Mat> rvecs;
     std::vector<cv::Mat> tvecs;
+    // Fixed-size mirror of K_mat/D_mat for per-point math; see syncIntrinsics().
+    Intrinsics intrinsics;
+    // `intrinsics` rescaled to the processing resolution (== intrinsics at scale 1).
+    // Uses the exact per-axis factors of the rounded processing size once the
+    // native frame size is known (see setNativeSize()).
+    Intrinsics processing_intrinsics;
+    // Simplest distortion model that fits D_mat; chosen in syncIntrinsics().
+    DistortionKind distortion_kind = DistortionKind::None;
+    // What the last calibrateFromFile() did; all zero after loadFromFile().
+    struct CalibrationStats {
+      int frames_decoded = 0;   // frames examined for a board
+      int boards_found = 0;
+      int samples_used = 0;     // views passed to cv::calibrateCamera
+      double detect_ms = 0.0;   // decode + findChessboardCorners + cornerSubPix
+      double solve_ms = 0.0;    // cv::calibrateCamera
+      double rms_px = 0.0;      // reprojection RMS returned by cv::calibrateCamera
+    };
+    CalibrationStats calibration_stats;
 
     void loadFromFile();
     void calibrateFromFile();
+    // Undistorts an image at native or processing resolution; the intrinsics are
+    // chosen from img.size() (see intrinsicsFor()). Remap tables are cached per
+    // image size and rebuilt when K/D/scale change.
     cv::Mat undistort(cv::Mat img);
+    // Same, into a caller-owned buffer; no allocation once dst has the right size.
+    void undistort(const cv::Mat& img, cv::Mat& dst);
+    // Undistort pixel positions at processing resolution (same K, no new camera matrix).
+    void undistortPoints(const std::vector<cv::Point2f>& in, std::vector<cv::Point2f>& out) const;
+
+    // Replace K_mat/D_mat and refresh `intrinsics`.
+    void setIntrinsics(const cv::Mat& K, const cv::Mat& D);
+    // Re-derive `intrinsics` after K_mat/D_mat were modified in place.
+    virtual void syncIntrinsics();
+
+    // Processing resolution as a fraction of native, in (0, 1]; e.g. 0.5 or 0.25.
+    void setProcessingScale(double scale);
+    double processingScale() const;
+    // Native frame size; calibrateFromFile() and HumanDetector::setFrame() set it.
+    // Until it is known, the nominal scale stands in for the per-axis factors.
+    void setNativeSize(const cv::Size& size);
+    cv::Size nativeSize() const;
+    // Size toProcessing() produces for a native frame of `native` pixels.
+    cv::Size processingSize(const cv::Size& native) const;
+    // Intrinsics for an image of `size`: native, processing or any other resize
+    // of the native frame. Without a known native size, processing_intrinsics.
+    Intrinsics intrinsicsFor(const cv::Size& size) const;
+    // Resize a native-resolution frame to processing resolution (copy at scale 1).
+    void toProcessing(const cv::Mat& native, cv::Mat& out) const;
+    // Map points between processing and native pixel coordinates.
+    cv::Point2f toNative(const cv::Point2f& p) const;
+    cv::Point2f toProcessing(const cv::Point2f& p) const;
 
 
   private:
+    double processing_scale_ = 1.0;
+    cv::Size native_size_{};
+    double scale_x_ = 1.0, scale_y_ = 1.0;  // actual processing / native, per axis
+    cv::Mat undistort_map1_;
+    cv::Mat undistort_map2_;
+    cv::Size undistort_size_{};
 
 
 
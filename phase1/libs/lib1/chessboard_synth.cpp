@@ -0,0 +1,297 @@
+#include "chessboard_synth.hpp"
+#include "camera_model.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+
+#include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+namespace {
+
+constexpr int kBorder = 2;  // squares from the texture edge to board corner (0, 0)
+
+double msSince(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+cv::Matx33d rotation(double ax, double ay, double az) {
+  const cv::Matx33d Rx(1, 0, 0,  0, std::cos(ax), -std::sin(ax),  0, std::sin(ax), std::cos(ax));
+  const cv::Matx33d Ry(std::cos(ay), 0, std::sin(ay),  0, 1, 0,  -std::sin(ay), 0, std::cos(ay));
+  const cv::Matx33d Rz(std::cos(az), -std::sin(az), 0,  std::sin(az), std::cos(az), 0,  0, 0, 1);
+  return Rz * Ry * Rx;
+}
+
+cv::Matx33d rotationOf(const cv::Vec3d& rvec) {
+  cv::Matx33d R;
+  cv::Rodrigues(rvec, R);
+  return R;
+}
+
+// Normalized camera coordinates -> distorted pixel with the model of @p kind.
+cv::Point2f toPixel(DistortionKind kind, const Intrinsics& in, double x, double y) {
+  float xd = 0.0f, yd = 0.0f;
+  distortion::dispatch(kind, [&](auto model) {
+    distortion::distortNormalized<decltype(model)>(in, static_cast<float>(x), static_cast<float>(y), xd, yd);
+  });
+  return {in.fx * xd + in.cx, in.fy * yd + in.cy};
+}
+
+}  // namespace
+
+ChessboardSynth::ChessboardSynth(const Intrinsics& truth)
+: ChessboardSynth(truth, Params{}) {}
+
+ChessboardSynth::ChessboardSynth(const Intrinsics& truth, const Params& p)
+: truth_(truth), kind_(distortion::detectKind(truth)), params_(p) {
+  CV_Assert(params_.pattern.width > 1 && params_.pattern.height > 1 && params_.px_per_square > 0);
+  CV_Assert(params_.min_distance > 0.0 && params_.max_distance >= params_.min_distance);
+
+  // Squares span [-1, pattern] on each axis; one more white square of border around them.
+  const int pps = params_.px_per_square;
+  const int sq_x = params_.pattern.width + 1, sq_y = params_.pattern.height + 1;
+  texture_ = cv::Mat((sq_y + 2) * pps, (sq_x + 2) * pps, CV_8U, cv::Scalar(255));
+  for (int b = -1; b < params_.pattern.height; ++b) {
+    for (int a = -1; a < params_.pattern.width; ++a) {
+      if (((a + b) & 1) == 0) {
+        texture_(cv::Rect((a + kBorder) * pps, (b + kBorder) * pps, pps, pps)).setTo(0);
+      }
+    }
+  }
+
+  // The undistorted ray of every output pixel never changes; only the pose does.
+  const cv::Size size = params_.image_size;
+  rays_.create(size, CV_32FC2);
+  distortion::dispatch(kind_, [&](auto model) {
+    using Model = decltype(model);
+    for (int v = 0; v < size.height; ++v) {
+      cv::Vec2f* row = rays_.ptr<cv::Vec2f>(v);
+      for (int u = 0; u < size.width; ++u) {
+        const cv::Point2f und = distortion::undistortPoint<Model, 20>(
+            truth_, cv::Point2f(static_cast<float>(u), static_cast<float>(v)));
+        row[u] = cv::Vec2f((und.x - truth_.cx) * truth_.inv_fx, (und.y - truth_.cy) * truth_.inv_fy);
+      }
+    }
+  });
+}
+
+const Intrinsics& ChessboardSynth::truth() const { return truth_; }
+const ChessboardSynth::Params& ChessboardSynth::params() const { return params_; }
+
+void ChessboardSynth::objectPoints(std::vector<cv::Point3f>& out) const {
+  out.clear();
+  for (int i = 0; i < params_.pattern.height; ++i) {
+    for (int j = 0; j < params_.pattern.width; ++j) {
+      out.emplace_back(static_cast<float>(j), static_cast<float>(i), 0.0f);
+    }
+  }
+}
+
+bool ChessboardSynth::inView(const Pose& pose) const {
+  const cv::Matx33d R = rotationOf(pose.rvec);
+  const double x0 = -kBorder, x1 = params_.pattern.width + 1;
+  const double y0 = -kBorder, y1 = params_.pattern.height + 1;
+  const float margin = 4.0f;
+  // Sample the outline, not just the corners: distortion bends the edges.
+  for (int k = 0; k <= 8; ++k) {
+    const double s = k / 8.0;
+    const cv::Vec3d outline[4] = {{x0 + s * (x1 - x0), y0, 0}, {x0 + s * (x1 - x0), y1, 0},
+                                  {x0, y0 + s * (y1 - y0), 0}, {x1, y0 + s * (y1 - y0), 0}};
+    for (const auto& X : outline) {
+      const cv::Vec3d P = R * X + pose.tvec;
+      if (P[2] <= 0.0) return false;
+      const cv::Point2f px = toPixel(kind_, truth_, P[0] / P[2], P[1] / P[2]);
+      if (px.x < margin || px.y < margin ||
+          px.x > params_.image_size.width - 1 - margin ||
+          px.y > params_.image_size.height - 1 - margin) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+ChessboardSynth::Pose ChessboardSynth::pose(int i) const {
+  cv::RNG rng(params_.seed + static_cast<std::uint64_t>(i));
+  const double deg = CV_PI / 180.0;
+  const cv::Vec3d center((params_.pattern.width - 1) * 0.5, (params_.pattern.height - 1) * 0.5, 0.0);
+  const double W = params_.image_size.width, H = params_.image_size.height;
+
+  for (int attempt = 0; attempt < 200; ++attempt) {
+    // Separate statements: argument evaluation order would make the draws compiler-dependent.
+    const double ax = rng.uniform(-params_.max_tilt_deg, params_.max_tilt_deg) * deg;
+    const double ay = rng.uniform(-params_.max_tilt_deg, params_.max_tilt_deg) * deg;
+    const double az = rng.uniform(-params_.max_roll_deg, params_.max_roll_deg) * deg;
+    const cv::Matx33d R = rotation(ax, ay, az);
+    const double z = rng.uniform(params_.min_distance, params_.max_distance);
+    const double u = rng.uniform(0.3 * W, 0.7 * W), v = rng.uniform(0.3 * H, 0.7 * H);
+    const cv::Vec3d target((u - truth_.cx) * truth_.inv_fx * z, (v - truth_.cy) * truth_.inv_fy * z, z);
+
+    Pose p;
+    cv::Rodrigues(R, p.rvec);
+    p.tvec = target - R * center;
+    if (inView(p)) return p;
+  }
+
+  // Nothing random fit: fronto-parallel at the far distance, on the optical axis.
+  Pose p;
+  p.rvec = cv::Vec3d(0, 0, 0);
+  p.tvec = cv::Vec3d(-center[0], -center[1], params_.max_distance);
+  return p;
+}
+
+void ChessboardSynth::render(int i, cv::Mat& bgr, std::vector<cv::Point2f>* corners) {
+  const Pose p = pose(i);
+  const cv::Matx33d R = rotationOf(p.rvec);
+
+  // Board plane (X, Y, 1) -> normalized ray: H = [r1 r2 t]; rendering needs the inverse.
+  const cv::Matx33d Hm(R(0,0), R(0,1), p.tvec[0],
+                       R(1,0), R(1,1), p.tvec[1],
+                       R(2,0), R(2,1), p.tvec[2]);
+  const cv::Matx33d Hi = Hm.inv();
+
+  const cv::Size size = params_.image_size;
+  const double pps = params_.px_per_square;
+  map_x_.create(size, CV_32F);
+  map_y_.create(size, CV_32F);
+  for (int v = 0; v < size.height; ++v) {
+    const cv::Vec2f* ray = rays_.ptr<cv::Vec2f>(v);
+    float* mx = map_x_.ptr<float>(v);
+    float* my = map_y_.ptr<float>(v);
+    for (int u = 0; u < size.width; ++u) {
+      const double x = ray[u][0], y = ray[u][1];
+      const double w = Hi(2,0) * x + Hi(2,1) * y + Hi(2,2);
+      if (w <= 0.0) {  // ray points away from the board plane
+        mx[u] = my[u] = -1.0f;
+        continue;
+      }
+      const double X = (Hi(0,0) * x + Hi(0,1) * y + Hi(0,2)) / w;
+      const double Y = (Hi(1,0) * x + Hi(1,1) * y + Hi(1,2)) / w;
+      mx[u] = static_cast<float>((X + kBorder) * pps - 0.5);
+      my[u] = static_cast<float>((Y + kBorder) * pps - 0.5);
+    }
+  }
+  cv::remap(texture_, gray_, map_x_, map_y_, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(110));
+
+  if (params_.blur_sigma > 0.0) {
+    cv::GaussianBlur(gray_, gray_, cv::Size(), params_.blur_sigma);
+  }
+  if (params_.noise_std > 0.0) {
+    cv::RNG rng(~(params_.seed + static_cast<std::uint64_t>(i)));
+    noise_.create(size, CV_16S);
+    rng.fill(noise_, cv::RNG::NORMAL, 0.0, params_.noise_std);
+    cv::add(gray_, noise_, gray_, cv::noArray(), CV_8U);
+  }
+  cv::cvtColor(gray_, bgr, cv::COLOR_GRAY2BGR);
+
+  if (corners) project(p, *corners);
+}
+
+void ChessboardSynth::corners(int i, std::vector<cv::Point2f>& out) const {
+  project(pose(i), out);
+}
+
+void ChessboardSynth::project(const Pose& pose, std::vector<cv::Point2f>& out) const {
+  const cv::Matx33d R = rotationOf(pose.rvec);
+  std::vector<cv::Point3f> obj;
+  objectPoints(obj);
+  out.resize(obj.size());
+  for (std::size_t k = 0; k < obj.size(); ++k) {
+    const cv::Vec3d P = R * cv::Vec3d(obj[k].x, obj[k].y, 0.0) + pose.tvec;
+    out[k] = toPixel(kind_, truth_, P[0] / P[2], P[1] / P[2]);
+  }
+}
+
+bool ChessboardSynth::writeVideo(const std::string& path, int frames) {
+  cv::VideoWriter writer(path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'),
+                         params_.fps, params_.image_size, true);
+  if (!writer.isOpened()) {
+    std::cerr << "Error: could not open " << path << " for writing" << std::endl;
+    return false;
+  }
+  cv::Mat frame;
+  for (int i = 0; i < frames; ++i) {
+    render(i, frame);
+    writer.write(frame);
+  }
+  return true;
+}
+
+double CalibrationReport::decodeFps() const {
+  return detect_ms > 0.0 ? frames_decoded * 1000.0 / detect_ms : 0.0;
+}
+
+double CalibrationReport::hitRate() const {
+  return frames_decoded > 0 ? static_cast<double>(boards_found) / frames_decoded : 0.0;
+}
+
+std::ostream& operator<<(std::ostream& os, const CalibrationReport& r) {
+  const auto flags = os.flags();
+  os << std::fixed << std::setprecision(2)
+     << "frames rendered    " << r.frames << " in " << r.render_ms << " ms\n"
+     << "decode + detect    " << r.frames_decoded << " frames, " << r.decodeFps() << " fps\n"
+     << "board hit rate     " << r.hitRate() * 100.0 << " % (" << r.boards_found << ")\n"
+     << "solve              " << r.samples_used << " views in " << r.solve_ms << " ms, rms "
+     << r.rms_px << " px\n"
+     << "fx / fy error      " << r.fx_err_pct << " % / " << r.fy_err_pct << " %\n"
+     << "cx / cy error      " << r.cx_err_px << " px / " << r.cy_err_px << " px\n"
+     << "distortion error   " << r.distortion_err_px << " px (max at board corners)\n";
+  os.flags(flags);
+  return os;
+}
+
+CalibrationReport benchmarkCalibration(const Intrinsics& truth, int frames,
+                                       const std::string& video_path,
+                                       const ChessboardSynth::Params& p) {
+  CalibrationReport r;
+  r.frames = frames;
+
+  auto t0 = std::chrono::steady_clock::now();
+  ChessboardSynth synth(truth, p);
+  if (!synth.writeVideo(video_path, frames)) return r;
+  r.render_ms = msSince(t0);
+
+  CameraModel cam(video_path);  // .avi -> calibrateFromFile()
+  const CameraModel::CalibrationStats& s = cam.calibration_stats;
+  r.frames_decoded = s.frames_decoded;
+  r.boards_found = s.boards_found;
+  r.samples_used = s.samples_used;
+  r.detect_ms = s.detect_ms;
+  r.solve_ms = s.solve_ms;
+  r.rms_px = s.rms_px;
+  r.ok = s.samples_used > 0 && cam.intrinsics.fx > 0.0f;
+  if (!r.ok) return r;
+
+  const Intrinsics& est = cam.intrinsics;
+  r.fx_err_pct = std::abs(est.fx - truth.fx) / truth.fx * 100.0;
+  r.fy_err_pct = std::abs(est.fy - truth.fy) / truth.fy * 100.0;
+  r.cx_err_px = std::abs(est.cx - truth.cx);
+  r.cy_err_px = std::abs(est.cy - truth.cy);
+
+  // Distortion alone: same ray, both coefficient sets, both through the true K.
+  // Only where the views put corners: beyond them k3 is an unconstrained
+  // extrapolation (tens of px in the image corners) whatever the detector does.
+  const DistortionKind kt = distortion::detectKind(truth);
+  const DistortionKind ke = distortion::detectKind(est);
+  Intrinsics warped = est;  // est's coefficients, truth's K
+  warped.fx = truth.fx;  warped.fy = truth.fy;
+  warped.cx = truth.cx;  warped.cy = truth.cy;
+  std::vector<cv::Point2f> pts;
+  for (int i = 0; i < frames; ++i) {
+    synth.corners(i, pts);
+    for (const auto& pt : pts) {
+      const double x = (pt.x - truth.cx) * truth.inv_fx;
+      const double y = (pt.y - truth.cy) * truth.inv_fy;
+      const cv::Point2f a = toPixel(kt, truth, x, y);
+      const cv::Point2f b = toPixel(ke, warped, x, y);
+      r.distortion_err_px = std::max(r.distortion_err_px,
+                                     static_cast<double>(std::hypot(a.x - b.x, a.y - b.y)));
+    }
+  }
+  return r;
+}
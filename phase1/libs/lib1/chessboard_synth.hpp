@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "intrinsics.hpp"
+#include "distortion_model.hpp"
+
+/**
+ * @file chessboard_synth.hpp
+ * @brief Synthetic chessboard videos with known intrinsics, and a calibration
+ *        benchmark built on them.
+ *
+ * @details
+ * ChessboardSynth renders the 6x8 inner-corner board that
+ * CameraModel::calibrateFromFile() looks for, as seen by a camera with known
+ * K and distortion, in a random but reproducible pose per frame. Rendering
+ * is an inverse map: every output pixel is undistorted once (cached), then
+ * per frame intersected with the board plane through the pose homography and
+ * sampled from a board texture with cv::remap. Optional blur and sensor noise
+ * keep corner detection honest.
+ *
+ * benchmarkCalibration() writes such a video, runs the real calibration path
+ * (CameraModel on the file) and reports throughput and accuracy against the
+ * ground truth, so speedups and accuracy regressions can be measured headless.
+ */
+class ChessboardSynth {
+public:
+  struct Params {
+    cv::Size image_size{640, 480};   ///< Rendered frame size.
+    cv::Size pattern{6, 8};          ///< Inner corners (as calibrateFromFile()'s patternSize).
+    int    px_per_square = 48;       ///< Texture resolution of one square.
+    double min_distance  = 16.0;     ///< Board distance range, in squares.
+    double max_distance  = 28.0;
+    double max_tilt_deg  = 35.0;     ///< Rotation about the board's x and y axes.
+    double max_roll_deg  = 20.0;     ///< Rotation about the optical axis.
+    double blur_sigma    = 0.6;      ///< Gaussian blur (px); 0 = off.
+    double noise_std     = 2.0;      ///< Additive gray-level noise; 0 = off.
+    std::uint64_t seed   = 0x5eed;   ///< Frame i uses seed + i: any frame can be re-rendered alone.
+    double fps           = 30.0;     ///< writeVideo() frame rate.
+  };
+
+  /**
+   * @brief Board pose of one frame: board (X, Y, 0), in squares, maps to camera R*X + t.
+   */
+  struct Pose {
+    cv::Vec3d rvec;
+    cv::Vec3d tvec;
+  };
+
+  /**
+   * @param truth Ground-truth intrinsics and distortion of the simulated camera.
+   */
+  explicit ChessboardSynth(const Intrinsics& truth);
+  ChessboardSynth(const Intrinsics& truth, const Params& p);
+
+  /**
+   * @brief Pose of frame @p i; the whole board (with its white border) is in view.
+   */
+  Pose pose(int i) const;
+
+  /**
+   * @brief Render frame @p i (BGR) and optionally its true corner positions (distorted pixels).
+   */
+  void render(int i, cv::Mat& bgr, std::vector<cv::Point2f>* corners = nullptr);
+
+  /**
+   * @brief True corner positions (distorted pixels) of frame @p i, without rendering.
+   */
+  void corners(int i, std::vector<cv::Point2f>& out) const;
+
+  /**
+   * @brief Render frames [0, frames) into an MJPG .avi at @p path.
+   * @return false if the file cannot be opened for writing.
+   */
+  bool writeVideo(const std::string& path, int frames);
+
+  /**
+   * @brief Board corners (j, i, 0) in squares, in the order findChessboardCorners reports them.
+   */
+  void objectPoints(std::vector<cv::Point3f>& out) const;
+
+  const Intrinsics& truth() const;
+  const Params& params() const;
+
+private:
+  bool inView(const Pose& pose) const;
+  void project(const Pose& pose, std::vector<cv::Point2f>& out) const;
+
+  Intrinsics truth_;
+  DistortionKind kind_;
+  Params params_;
+  cv::Mat texture_;   ///< Board with a one-square white border, CV_8U.
+  cv::Mat rays_;      ///< Undistorted normalized coordinates per output pixel, CV_32FC2.
+  cv::Mat map_x_, map_y_, gray_, noise_;
+};
+
+/**
+ * @brief Outcome of one benchmarkCalibration() run.
+ */
+struct CalibrationReport {
+  int    frames = 0;              ///< Frames rendered into the video.
+  double render_ms = 0.0;         ///< Time to render and encode the video.
+  int    frames_decoded = 0;      ///< Frames calibrateFromFile() examined.
+  int    boards_found = 0;        ///< Of those, frames with a detected board.
+  int    samples_used = 0;        ///< Views passed to cv::calibrateCamera.
+  double detect_ms = 0.0;         ///< Decode + corner detection.
+  double solve_ms = 0.0;          ///< cv::calibrateCamera.
+  double rms_px = 0.0;            ///< Reprojection RMS reported by the solver.
+  double fx_err_pct = 0.0, fy_err_pct = 0.0;  ///< |estimate - truth| / truth * 100.
+  double cx_err_px = 0.0, cy_err_px = 0.0;    ///< |estimate - truth|.
+  double distortion_err_px = 0.0; ///< Max distortion displacement error at the true corners of every frame.
+  bool   ok = false;              ///< Calibration produced intrinsics.
+
+  double decodeFps() const;       ///< frames_decoded / detect time.
+  double hitRate() const;         ///< boards_found / frames_decoded.
+};
+
+std::ostream& operator<<(std::ostream& os, const CalibrationReport& r);
+
+/**
+ * @brief Render @p frames synthetic frames to @p video_path (.avi), calibrate
+ *        from it with CameraModel and compare the result with the truth.
+ *
+ * @details The video is left on disk; the caller owns @p video_path.
+ */
+CalibrationReport benchmarkCalibration(const Intrinsics& truth, int frames,
+                                       const std::string& video_path,
+                                       const ChessboardSynth::Params& p = ChessboardSynth::Params());
@@ -1,5 +1,39 @@
 #include "config_class.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <set>
+#include <sstream>
+
+namespace {
+
+const char* const kKeys[] = {
+    "intrinsics_path", "extrinsics_path", "model_path",
+    "camera_height_m", "D_max_m", "D_close_m"};
+
+std::string trim(const std::string& s) {
+    const auto b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos) return "";
+    const auto e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+bool parseDouble(const std::string& text, double& out) {
+    std::istringstream ss(text);
+    double v;
+    if (!(ss >> v) || !(ss >> std::ws).eof()) return false;
+    out = v;
+    return true;
+}
+
+std::string envName(const std::string& key) {
+    std::string name = "HD_";
+    for (char c : key) name += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return name;
+}
+
+}  // namespace
 
 ConfigClass::ConfigClass(){
 
@@ -20,4 +54,135 @@ ConfigClass::ConfigClass(){
 
     std::cout << "\nEnter D close: ";
     std::cin >> D_close_m;
-}
\ No newline at end of file
+}
+
+ConfigClass::ConfigClass(Defaults) {}
+
+ZoneThresholds ConfigClass::zoneThresholds() const {
+    ZoneThresholds zone;
+    zone.D_close_m = static_cast<float>(D_close_m);
+    zone.D_max_m = static_cast<float>(D_max_m);
+    return zone;
+}
+
+ConfigClass ConfigClass::defaults() {
+    return ConfigClass{Defaults{}};
+}
+
+ConfigClass ConfigClass::fromFile(const std::string& path) {
+    ConfigClass cfg{Defaults{}};
+    cfg.loadFile(path);
+    return cfg;
+}
+
+ConfigClass ConfigClass::fromEnv() {
+    ConfigClass cfg{Defaults{}};
+    cfg.loadEnv();
+    return cfg;
+}
+
+ConfigClass ConfigClass::fromArgs(int argc, char** argv) {
+    ConfigClass cfg{Defaults{}};
+    if (argc > 1) cfg.loadArgs(std::vector<std::string>(argv + 1, argv + argc));
+    return cfg;
+}
+
+ConfigClass ConfigClass::load(const std::string& path,
+                              const std::vector<std::string>& args) {
+    ConfigClass cfg{Defaults{}};
+    if (!path.empty()) cfg.loadFile(path);
+    cfg.loadEnv();
+    cfg.loadArgs(args);
+    return cfg;
+}
+
+bool ConfigClass::set(const std::string& key, const std::string& value) {
+    if (key == "intrinsics_path") { intrinsicsPath = value; return true; }
+    if (key == "extrinsics_path") { extrinsicsPath = value; return true; }
+    if (key == "model_path") { modelPath = value; return true; }
+
+    double* target = nullptr;
+    if (key == "camera_height_m") target = &cameraHeight_m;
+    else if (key == "D_max_m") target = &D_max_m;
+    else if (key == "D_close_m") target = &D_close_m;
+
+    if (!target) {
+        std::cerr << "Error: unknown config key " << key << std::endl;
+        return false;
+    }
+    if (!parseDouble(value, *target)) {
+        std::cerr << "Error: invalid value for " << key << ": " << value << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Format: one "key = value" per line, '#' starts a comment line.
+bool ConfigClass::loadFile(const std::string& path, bool require_complete) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error opening " << path << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    bool ends_with_newline = true;
+    std::set<std::string> seen;
+    std::string line;
+    while (std::getline(file, line)) {
+        ends_with_newline = !file.eof();
+        line = trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        const auto eq = line.find('=');
+        if (eq == std::string::npos) {
+            std::cerr << "Error: malformed config line: " << line << std::endl;
+            ok = false;
+            continue;
+        }
+        const std::string key = trim(line.substr(0, eq));
+        ok = set(key, trim(line.substr(eq + 1))) && ok;
+        seen.insert(key);
+    }
+
+    if (require_complete) {
+        if (!ends_with_newline) {
+            std::cerr << "Error: " << path << " does not end with a newline (partial write?)" << std::endl;
+            ok = false;
+        }
+        for (const char* key : kKeys) {
+            if (!seen.count(key)) {
+                std::cerr << "Error: " << path << " is missing " << key << std::endl;
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
+void ConfigClass::loadEnv() {
+    for (const char* key : kKeys) {
+        if (const char* value = std::getenv(envName(key).c_str())) {
+            set(key, value);
+        }
+    }
+}
+
+// Accepts "--key=value" and "--key value".
+bool ConfigClass::loadArgs(const std::vector<std::string>& args) {
+    bool ok = true;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg.rfind("--", 0) != 0) continue;
+        const auto eq = arg.find('=');
+        if (eq != std::string::npos) {
+            ok = set(arg.substr(2, eq - 2), arg.substr(eq + 1)) && ok;
+        } else if (i + 1 < args.size()) {
+            ok = set(arg.substr(2), args[i + 1]) && ok;
+            ++i;
+        } else {
+            std::cerr << "Error: missing value for " << arg << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
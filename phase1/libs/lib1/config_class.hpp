@@ -1,19 +1,44 @@
 #pragma once
 #include <string>
+#include <vector>
+#include "zone_thresholds.hpp"
 
 class ConfigClass {
 
     public:
+    // Interactive: prompts for every value on std::cin.
     ConfigClass();
+
+    // Non-interactive loaders. Later sources override earlier ones:
+    // defaults < file < environment (HD_<KEY>) < command line (--key=value).
+    static ConfigClass defaults();
+    static ConfigClass fromFile(const std::string& path);
+    static ConfigClass fromEnv();
+    static ConfigClass fromArgs(int argc, char** argv);
+    static ConfigClass load(const std::string& path,
+                            const std::vector<std::string>& args = {});
+
+    bool set(const std::string& key, const std::string& value);
+    // With require_complete, the file must set every key and end with a
+    // newline, so a file caught mid-write (cut after a line or mid-value)
+    // is rejected instead of silently falling back to defaults.
+    bool loadFile(const std::string& path, bool require_complete = false);
+    void loadEnv();
+    bool loadArgs(const std::vector<std::string>& args);
+
     std::string intrinsicsPath;
     std::string extrinsicsPath;
     std::string modelPath;
-    double cameraHeight_m;
-    double D_max_m;
-    double D_close_m;
+    double cameraHeight_m = 0.063;
+    double D_max_m = ZoneThresholds{}.D_max_m;
+    double D_close_m = ZoneThresholds{}.D_close_m;
 
-    private:
+    // The configured ranges in the form the detector, tracker and offline
+    // processor take.
+    ZoneThresholds zoneThresholds() const;
 
+    private:
+    struct Defaults {};
+    explicit ConfigClass(Defaults);
 
 };
-
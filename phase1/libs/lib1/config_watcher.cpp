@@ -0,0 +1,72 @@
+#include "config_watcher.hpp"
+
+#include <system_error>
+
+ConfigWatcher::ConfigWatcher(const std::string& path,
+                             const std::vector<std::string>& args,
+                             std::chrono::milliseconds interval)
+: path_(path),
+  args_(args),
+  interval_(interval),
+  published_(stamp()),
+  cell_(ConfigClass::load(path, args)) {}
+
+ConfigWatcher::~ConfigWatcher() { stop(); }
+
+void ConfigWatcher::start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread(&ConfigWatcher::run, this);
+}
+
+void ConfigWatcher::stop() {
+  if (!running_.exchange(false)) return;
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+  }
+  wake_.notify_all();
+  if (thread_.joinable()) thread_.join();
+}
+
+bool ConfigWatcher::poll() {
+  std::lock_guard<std::mutex> lock(poll_mutex_);
+  const FileStamp now = stamp();
+  // A rejected state is retried once the file changes again, even within
+  // the same mtime tick, but the same bad file isn't re-reported every poll.
+  if (now == published_ || now == rejected_) return false;
+
+  ConfigClass cfg = ConfigClass::defaults();
+  if (!cfg.loadFile(path_, /*require_complete=*/true)) {
+    rejected_ = now;
+    return false;
+  }
+  cfg.loadEnv();
+  cfg.loadArgs(args_);
+  if (!cell_.publish(cfg)) return false;  // all slots pinned; retry next poll
+  published_ = now;
+  return true;
+}
+
+ConfigWatcher::Snapshot ConfigWatcher::current() const { return cell_.acquire(); }
+std::uint64_t ConfigWatcher::version() const { return cell_.version(); }
+
+void ConfigWatcher::run() {
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  while (running_) {
+    wake_.wait_for(lock, interval_, [this] { return !running_; });
+    if (!running_) break;
+    lock.unlock();
+    poll();
+    lock.lock();
+  }
+}
+
+ConfigWatcher::FileStamp ConfigWatcher::stamp() const {
+  std::error_code ec;
+  FileStamp s;
+  const auto t = std::filesystem::last_write_time(path_, ec);
+  if (ec) return s;
+  s.mtime = t;
+  const auto size = std::filesystem::file_size(path_, ec);
+  if (!ec) s.size = size;
+  return s;
+}
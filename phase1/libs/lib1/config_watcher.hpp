@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config_class.hpp"
+#include "snapshot_cell.hpp"
+
+/**
+ * @file config_watcher.hpp
+ * @brief Hot reload of a ConfigClass file, published as immutable snapshots.
+ *
+ * @details
+ * A background thread polls the file's modification time and size. When
+ * either changes,
+ * the file is re-parsed on top of defaults, then environment and command-line
+ * overrides are re-applied (same precedence as ConfigClass::load()). A reload
+ * is only published if the file parses cleanly, sets every key and ends with
+ * a newline; anything else keeps the previous snapshot current. That catches
+ * a file cut after a line or inside a value, but not every possible partial
+ * write: update the file by writing a temporary file and renaming it over the
+ * watched path, which replaces it atomically.
+ *
+ * Frame-processing threads call current() once per frame; it pins the latest
+ * snapshot without taking a lock, so new camera height / D_max / D_close values
+ * take effect on the next frame without restarting the pipeline.
+ */
+class ConfigWatcher {
+public:
+  using Snapshot = SnapshotCell<ConfigClass>::Handle;
+
+  /**
+   * @param path     Config file to load and watch.
+   * @param args     Command-line overrides re-applied on every reload.
+   * @param interval Polling period for the file's modification time.
+   */
+  explicit ConfigWatcher(const std::string& path,
+                         const std::vector<std::string>& args = {},
+                         std::chrono::milliseconds interval = std::chrono::milliseconds(250));
+  ~ConfigWatcher();
+
+  ConfigWatcher(const ConfigWatcher&) = delete;
+  ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+  /** @brief Start the polling thread (no-op if already running). */
+  void start();
+
+  /** @brief Stop and join the polling thread. */
+  void stop();
+
+  /**
+   * @brief Check the file now and publish it if it changed and is complete.
+   *
+   * @details Safe to call while the polling thread runs.
+   * @return true if a new snapshot was published.
+   */
+  bool poll();
+
+  /** @brief Pin the current configuration snapshot (lock-free). */
+  Snapshot current() const;
+
+  /** @brief Version of the current snapshot; bumps on every successful reload. */
+  std::uint64_t version() const;
+
+private:
+  /**
+   * @brief What a poll compares. The size is part of it because mtime only
+   *        has kernel-tick resolution: a file completed within the tick it was
+   *        truncated in keeps its mtime but not its size.
+   */
+  struct FileStamp {
+    std::filesystem::file_time_type mtime{};
+    std::uintmax_t size = 0;
+    bool operator==(const FileStamp& o) const { return mtime == o.mtime && size == o.size; }
+  };
+
+  void run();
+  FileStamp stamp() const;
+
+  std::string path_;
+  std::vector<std::string> args_;
+  std::chrono::milliseconds interval_;
+  std::mutex poll_mutex_;  ///< Serializes poll(): guards the stamps and publishing.
+  FileStamp published_;    ///< File state of the current snapshot.
+  FileStamp rejected_;     ///< Last file state that failed to load; not re-reported.
+  SnapshotCell<ConfigClass> cell_;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+};
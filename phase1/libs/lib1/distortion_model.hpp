@@ -0,0 +1,213 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include "intrinsics.hpp"
+
+/**
+ * @file distortion_model.hpp
+ * @brief Lens distortion models specialized at compile time.
+ *
+ * @details
+ * Each model is a tag type whose traits say which terms it has:
+ *
+ *   NoDistortion   x_d = x
+ *   RadialOnly     x_d = x * (1 + k1 r^2 + k2 r^4 + k3 r^6)
+ *   BrownConrady   RadialOnly + tangential (p1, p2)
+ *   Rational       radial numerator / (1 + k4 r^2 + k5 r^4 + k6 r^6) + tangential
+ *
+ * (OpenCV's model, coefficient order k1 k2 p1 p2 k3 k4 k5 k6.) The functions
+ * below are templates on the model and test the traits with `if constexpr`,
+ * so each instantiation is straight-line code containing only its own terms.
+ *
+ * The model is chosen once, when the calibration is loaded (detectKind()),
+ * and dispatch() turns that runtime choice into one template instantiation
+ * per batch: the switch runs once per call, never per point.
+ */
+enum class DistortionKind : std::uint8_t {
+  None,          ///< Rectified / pinhole: every coefficient is zero.
+  Radial,        ///< k1..k3 only.
+  BrownConrady,  ///< k1..k3 and p1, p2.
+  Rational,      ///< All 8 coefficients.
+};
+
+namespace distortion {
+
+struct NoDistortion {
+  static constexpr DistortionKind kind = DistortionKind::None;
+  static constexpr bool radial = false, tangential = false, rational = false;
+};
+struct RadialOnly {
+  static constexpr DistortionKind kind = DistortionKind::Radial;
+  static constexpr bool radial = true, tangential = false, rational = false;
+};
+struct BrownConrady {
+  static constexpr DistortionKind kind = DistortionKind::BrownConrady;
+  static constexpr bool radial = true, tangential = true, rational = false;
+};
+struct Rational {
+  static constexpr DistortionKind kind = DistortionKind::Rational;
+  static constexpr bool radial = true, tangential = true, rational = true;
+};
+
+/**
+ * @brief Simplest model that represents @p in's coefficients exactly
+ *        (coefficients with |c| <= @p eps count as zero).
+ */
+inline DistortionKind detectKind(const Intrinsics& in, float eps = 0.0f) {
+  auto nz = [eps](float c) { return c > eps || c < -eps; };
+  if (nz(in.k4) || nz(in.k5) || nz(in.k6)) return DistortionKind::Rational;
+  if (nz(in.p1) || nz(in.p2)) return DistortionKind::BrownConrady;
+  if (nz(in.k1) || nz(in.k2) || nz(in.k3)) return DistortionKind::Radial;
+  return DistortionKind::None;
+}
+
+/**
+ * @brief Call @p fn with a default-constructed model tag for @p kind.
+ */
+template <typename Fn>
+decltype(auto) dispatch(DistortionKind kind, Fn&& fn) {
+  switch (kind) {
+    case DistortionKind::Radial:       return fn(RadialOnly{});
+    case DistortionKind::BrownConrady: return fn(BrownConrady{});
+    case DistortionKind::Rational:     return fn(Rational{});
+    case DistortionKind::None:
+    default:                           return fn(NoDistortion{});
+  }
+}
+
+/**
+ * @brief Distort normalized coordinates (x, y) -> (xd, yd).
+ */
+template <typename Model>
+inline void distortNormalized(const Intrinsics& in, float x, float y, float& xd, float& yd) {
+  if constexpr (!Model::radial && !Model::tangential) {
+    xd = x;
+    yd = y;
+  } else {
+    const float r2 = x * x + y * y;
+    float s = 1.0f + r2 * (in.k1 + r2 * (in.k2 + r2 * in.k3));
+    if constexpr (Model::rational) {
+      s /= 1.0f + r2 * (in.k4 + r2 * (in.k5 + r2 * in.k6));
+    }
+    xd = x * s;
+    yd = y * s;
+    if constexpr (Model::tangential) {
+      const float xy2 = 2.0f * x * y;
+      xd += in.p1 * xy2 + in.p2 * (r2 + 2.0f * x * x);
+      yd += in.p1 * (r2 + 2.0f * y * y) + in.p2 * xy2;
+    }
+  }
+}
+
+/**
+ * @brief Pixel -> distorted pixel for an ideal (undistorted) pixel of the same camera.
+ */
+template <typename Model>
+inline cv::Point2f distortPoint(const Intrinsics& in, const cv::Point2f& uv) {
+  float xd, yd;
+  distortNormalized<Model>(in, (uv.x - in.cx) * in.inv_fx, (uv.y - in.cy) * in.inv_fy, xd, yd);
+  return {in.fx * xd + in.cx, in.fy * yd + in.cy};
+}
+
+/**
+ * @brief Distorted pixel -> undistorted pixel (same K), by fixed-point iteration.
+ *
+ * @details Same scheme as cv::undistortPoints: x = (x_d - tangential(x)) / radial(x).
+ *          Radial-only models skip the tangential terms; NoDistortion is the identity.
+ */
+template <typename Model, int Iterations = 5>
+inline cv::Point2f undistortPoint(const Intrinsics& in, const cv::Point2f& uv) {
+  if constexpr (!Model::radial && !Model::tangential) {
+    return uv;
+  } else {
+    const float x0 = (uv.x - in.cx) * in.inv_fx;
+    const float y0 = (uv.y - in.cy) * in.inv_fy;
+    float x = x0, y = y0;
+    for (int it = 0; it < Iterations; ++it) {
+      const float r2 = x * x + y * y;
+      float inv = 1.0f / (1.0f + r2 * (in.k1 + r2 * (in.k2 + r2 * in.k3)));
+      if constexpr (Model::rational) {
+        inv *= 1.0f + r2 * (in.k4 + r2 * (in.k5 + r2 * in.k6));
+      }
+      float dx = 0.0f, dy = 0.0f;
+      if constexpr (Model::tangential) {
+        const float xy2 = 2.0f * x * y;
+        dx = in.p1 * xy2 + in.p2 * (r2 + 2.0f * x * x);
+        dy = in.p1 * (r2 + 2.0f * y * y) + in.p2 * xy2;
+      }
+      x = (x0 - dx) * inv;
+      y = (y0 - dy) * inv;
+    }
+    return {in.fx * x + in.cx, in.fy * y + in.cy};
+  }
+}
+
+/**
+ * @brief Batched undistortPoint(); @p out may alias @p uv.
+ */
+template <typename Model>
+inline void undistortPoints(const Intrinsics& in, const cv::Point2f* uv, std::size_t n,
+                            cv::Point2f* out) {
+  for (std::size_t i = 0; i < n; ++i) out[i] = undistortPoint<Model>(in, uv[i]);
+}
+
+/**
+ * @brief Runtime-selected undistortPoints(): one dispatch, then the specialized loop.
+ */
+inline void undistortPoints(DistortionKind kind, const Intrinsics& in,
+                            const cv::Point2f* uv, std::size_t n, cv::Point2f* out) {
+  dispatch(kind, [&](auto model) {
+    undistortPoints<decltype(model)>(in, uv, n, out);
+  });
+}
+
+/**
+ * @brief Fill remap tables: for every pixel of the undistorted image (camera
+ *        @p dst_in, no distortion) the source position in the distorted image
+ *        (camera @p in with its distortion).
+ *
+ * @param map_x, map_y Row-major float tables starting at row 0, @p stride
+ *                     floats per row; rows [row_begin, row_end) are written.
+ *
+ * @details Equivalent to cv::initUndistortRectifyMap with R = I and CV_32FC1
+ *          output, minus the terms @p Model does not have.
+ */
+template <typename Model>
+inline void buildUndistortMap(const Intrinsics& in, const Intrinsics& dst_in,
+                              int width, int row_begin, int row_end,
+                              float* map_x, float* map_y, std::size_t stride) {
+  for (int v = row_begin; v < row_end; ++v) {
+    float* mx = map_x + static_cast<std::size_t>(v) * stride;
+    float* my = map_y + static_cast<std::size_t>(v) * stride;
+    const float y = (static_cast<float>(v) - dst_in.cy) * dst_in.inv_fy;
+    for (int u = 0; u < width; ++u) {
+      const float x = (static_cast<float>(u) - dst_in.cx) * dst_in.inv_fx;
+      float xd, yd;
+      distortNormalized<Model>(in, x, y, xd, yd);
+      mx[u] = in.fx * xd + in.cx;
+      my[u] = in.fy * yd + in.cy;
+    }
+  }
+}
+
+/**
+ * @brief cv::Mat front end of buildUndistortMap(); rows are filled in parallel.
+ *
+ * @param map_x, map_y Reallocated to @p size, CV_32FC1, only if needed.
+ */
+inline void buildUndistortMap(DistortionKind kind, const Intrinsics& in,
+                              const Intrinsics& dst_in, cv::Size size,
+                              cv::Mat& map_x, cv::Mat& map_y) {
+  map_x.create(size, CV_32FC1);
+  map_y.create(size, CV_32FC1);
+  dispatch(kind, [&](auto model) {
+    cv::parallel_for_(cv::Range(0, size.height), [&](const cv::Range& rows) {
+      buildUndistortMap<decltype(model)>(in, dst_in, size.width, rows.start, rows.end,
+                                         map_x.ptr<float>(), map_y.ptr<float>(),
+                                         map_x.step1());
+    });
+  });
+}
+
+}  // namespace distortion
@@ -0,0 +1,42 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(std::size_t initial_bytes)
+: block_(initial_bytes ? new std::byte[initial_bytes] : nullptr),
+  capacity_(initial_bytes) {}
+
+void* FrameArena::do_allocate(std::size_t bytes, std::size_t alignment) {
+  const auto base = reinterpret_cast<std::uintptr_t>(block_.get());
+  const std::uintptr_t aligned = (base + offset_ + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+  const std::size_t end = static_cast<std::size_t>(aligned - base) + bytes;
+  if (block_ && end <= capacity_) {
+    offset_ = end;
+    return reinterpret_cast<void*>(aligned);
+  }
+  ++overflows_;
+  overflow_bytes_ += bytes + alignment;
+  return spill_.allocate(bytes, alignment);
+}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+  return this == &other;
+}
+
+void FrameArena::reset() {
+  const std::size_t frame = offset_ + overflow_bytes_;
+  high_water_ = std::max(high_water_, frame);
+  if (overflow_bytes_ > 0) {
+    spill_.release();
+    capacity_ = high_water_ + high_water_ / 4;
+    block_.reset(new std::byte[capacity_]);
+  }
+  offset_ = 0;
+  overflow_bytes_ = 0;
+}
+
+std::size_t FrameArena::used() const { return offset_ + overflow_bytes_; }
+std::size_t FrameArena::capacity() const { return capacity_; }
+std::size_t FrameArena::highWater() const { return high_water_; }
+std::size_t FrameArena::overflows() const { return overflows_; }
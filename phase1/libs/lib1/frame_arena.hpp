@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @file frame_arena.hpp
+ * @brief Per-frame monotonic arena for transient buffers.
+ *
+ * @details
+ * A bump allocator over one block of memory that is released all at once by
+ * reset() at each frame boundary; deallocate() is a no-op. It derives from
+ * std::pmr::memory_resource, so std::pmr containers can draw from it:
+ *
+ * \code{.cpp}
+ *   arena.reset();                                    // new frame
+ *   std::pmr::vector<cv::Point3f> pts(&arena);
+ *   pts.reserve(n);                                   // no heap traffic
+ * \endcode
+ *
+ * If a frame needs more than the block holds, the excess comes from the heap
+ * and is counted as an overflow; the next reset() grows the block to the
+ * frame's high-water mark so that steady state never touches the allocator.
+ * Each thread should own its arena: it is not thread-safe, which is the point
+ * (no shared allocator to contend on).
+ */
+class FrameArena : public std::pmr::memory_resource {
+public:
+  explicit FrameArena(std::size_t initial_bytes = 64 * 1024);
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  /**
+   * @brief Release everything allocated this frame; grow if the frame overflowed.
+   */
+  void reset();
+
+  std::size_t used() const;        ///< Bytes handed out since reset() (incl. overflow).
+  std::size_t capacity() const;    ///< Size of the main block.
+  std::size_t highWater() const;   ///< Largest used() seen at any reset().
+  std::size_t overflows() const;   ///< Allocations served from the heap since construction.
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+  void do_deallocate(void*, std::size_t, std::size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+  std::unique_ptr<std::byte[]> block_;
+  std::size_t capacity_ = 0;
+  std::size_t offset_ = 0;
+  std::size_t overflow_bytes_ = 0;
+  std::size_t high_water_ = 0;
+  std::size_t overflows_ = 0;
+  std::pmr::monotonic_buffer_resource spill_{std::pmr::new_delete_resource()};
+};
@@ -0,0 +1,237 @@
+#include "frame_log.hpp"
+#include "intrinsics.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+Intrinsics toIntrinsics(const LogProjection& p) {
+  return Intrinsics::fromPinhole(p.fx, p.fy, p.cx, p.cy);
+}
+
+bool sameProjection(const frame_log::FileHeader& h, const LogProjection& p) {
+  return h.fx == p.fx && h.fy == p.fy && h.cx == p.cx && h.cy == p.cy &&
+         h.camera_height_m == p.camera_height_m;
+}
+
+// The one test of "a complete record starts at off", shared by the writer's
+// reopen scan and the reader's index.
+bool completeRecord(const frame_log::RecordHeader& rh, std::size_t off, std::size_t length) {
+  const std::size_t expected = sizeof(rh) + rh.num_features * sizeof(cv::Point2f);
+  return rh.size == expected && off + rh.size <= length;
+}
+
+}  // namespace
+
+// --- Writer ---
+FrameLogWriter::FrameLogWriter(const std::string& path, const LogProjection& projection)
+: buffer_(1 << 20) {
+  // "a+": writes always append, and the existing header can still be read.
+  file_ = std::fopen(path.c_str(), "a+b");
+  if (!file_) {
+    throw std::runtime_error("FrameLogWriter: could not open " + path);
+  }
+  std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+
+  std::fseek(file_, 0, SEEK_END);
+  if (std::ftell(file_) != 0) {
+    frame_log::FileHeader hdr{};
+    std::rewind(file_);
+    const bool valid = std::fread(&hdr, sizeof(hdr), 1, file_) == 1 &&
+                       std::memcmp(hdr.magic, frame_log::kMagic, sizeof(hdr.magic)) == 0 &&
+                       hdr.version == frame_log::kVersion;
+    if (!valid || !sameProjection(hdr, projection)) {
+      std::fclose(file_);
+      file_ = nullptr;
+      throw std::runtime_error("FrameLogWriter: " + path + (valid
+          ? " was recorded with a different projection" : " is not a frame log"));
+    }
+    truncateTornTail(path, hdr.header_size);
+    std::fseek(file_, 0, SEEK_END);
+  } else {
+    frame_log::FileHeader hdr{};
+    std::memcpy(hdr.magic, frame_log::kMagic, sizeof(hdr.magic));
+    hdr.version = frame_log::kVersion;
+    hdr.header_size = sizeof(frame_log::FileHeader);
+    hdr.fx = projection.fx;
+    hdr.fy = projection.fy;
+    hdr.cx = projection.cx;
+    hdr.cy = projection.cy;
+    hdr.camera_height_m = projection.camera_height_m;
+    write(&hdr, sizeof(hdr), 1);
+  }
+}
+
+void FrameLogWriter::truncateTornTail(const std::string& path, std::size_t header_size) {
+  // A crash can leave a partial record at the end. Appending after it would
+  // make the reader either stop there (torn header) or take the next
+  // record's bytes as its features, so cut the file back to the last
+  // complete record first.
+  std::fseek(file_, 0, SEEK_END);
+  const auto length = static_cast<std::size_t>(std::ftell(file_));
+  std::size_t off = header_size;
+  while (off + sizeof(frame_log::RecordHeader) <= length) {
+    frame_log::RecordHeader rh;
+    if (std::fseek(file_, static_cast<long>(off), SEEK_SET) != 0 ||
+        std::fread(&rh, sizeof(rh), 1, file_) != 1 || !completeRecord(rh, off, length)) {
+      break;
+    }
+    off += rh.size;
+  }
+  if (off == length) return;
+  if (::ftruncate(::fileno(file_), static_cast<off_t>(off)) != 0) {
+    const std::string err = std::strerror(errno);
+    std::fclose(file_);
+    file_ = nullptr;
+    throw std::runtime_error("FrameLogWriter: could not truncate " + path + ": " + err);
+  }
+  std::cerr << "Warning: FrameLogWriter: dropped " << (length - off)
+            << " bytes of incomplete record at the end of " << path << std::endl;
+}
+
+FrameLogWriter::~FrameLogWriter() {
+  // Destructors can't throw: a failed final flush is at least reported.
+  if (file_ && std::fclose(file_) != 0) {
+    std::cerr << "Error: FrameLogWriter: final flush failed: " << std::strerror(errno) << std::endl;
+  }
+}
+
+void FrameLogWriter::append(const FrameRecord& rec) {
+  frame_log::RecordHeader hdr{};
+  hdr.num_features = static_cast<std::uint32_t>(rec.features.size());
+  hdr.size = static_cast<std::uint32_t>(sizeof(hdr) + hdr.num_features * sizeof(cv::Point2f));
+  hdr.frame_id = rec.frame_id;
+  hdr.timestamp_ns = rec.timestamp_ns;
+  hdr.roi_x = rec.roi.x;
+  hdr.roi_y = rec.roi.y;
+  hdr.roi_w = rec.roi.width;
+  hdr.roi_h = rec.roi.height;
+  hdr.chosen_u = rec.chosen.x;
+  hdr.chosen_v = rec.chosen.y;
+  hdr.ground_x = rec.ground.x;
+  hdr.ground_z = rec.ground.z;
+  hdr.flags = (rec.has_chosen ? frame_log::kHasChosen : 0u) |
+              (rec.has_ground ? frame_log::kHasGround : 0u);
+
+  write(&hdr, sizeof(hdr), 1);
+  if (!rec.features.empty()) {
+    write(rec.features.data(), sizeof(cv::Point2f), rec.features.size());
+  }
+  ++records_;
+}
+
+void FrameLogWriter::flush() {
+  if (std::fflush(file_) != 0) {
+    throw std::runtime_error("FrameLogWriter: flush failed: " + std::string(std::strerror(errno)));
+  }
+}
+
+void FrameLogWriter::write(const void* data, std::size_t size, std::size_t count) {
+  if (std::fwrite(data, size, count, file_) != count) {
+    throw std::runtime_error("FrameLogWriter: write failed: " + std::string(std::strerror(errno)));
+  }
+}
+std::uint64_t FrameLogWriter::recordsWritten() const { return records_; }
+
+// --- Reader ---
+FrameLogReader::FrameLogReader(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("FrameLogReader: could not open " + path);
+  }
+  struct stat st{};
+  if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(frame_log::FileHeader))) {
+    ::close(fd);
+    throw std::runtime_error("FrameLogReader: " + path + " is too short");
+  }
+  length_ = static_cast<std::size_t>(st.st_size);
+  void* map = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    throw std::runtime_error("FrameLogReader: mmap failed for " + path);
+  }
+  ::madvise(map, length_, MADV_SEQUENTIAL);
+  data_ = static_cast<const unsigned char*>(map);
+
+  frame_log::FileHeader hdr;
+  std::memcpy(&hdr, data_, sizeof(hdr));
+  if (std::memcmp(hdr.magic, frame_log::kMagic, sizeof(hdr.magic)) != 0 ||
+      hdr.version != frame_log::kVersion || hdr.header_size < sizeof(hdr)) {
+    ::munmap(map, length_);
+    throw std::runtime_error("FrameLogReader: " + path + " is not a frame log");
+  }
+  recorded_ = {hdr.fx, hdr.fy, hdr.cx, hdr.cy, hdr.camera_height_m};
+
+  // Index complete records; a torn tail record is silently dropped.
+  std::size_t off = hdr.header_size;
+  while (off + sizeof(frame_log::RecordHeader) <= length_) {
+    frame_log::RecordHeader rh;
+    std::memcpy(&rh, data_ + off, sizeof(rh));
+    if (!completeRecord(rh, off, length_)) break;
+    offsets_.push_back(off);
+    off += rh.size;
+  }
+}
+
+FrameLogReader::~FrameLogReader() {
+  if (data_) ::munmap(const_cast<unsigned char*>(data_), length_);
+}
+
+std::size_t FrameLogReader::size() const { return offsets_.size(); }
+const LogProjection& FrameLogReader::recorded() const { return recorded_; }
+
+FrameView FrameLogReader::at(std::size_t i) const {
+  const unsigned char* base = data_ + offsets_.at(i);
+  frame_log::RecordHeader rh;
+  std::memcpy(&rh, base, sizeof(rh));
+
+  FrameView v;
+  v.frame_id = rh.frame_id;
+  v.timestamp_ns = rh.timestamp_ns;
+  v.roi = cv::Rect(rh.roi_x, rh.roi_y, rh.roi_w, rh.roi_h);
+  v.features = reinterpret_cast<const cv::Point2f*>(base + sizeof(rh));
+  v.num_features = rh.num_features;
+  v.has_chosen = (rh.flags & frame_log::kHasChosen) != 0;
+  v.chosen = {rh.chosen_u, rh.chosen_v};
+  v.has_ground = (rh.flags & frame_log::kHasGround) != 0;
+  v.ground = {rh.ground_x, 0.0f, rh.ground_z};
+  return v;
+}
+
+void FrameLogReader::replay(const std::function<void(const FrameView&)>& fn) const {
+  for (std::size_t i = 0; i < offsets_.size(); ++i) fn(at(i));
+}
+
+void FrameLogReader::reprojectChosen(const LogProjection& proj,
+                                     std::vector<ReprojectedPoint>& out) const {
+  const Intrinsics in = toIntrinsics(proj);
+  out.resize(offsets_.size());
+  for (std::size_t i = 0; i < offsets_.size(); ++i) {
+    const FrameView v = at(i);
+    out[i].frame_id = v.frame_id;
+    out[i].valid = v.has_chosen &&
+                   projectToGround(in, proj.camera_height_m, v.chosen, &out[i].ground);
+  }
+}
+
+void FrameLogReader::reprojectFeatures(std::size_t i, const LogProjection& proj,
+                                       std::vector<cv::Point3f>& out) const {
+  const Intrinsics in = toIntrinsics(proj);
+  const FrameView v = at(i);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  out.resize(v.num_features);
+  for (std::size_t k = 0; k < v.num_features; ++k) {
+    if (!projectToGround(in, proj.camera_height_m, v.features[k], &out[k])) {
+      out[k] = {nan, nan, nan};
+    }
+  }
+}
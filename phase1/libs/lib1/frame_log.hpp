@@ -0,0 +1,201 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @file frame_log.hpp
+ * @brief Compact append-only binary log of per-frame HumanDetector results,
+ *        with an mmap-based reader for replaying downstream stages.
+ *
+ * @details
+ * File layout (little-endian, native float):
+ *   FileHeader   – magic, version and the projection used while recording
+ *   { RecordHeader, Point2f[num_features] } * N
+ *
+ * Each record carries the ROI, the detected features, the chosen point and
+ * its ground coordinates plus a frame id and timestamp. A record whose size
+ * runs past the end of the file (e.g. after a crash) is ignored by the reader.
+ *
+ * The reader maps the whole file and hands out views that point straight into
+ * the mapping, so replaying a log never copies feature data. Because the log
+ * stores raw pixels, the projection stage can be re-run with a different
+ * camera height or intrinsics without touching the original video.
+ */
+
+/**
+ * @brief One frame's worth of intermediate results, as handed to the writer.
+ */
+struct FrameRecord {
+  std::uint64_t frame_id = 0;
+  std::int64_t timestamp_ns = 0;
+  cv::Rect roi{};
+  std::vector<cv::Point2f> features;
+  bool has_chosen = false;
+  cv::Point2f chosen{};
+  bool has_ground = false;
+  cv::Point3f ground{};
+};
+
+/**
+ * @brief Pinhole parameters needed by the flat-ground projection stage.
+ */
+struct LogProjection {
+  float fx = 0.0f;
+  float fy = 0.0f;
+  float cx = 0.0f;
+  float cy = 0.0f;
+  float camera_height_m = 0.0f;
+};
+
+namespace frame_log {
+
+constexpr char kMagic[8] = {'H','D','F','L','O','G','\0','\0'};
+constexpr std::uint32_t kVersion = 1;
+
+enum Flags : std::uint32_t {
+  kHasChosen = 1u << 0,
+  kHasGround = 1u << 1,
+};
+
+struct FileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t header_size;
+  float fx, fy, cx, cy;
+  float camera_height_m;
+  std::uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) == 40, "FileHeader layout changed");
+
+struct RecordHeader {
+  std::uint32_t size;          ///< Total record size in bytes, features included.
+  std::uint32_t num_features;
+  std::uint64_t frame_id;
+  std::int64_t timestamp_ns;
+  std::int32_t roi_x, roi_y, roi_w, roi_h;
+  float chosen_u, chosen_v;
+  float ground_x, ground_z;
+  std::uint32_t flags;
+  std::uint32_t reserved;
+};
+static_assert(sizeof(RecordHeader) == 64, "RecordHeader layout changed");
+static_assert(sizeof(cv::Point2f) == 2 * sizeof(float), "Point2f must be two packed floats");
+
+}  // namespace frame_log
+
+/**
+ * @brief Appends FrameRecords to a log file.
+ *
+ * @details Opens the file in append mode; the file header is written only when
+ *          the file is new/empty. An existing log is only extended if its
+ *          header matches the current projection, so every record in a file
+ *          shares one projection. A partial record left at the end by a
+ *          crash is cut off before appending. Writes go through a large
+ *          stdio buffer so a record costs one memcpy in the common case; a
+ *          failed write (e.g. a full disk) throws instead of leaving a
+ *          silently truncated log.
+ */
+class FrameLogWriter {
+public:
+  /**
+   * @throws std::runtime_error if the file cannot be opened, or exists but is
+   *         not a frame log recorded with the same @p projection.
+   */
+  FrameLogWriter(const std::string& path, const LogProjection& projection);
+  ~FrameLogWriter();
+
+  FrameLogWriter(const FrameLogWriter&) = delete;
+  FrameLogWriter& operator=(const FrameLogWriter&) = delete;
+
+  /** @throws std::runtime_error if the record could not be written. */
+  void append(const FrameRecord& rec);
+  /** @throws std::runtime_error if buffered records could not be written. */
+  void flush();
+  std::uint64_t recordsWritten() const;
+
+private:
+  void write(const void* data, std::size_t size, std::size_t count);
+  void truncateTornTail(const std::string& path, std::size_t header_size);
+
+  std::FILE* file_ = nullptr;
+  std::vector<char> buffer_;
+  std::uint64_t records_ = 0;
+};
+
+/**
+ * @brief Zero-copy view of one record inside a mapped log.
+ */
+struct FrameView {
+  std::uint64_t frame_id = 0;
+  std::int64_t timestamp_ns = 0;
+  cv::Rect roi{};
+  const cv::Point2f* features = nullptr;  ///< Points into the mapping.
+  std::size_t num_features = 0;
+  bool has_chosen = false;
+  cv::Point2f chosen{};
+  bool has_ground = false;
+  cv::Point3f ground{};
+};
+
+/**
+ * @brief Result of re-running the projection on a recorded chosen point.
+ */
+struct ReprojectedPoint {
+  std::uint64_t frame_id = 0;
+  bool valid = false;       ///< False if no point was chosen or v ~= cy.
+  cv::Point3f ground{};
+};
+
+/**
+ * @brief Memory-maps a log written by FrameLogWriter and replays it.
+ */
+class FrameLogReader {
+public:
+  /**
+   * @throws std::runtime_error if the file cannot be mapped or has a bad header.
+   */
+  explicit FrameLogReader(const std::string& path);
+  ~FrameLogReader();
+
+  FrameLogReader(const FrameLogReader&) = delete;
+  FrameLogReader& operator=(const FrameLogReader&) = delete;
+
+  /** @brief Number of complete records in the log. */
+  std::size_t size() const;
+
+  /** @brief Projection stored in the file header at record time. */
+  const LogProjection& recorded() const;
+
+  /** @brief View of record @p i (0-based). */
+  FrameView at(std::size_t i) const;
+
+  /** @brief Invoke @p fn for every record in order. */
+  void replay(const std::function<void(const FrameView&)>& fn) const;
+
+  /**
+   * @brief Re-run the flat-ground projection for every chosen point.
+   *
+   * @param proj New intrinsics and/or camera height.
+   * @param out  Output, resized to size(); reused across calls.
+   */
+  void reprojectChosen(const LogProjection& proj, std::vector<ReprojectedPoint>& out) const;
+
+  /**
+   * @brief Re-run the projection for every feature of record @p i.
+   *
+   * @param out Ground points, one per feature; features at v ~= cy map to NaN.
+   */
+  void reprojectFeatures(std::size_t i, const LogProjection& proj,
+                         std::vector<cv::Point3f>& out) const;
+
+private:
+  const unsigned char* data_ = nullptr;
+  std::size_t length_ = 0;
+  LogProjection recorded_{};
+  std::vector<std::size_t> offsets_;  ///< Byte offset of each complete record.
+};
@@ -0,0 +1,236 @@
+#include "frame_source.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+FrameSource::FrameSource(const std::string& path) : FrameSource(path, Params{}) {}
+
+FrameSource::FrameSource(const std::string& path, const Params& p)
+: path_(path), params_(p) {
+  params_.ring_size = std::max(params_.ring_size, 1);
+  params_.stride = std::max(params_.stride, 1);
+  next_stride_ = params_.stride;
+}
+
+FrameSource::~FrameSource() { stopWorker(); }
+
+bool FrameSource::open() {
+  stopWorker();
+  if (!capture_.open(path_)) {
+    std::cerr << "Error: could not open video file " << path_ << std::endl;
+    return false;
+  }
+  frame_count_ = static_cast<std::int64_t>(capture_.get(cv::CAP_PROP_FRAME_COUNT));
+  fps_ = capture_.get(cv::CAP_PROP_FPS);
+  frame_size_ = cv::Size(static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_WIDTH)),
+                         static_cast<int>(capture_.get(cv::CAP_PROP_FRAME_HEIGHT)));
+
+  index_.clear();
+  keyframes_known_ = false;
+  if (params_.build_index) buildIndex();
+
+  slots_.assign(static_cast<size_t>(params_.ring_size), Slot{});
+  started_ = false;
+  return true;
+}
+
+void FrameSource::buildIndex() {
+  // Scan with a second capture so the decoding one stays at frame 0. Where the
+  // backend supports raw (undecoded) packets, grab() only demuxes and the
+  // keyframe flag of each packet is available.
+  cv::VideoCapture scan(path_);
+  if (!scan.isOpened()) return;
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+  keyframes_known_ = scan.set(cv::CAP_PROP_FORMAT, -1);
+#endif
+  index_.reserve(frame_count_ > 0 ? static_cast<size_t>(frame_count_) : 0);
+  while (scan.grab()) {
+    IndexEntry e;
+    e.timestamp_ms = scan.get(cv::CAP_PROP_POS_MSEC);
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+    if (keyframes_known_) e.keyframe = scan.get(cv::CAP_PROP_LRF_HAS_KEY_FRAME) != 0;
+#endif
+    index_.push_back(e);
+  }
+  if (!index_.empty()) {
+    index_.front().keyframe = true;
+    frame_count_ = static_cast<std::int64_t>(index_.size());
+  }
+}
+
+void FrameSource::setStride(int stride) { next_stride_ = std::max(stride, 1); }
+void FrameSource::setEndFrame(std::int64_t frame_index) { end_frame_ = frame_index; }
+
+bool FrameSource::acquire(Frame& out) {
+  if (!started_) startWorker(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this] { return !filled_.empty() || eof_; });
+  if (filled_.empty()) return false;
+
+  const int s = filled_.front();
+  filled_.erase(filled_.begin());
+  out.slot = s;
+  out.index = slots_[s].index;
+  out.timestamp_ms = slots_[s].timestamp_ms;
+  out.image = &slots_[s].image;
+  return true;
+}
+
+void FrameSource::release(Frame& f) {
+  if (f.slot < 0) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(f.slot);
+  }
+  cv_.notify_all();
+  f = Frame{};
+}
+
+bool FrameSource::seek(std::int64_t frame_index) {
+  if (frame_index < 0 || (frame_count_ > 0 && frame_index >= frame_count_)) return false;
+  stopWorker();
+  return startWorker(frame_index);
+}
+
+bool FrameSource::startWorker(std::int64_t first_frame) {
+  // No worker runs here, so staged settings can be applied without a lock.
+  params_.stride = next_stride_;
+  free_.clear();
+  filled_.clear();
+  for (int i = 0; i < static_cast<int>(slots_.size()); ++i) free_.push_back(i);
+  filled_.reserve(slots_.size());
+  stop_ = false;
+  started_ = true;
+  if (!position(first_frame)) {
+    eof_ = true;  // acquire() returns false until the next successful seek()
+    return false;
+  }
+  eof_ = false;
+  worker_ = std::thread(&FrameSource::run, this, first_frame);
+  return true;
+}
+
+bool FrameSource::position(std::int64_t first_frame) {
+  // Jump to the keyframe, then grab forward up to and including the target,
+  // which run() retrieves as its first frame.
+  std::int64_t idx = keyframeAtOrBefore(first_frame);
+  if (!capture_.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(idx))) {
+    // Some backends can't seek at all; frame 0 is still reachable by reopening.
+    if (idx != 0 || !capture_.open(path_)) {
+      std::cerr << "Error: backend refused to seek to frame " << idx << std::endl;
+      return false;
+    }
+  }
+  for (; idx <= first_frame; ++idx) {
+    if (!capture_.grab()) return false;
+  }
+  if (atIndexedFrame(first_frame)) return true;
+
+  // The backend's POS_FRAMES seek missed: count frames from the start instead.
+  std::cerr << "Warning: inexact seek to frame " << first_frame
+            << ", decoding forward from the start" << std::endl;
+  if (!capture_.open(path_)) return false;
+  for (idx = 0; idx <= first_frame; ++idx) {
+    if (!capture_.grab()) return false;
+  }
+  return true;
+}
+
+bool FrameSource::atIndexedFrame(std::int64_t frame_index) const {
+  if (frame_index >= static_cast<std::int64_t>(index_.size())) return true;  // nothing to check against
+  const double tolerance_ms = fps_ > 0.0 ? 500.0 / fps_ : 1.0;  // half a frame
+  return std::abs(capture_.get(cv::CAP_PROP_POS_MSEC) - index_[frame_index].timestamp_ms) <= tolerance_ms;
+}
+
+void FrameSource::stopWorker() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (worker_.joinable()) worker_.join();
+}
+
+void FrameSource::run(std::int64_t first_frame) {
+  // position() already grabbed first_frame; every later frame needs a grab().
+  std::int64_t idx = first_frame;
+  bool grabbed = true;
+
+  while (idx >= 0 && !stop_) {
+    if (end_frame_ >= 0 && idx >= end_frame_) break;
+
+    int s;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return stop_ || !free_.empty(); });
+      if (stop_) break;
+      s = free_.back();
+      free_.pop_back();
+    }
+
+    Slot& slot = slots_[s];
+    const bool ok = (grabbed || capture_.grab()) && capture_.retrieve(slot.image) &&
+                    !slot.image.empty();
+    grabbed = false;
+    if (ok) {
+      slot.index = idx;
+      slot.timestamp_ms = idx < static_cast<std::int64_t>(index_.size())
+                          ? index_[idx].timestamp_ms
+                          : capture_.get(cv::CAP_PROP_POS_MSEC);
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (ok) filled_.push_back(s);
+      else free_.push_back(s);
+    }
+    cv_.notify_all();
+    if (!ok) break;
+
+    // Skip to the next delivered frame without paying for retrieve().
+    ++idx;
+    for (int k = 1; k < params_.stride && !stop_; ++k, ++idx) {
+      if (!capture_.grab()) { idx = -1; break; }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    eof_ = true;
+  }
+  cv_.notify_all();
+}
+
+std::int64_t FrameSource::frameCount() const { return frame_count_; }
+double FrameSource::fps() const { return fps_; }
+cv::Size FrameSource::frameSize() const { return frame_size_; }
+const std::vector<FrameSource::IndexEntry>& FrameSource::index() const { return index_; }
+
+void FrameSource::setIndex(const std::vector<IndexEntry>& index, bool keyframes_known) {
+  index_ = index;
+  keyframes_known_ = keyframes_known;
+  if (!index_.empty()) frame_count_ = static_cast<std::int64_t>(index_.size());
+}
+
+bool FrameSource::keyframesKnown() const { return keyframes_known_; }
+
+std::vector<std::int64_t> FrameSource::keyframes() const {
+  std::vector<std::int64_t> out;
+  for (size_t i = 0; i < index_.size(); ++i) {
+    if (index_[i].keyframe) out.push_back(static_cast<std::int64_t>(i));
+  }
+  return out;
+}
+
+std::int64_t FrameSource::keyframeAtOrBefore(std::int64_t frame_index) const {
+  if (index_.empty()) return frame_index;
+  const std::int64_t last = static_cast<std::int64_t>(index_.size()) - 1;
+  frame_index = std::min(frame_index, last);
+  // Without keyframe flags, let the backend's own POS_FRAMES seek do the work.
+  if (!keyframes_known_) return frame_index;
+  for (std::int64_t i = frame_index; i > 0; --i) {
+    if (index_[i].keyframe) return i;
+  }
+  return 0;
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+/**
+ * @file frame_source.hpp
+ * @brief Decode-ahead video reader with a reusable frame ring and a seek index.
+ *
+ * @details
+ * A background thread pulls frames from a cv::VideoCapture into a bounded ring
+ * of cv::Mat buffers while the caller processes earlier ones, so decode time
+ * overlaps compute instead of serializing with it. Buffers are recycled: once
+ * warm, decoding reuses their storage.
+ *
+ * With Params::build_index, open() scans the file once (grab only, no
+ * retrieve) to record every frame's timestamp and which frames are keyframes.
+ * seek() then restarts decoding from the nearest keyframe at or before the
+ * target and skips forward with grab(), which is the cheapest random access
+ * the OpenCV backends offer. Where the index has the target's timestamp, the
+ * landing frame is checked against it; if the backend seeked inexactly, the
+ * file is decoded forward from the start instead, so frame numbers stay exact.
+ *
+ * Typical use:
+ * \code{.cpp}
+ *   FrameSource src("video.mp4");
+ *   if (!src.open()) return;
+ *   FrameSource::Frame f;
+ *   while (src.acquire(f)) {
+ *     process(*f.image);
+ *     src.release(f);
+ *   }
+ * \endcode
+ */
+class FrameSource {
+public:
+  struct Params {
+    int  ring_size   = 4;     ///< Number of decoded frames buffered ahead.
+    int  stride      = 1;     ///< Deliver every Nth frame; others are grabbed but not retrieved.
+    bool build_index = true;  ///< Scan the file on open() to build the keyframe/timestamp index.
+  };
+
+  /**
+   * @brief One index entry per frame in the file.
+   */
+  struct IndexEntry {
+    double timestamp_ms = 0.0;
+    bool keyframe = false;
+  };
+
+  /**
+   * @brief A decoded frame pinned in the ring until release().
+   */
+  struct Frame {
+    std::int64_t index = -1;       ///< 0-based frame number in the file.
+    double timestamp_ms = 0.0;     ///< Presentation time reported by the backend.
+    const cv::Mat* image = nullptr;///< Ring buffer; valid until release().
+    int slot = -1;
+  };
+
+  explicit FrameSource(const std::string& path);
+  FrameSource(const std::string& path, const Params& p);
+  ~FrameSource();
+
+  FrameSource(const FrameSource&) = delete;
+  FrameSource& operator=(const FrameSource&) = delete;
+
+  /**
+   * @brief Open the file and optionally build the index.
+   *
+   * @details Decoding starts lazily at frame 0 on the first acquire(), or at
+   *          the requested frame after seek().
+   * @return false if the file cannot be opened.
+   */
+  bool open();
+
+  /**
+   * @brief Change the delivery stride; applies from the next (re)start of decoding
+   *        (the first acquire() or the next seek()).
+   *
+   * @details Call it from the thread that drives acquire()/seek(); the running
+   *          decoder never sees the new value.
+   */
+  void setStride(int stride);
+
+  /**
+   * @brief Block until the next frame is decoded.
+   * @return false at end of stream (or after an explicit stop via the destructor).
+   */
+  bool acquire(Frame& out);
+
+  /**
+   * @brief Hand a frame's buffer back to the decoder.
+   */
+  void release(Frame& f);
+
+  /**
+   * @brief Restart decoding so the next acquire() returns frame @p frame_index.
+   *
+   * @details Positions the decoder before returning (keyframe jump plus grab()
+   *          forward), so a failure is reported here; acquire() then returns
+   *          false until the next successful seek().
+   * @return false if the index is out of range, or the backend refused the
+   *         seek or ran out of frames before reaching @p frame_index.
+   * @pre No frames may be held (all acquired frames released).
+   */
+  bool seek(std::int64_t frame_index);
+
+  /**
+   * @brief Stop delivering frames once @p frame_index (exclusive) is reached.
+   *        Negative means "until end of file".
+   */
+  void setEndFrame(std::int64_t frame_index);
+
+  std::int64_t frameCount() const;
+  double fps() const;
+  cv::Size frameSize() const;
+
+  /** @brief Per-frame index; empty unless Params::build_index was set. */
+  const std::vector<IndexEntry>& index() const;
+
+  /**
+   * @brief Adopt an index built by another FrameSource on the same file.
+   *
+   * @details Lets several readers share one scan: open this one with
+   *          Params::build_index off, then call setIndex() before the first
+   *          acquire()/seek(). seek() and frame timestamps then use @p index
+   *          exactly as if this source had built it.
+   */
+  void setIndex(const std::vector<IndexEntry>& index, bool keyframes_known);
+
+  /** @brief Frame numbers of all keyframes (from the index). */
+  std::vector<std::int64_t> keyframes() const;
+
+  /**
+   * @brief True if the backend reported per-frame keyframe flags.
+   * @note Otherwise keyframes() holds only frame 0 and any frame is a seek target.
+   */
+  bool keyframesKnown() const;
+
+  /**
+   * @brief Nearest keyframe at or before @p frame_index.
+   * @note Returns @p frame_index itself when the backend did not report keyframes.
+   */
+  std::int64_t keyframeAtOrBefore(std::int64_t frame_index) const;
+
+private:
+  struct Slot {
+    cv::Mat image;
+    std::int64_t index = -1;
+    double timestamp_ms = 0.0;
+  };
+
+  void buildIndex();
+  bool startWorker(std::int64_t first_frame);
+  void stopWorker();
+  bool position(std::int64_t first_frame);
+  bool atIndexedFrame(std::int64_t frame_index) const;
+  void run(std::int64_t first_frame);
+
+  std::string path_;
+  Params params_;            ///< params_.stride is only written while no worker runs.
+  int next_stride_ = 1;      ///< Staged by setStride(), applied by startWorker().
+  cv::VideoCapture capture_;
+  std::int64_t frame_count_ = 0;
+  double fps_ = 0.0;
+  cv::Size frame_size_{};
+  std::vector<IndexEntry> index_;
+  bool keyframes_known_ = false;
+  std::atomic<std::int64_t> end_frame_{-1};
+  bool started_ = false;
+
+  // ---- Ring: slots cycle free -> filled (FIFO) -> held -> free ----
+  std::vector<Slot> slots_;
+  std::vector<int> free_;
+  std::vector<int> filled_;   ///< FIFO of decoded slots, oldest first.
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool eof_ = false;
+  std::atomic<bool> stop_{false};
+  std::thread worker_;
+};
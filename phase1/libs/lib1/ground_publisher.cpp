@@ -0,0 +1,237 @@
+#include "ground_publisher.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ground_shm {
+
+ZoneState classify(const cv::Point3f* pts, std::size_t n, const ZoneThresholds& zone) {
+  ZoneState state = ZoneState::CLEAR;
+  for (std::size_t i = 0; i < n; ++i) {
+    const float r = std::sqrt(pts[i].x * pts[i].x + pts[i].z * pts[i].z);
+    if (std::isnan(r)) continue;
+    if (r <= zone.D_close_m) return ZoneState::CLOSE;
+    if (r <= zone.D_max_m) state = ZoneState::WATCH;
+  }
+  return state;
+}
+
+}  // namespace ground_shm
+
+namespace {
+
+std::size_t segmentLength(std::uint32_t capacity) {
+  return sizeof(ground_shm::Header) + capacity * sizeof(ground_shm::Record);
+}
+
+}  // namespace
+
+// --- Publisher ---
+GroundPublisher::GroundPublisher(const std::string& name, std::uint32_t capacity,
+                                 bool unlink_on_close)
+: name_(name), unlink_on_close_(unlink_on_close) {
+  if (capacity == 0) throw std::invalid_argument("GroundPublisher: capacity must be > 0");
+  length_ = segmentLength(capacity);
+
+  const int fd = ::shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+  if (fd < 0) throw std::runtime_error("GroundPublisher: shm_open failed for " + name_);
+  struct stat st{};
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw std::runtime_error("GroundPublisher: fstat failed for " + name_);
+  }
+  // Never shrink: readers of a previous publisher may still map the old length.
+  const std::size_t existing = static_cast<std::size_t>(st.st_size);
+  if (existing < length_ && ::ftruncate(fd, static_cast<off_t>(length_)) != 0) {
+    ::close(fd);
+    throw std::runtime_error("GroundPublisher: ftruncate failed for " + name_);
+  }
+  length_ = std::max(length_, existing);
+  void* map = ::mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) throw std::runtime_error("GroundPublisher: mmap failed for " + name_);
+
+  header_ = static_cast<ground_shm::Header*>(map);
+  records_ = reinterpret_cast<ground_shm::Record*>(static_cast<char*>(map) + sizeof(ground_shm::Header));
+
+  const bool reused = existing >= sizeof(ground_shm::Header) &&
+                      header_->magic == ground_shm::kMagic &&
+                      header_->version == ground_shm::kVersion;
+  if (reused) {
+    // Live readers may be polling: restart the sequence, then announce the new
+    // epoch last so a reader that sees it also sees the reset ring.
+    const std::uint64_t epoch = header_->epoch.load(std::memory_order_relaxed) + 1;
+    header_->head.store(0, std::memory_order_relaxed);
+    for (std::uint32_t i = 0; i < capacity; ++i) {
+      records_[i].seq.store(0, std::memory_order_relaxed);
+    }
+    header_->capacity = capacity;
+    header_->epoch.store(epoch, std::memory_order_release);
+    return;
+  }
+
+  // Fresh (or foreign) segment. Readers validate the magic last, so publish it
+  // after everything else.
+  header_->magic = 0;
+  header_->version = ground_shm::kVersion;
+  header_->capacity = capacity;
+  header_->record_size = sizeof(ground_shm::Record);
+  new (&header_->head) std::atomic<std::uint64_t>(0);
+  new (&header_->epoch) std::atomic<std::uint64_t>(1);
+  for (std::uint32_t i = 0; i < capacity; ++i) {
+    new (&records_[i].seq) std::atomic<std::uint64_t>(0);
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  header_->magic = ground_shm::kMagic;
+}
+
+GroundPublisher::~GroundPublisher() {
+  if (header_) ::munmap(header_, length_);
+  if (unlink_on_close_) ::shm_unlink(name_.c_str());
+}
+
+std::uint64_t GroundPublisher::publish(std::uint64_t frame_id, std::int64_t timestamp_ns,
+                                       const std::vector<cv::Point3f>& ground,
+                                       ground_shm::ZoneState zone) {
+  return publish(frame_id, timestamp_ns, ground.data(), ground.size(), zone);
+}
+
+std::uint64_t GroundPublisher::publish(std::uint64_t frame_id, std::int64_t timestamp_ns,
+                                       const cv::Point3f* ground, std::size_t num_ground,
+                                       ground_shm::ZoneState zone) {
+  const std::uint64_t n = next_++;
+  ground_shm::Record& r = records_[n % header_->capacity];
+
+  r.seq.store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  r.frame_id = frame_id;
+  r.timestamp_ns = timestamp_ns;
+  r.zone = static_cast<std::uint32_t>(zone);
+  const std::size_t count = std::min<std::size_t>(num_ground, ground_shm::kMaxPoints);
+  r.num_points = static_cast<std::uint32_t>(count);
+  for (std::size_t i = 0; i < count; ++i) r.points[i] = {ground[i].x, ground[i].z};
+
+  r.seq.store(2 * n + 2, std::memory_order_release);
+  header_->head.store(n + 1, std::memory_order_release);
+  return n;
+}
+
+const std::string& GroundPublisher::name() const { return name_; }
+
+// --- Subscriber ---
+GroundSubscriber::GroundSubscriber(const std::string& name) : name_(name) {
+  map();
+  epoch_ = header_->epoch.load(std::memory_order_acquire);
+  cursor_ = published();
+}
+
+GroundSubscriber::~GroundSubscriber() { unmap(); }
+
+void GroundSubscriber::map() {
+  const int fd = ::shm_open(name_.c_str(), O_RDONLY, 0);
+  if (fd < 0) throw std::runtime_error("GroundSubscriber: no segment named " + name_);
+  struct stat st{};
+  if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ground_shm::Header))) {
+    ::close(fd);
+    throw std::runtime_error("GroundSubscriber: segment " + name_ + " is too short");
+  }
+  length_ = static_cast<std::size_t>(st.st_size);
+  void* map = ::mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) throw std::runtime_error("GroundSubscriber: mmap failed for " + name_);
+
+  header_ = static_cast<const ground_shm::Header*>(map);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header_->magic != ground_shm::kMagic || header_->version != ground_shm::kVersion ||
+      header_->record_size != sizeof(ground_shm::Record) ||
+      length_ < segmentLength(header_->capacity)) {
+    unmap();
+    throw std::runtime_error("GroundSubscriber: segment " + name_ + " has an unexpected layout");
+  }
+  capacity_ = header_->capacity;
+  records_ = reinterpret_cast<const ground_shm::Record*>(
+      reinterpret_cast<const char*>(header_) + sizeof(ground_shm::Header));
+}
+
+void GroundSubscriber::unmap() {
+  if (header_) ::munmap(const_cast<ground_shm::Header*>(header_), length_);
+  header_ = nullptr;
+  records_ = nullptr;
+}
+
+void GroundSubscriber::resync() {
+  const std::uint64_t epoch = header_->epoch.load(std::memory_order_acquire);
+  if (epoch == epoch_) return;
+  // A new publisher re-initialized the segment: its capacity may have changed
+  // (and the segment grown past our mapping) and its sequence restarted.
+  if (segmentLength(header_->capacity) > length_) {
+    unmap();
+    map();
+  } else {
+    capacity_ = header_->capacity;
+  }
+  // Read the new epoch from its first record; next() counts anything
+  // already overwritten as dropped.
+  epoch_ = epoch;
+  cursor_ = 0;
+}
+
+std::uint64_t GroundSubscriber::published() const {
+  return header_->head.load(std::memory_order_acquire);
+}
+
+std::uint64_t GroundSubscriber::dropped() const { return dropped_; }
+
+bool GroundSubscriber::read(std::uint64_t n, GroundSample& out) const {
+  const ground_shm::Record& r = records_[n % capacity_];
+  const std::uint64_t done = 2 * n + 2;
+  for (;;) {
+    const std::uint64_t s1 = r.seq.load(std::memory_order_acquire);
+    if (s1 != done) return false;  // overwritten by a newer record (or not yet written)
+    out.sequence = n;
+    out.frame_id = r.frame_id;
+    out.timestamp_ns = r.timestamp_ns;
+    out.zone = static_cast<ground_shm::ZoneState>(r.zone);
+    out.num_points = std::min<std::uint32_t>(r.num_points, ground_shm::kMaxPoints);
+    std::memcpy(out.points, r.points, out.num_points * sizeof(ground_shm::GroundPoint));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (r.seq.load(std::memory_order_relaxed) == s1) return true;
+  }
+}
+
+bool GroundSubscriber::latest(GroundSample& out) {
+  for (;;) {
+    resync();
+    const std::uint64_t head = published();
+    if (head == 0) return false;
+    if (read(head - 1, out)) return true;
+  }
+}
+
+bool GroundSubscriber::next(GroundSample& out) {
+  for (;;) {
+    resync();
+    const std::uint64_t head = published();
+    if (cursor_ >= head) return false;
+    if (head - cursor_ > capacity_) {
+      dropped_ += head - cursor_ - capacity_;
+      cursor_ = head - capacity_;
+    }
+    if (read(cursor_, out)) {
+      ++cursor_;
+      return true;
+    }
+    // Slot was recycled while we looked at it: we are a full ring behind.
+    ++dropped_;
+    ++cursor_;
+  }
+}
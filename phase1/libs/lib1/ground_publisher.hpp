@@ -0,0 +1,192 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "zone_thresholds.hpp"
+
+/**
+ * @file ground_publisher.hpp
+ * @brief Zero-copy publication of per-frame ground detections through a
+ *        single-producer ring buffer in POSIX shared memory.
+ *
+ * @details
+ * Layout of the shared segment:
+ *   Header { magic, version, capacity, record_size, head, epoch }
+ *   Record[capacity]
+ *
+ * The producer writes record n into slot n % capacity using a per-record
+ * sequence counter as a seqlock: the counter is odd while the slot is being
+ * written and equals 2n+2 once record n is complete. `head` is then bumped to
+ * n+1. Readers in other processes map the segment read-only and poll `head`;
+ * no syscalls, locks or serialization are involved after the initial mmap.
+ * A reader that falls more than `capacity` records behind skips ahead and is
+ * told how many records it missed.
+ *
+ * A publisher that finds the segment already there (a restart after a crash,
+ * or unlink_on_close = false) reuses it without ever shrinking it, because
+ * live readers may still map the old length. It restarts `head` at 0 and bumps
+ * `epoch`; readers notice the new epoch on their next call, re-read the
+ * capacity (remapping if the segment grew) and read from the start of the
+ * new epoch.
+ */
+namespace ground_shm {
+
+constexpr std::uint32_t kMagic = 0x444E5247;  // "GRND"
+constexpr std::uint32_t kVersion = 2;
+constexpr int kMaxPoints = 64;                 ///< Ground points per record.
+
+/**
+ * @brief Coarse proximity state of a frame's ground points.
+ */
+enum class ZoneState : std::uint32_t {
+  CLEAR = 0,  ///< Nothing within D_max.
+  WATCH = 1,  ///< Something within D_max but outside D_close.
+  CLOSE = 2,  ///< Something within D_close.
+};
+
+struct GroundPoint {
+  float x;
+  float z;
+};
+
+struct alignas(64) Record {
+  std::atomic<std::uint64_t> seq;  ///< Seqlock; 2n+2 when record n is complete.
+  std::uint64_t frame_id;
+  std::int64_t timestamp_ns;
+  std::uint32_t zone;              ///< ZoneState.
+  std::uint32_t num_points;
+  GroundPoint points[kMaxPoints];
+};
+
+struct alignas(64) Header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t capacity;
+  std::uint32_t record_size;
+  alignas(64) std::atomic<std::uint64_t> head;  ///< Records published so far.
+  std::atomic<std::uint64_t> epoch;             ///< Bumped each time a publisher (re)initializes the segment.
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "shared-memory ring needs address-free 64-bit atomics");
+
+/**
+ * @brief Classify ground points by range sqrt(X^2 + Z^2); NaN points are ignored.
+ */
+ZoneState classify(const cv::Point3f* pts, std::size_t n, const ZoneThresholds& zone);
+
+}  // namespace ground_shm
+
+/**
+ * @brief One record as copied out by GroundSubscriber.
+ */
+struct GroundSample {
+  std::uint64_t sequence = 0;        ///< Publisher's record number (0-based).
+  std::uint64_t frame_id = 0;
+  std::int64_t timestamp_ns = 0;
+  ground_shm::ZoneState zone = ground_shm::ZoneState::CLEAR;
+  std::uint32_t num_points = 0;
+  ground_shm::GroundPoint points[ground_shm::kMaxPoints];
+};
+
+/**
+ * @brief Producer side. Creates the named segment, or reuses and re-initializes it.
+ */
+class GroundPublisher {
+public:
+  /**
+   * @param name     POSIX shm name, e.g. "/hd_ground".
+   * @param capacity Ring length in records.
+   * @param unlink_on_close Remove the segment name in the destructor.
+   * @throws std::runtime_error if the segment cannot be created or mapped.
+   */
+  GroundPublisher(const std::string& name, std::uint32_t capacity = 256,
+                  bool unlink_on_close = true);
+  ~GroundPublisher();
+
+  GroundPublisher(const GroundPublisher&) = delete;
+  GroundPublisher& operator=(const GroundPublisher&) = delete;
+
+  /**
+   * @brief Publish one frame. Points beyond kMaxPoints are dropped.
+   * @return Record number assigned to this frame.
+   */
+  std::uint64_t publish(std::uint64_t frame_id, std::int64_t timestamp_ns,
+                        const std::vector<cv::Point3f>& ground,
+                        ground_shm::ZoneState zone);
+
+  /**
+   * @brief Same, for @p n points at @p ground (e.g. a std::pmr::vector's data()).
+   */
+  std::uint64_t publish(std::uint64_t frame_id, std::int64_t timestamp_ns,
+                        const cv::Point3f* ground, std::size_t n,
+                        ground_shm::ZoneState zone);
+
+  const std::string& name() const;
+
+private:
+  std::string name_;
+  bool unlink_on_close_;
+  std::size_t length_ = 0;
+  ground_shm::Header* header_ = nullptr;
+  ground_shm::Record* records_ = nullptr;
+  std::uint64_t next_ = 0;
+};
+
+/**
+ * @brief Consumer side. Maps an existing segment read-only and polls it.
+ */
+class GroundSubscriber {
+public:
+  /**
+   * @throws std::runtime_error if the segment is missing or has a bad header.
+   */
+  explicit GroundSubscriber(const std::string& name);
+  ~GroundSubscriber();
+
+  GroundSubscriber(const GroundSubscriber&) = delete;
+  GroundSubscriber& operator=(const GroundSubscriber&) = delete;
+
+  /** @brief Number of records published so far. */
+  std::uint64_t published() const;
+
+  /**
+   * @brief Copy the most recent complete record.
+   * @return false if nothing was published yet (in the current epoch).
+   * @throws std::runtime_error if a re-initialized segment grew and can no
+   *         longer be remapped.
+   */
+  bool latest(GroundSample& out);
+
+  /**
+   * @brief Copy the next unread record, in order.
+   *
+   * @details After a publisher restart the cursor moves to the first record
+   *          of the new epoch; records of the old epoch that were never read
+   *          are not counted as dropped.
+   * @return false if the reader is caught up.
+   * @throws std::runtime_error as latest().
+   */
+  bool next(GroundSample& out);
+
+  /** @brief Records skipped because the reader fell more than a ring behind. */
+  std::uint64_t dropped() const;
+
+private:
+  bool read(std::uint64_t n, GroundSample& out) const;
+  void map();
+  void unmap();
+  void resync();
+
+  std::string name_;
+  std::size_t length_ = 0;
+  const ground_shm::Header* header_ = nullptr;
+  const ground_shm::Record* records_ = nullptr;
+  std::uint32_t capacity_ = 0;
+  std::uint64_t epoch_ = 0;   ///< Publisher epoch the cursor belongs to.
+  std::uint64_t cursor_ = 0;
+  std::uint64_t dropped_ = 0;
+};
@@ -0,0 +1,223 @@
+#include "ground_tracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+GroundTracker::GroundTracker() : GroundTracker(Params{}) {}
+
+GroundTracker::GroundTracker(const Params& p) : params_(p) {
+  if (params_.max_tracks < 1) {
+    throw std::invalid_argument("GroundTracker: max_tracks must be >= 1");
+  }
+  if (params_.gate_m <= 0.0f) {
+    throw std::invalid_argument("GroundTracker: gate_m must be > 0");
+  }
+  meas_var_ = params_.meas_std_m * params_.meas_std_m;
+  init_vel_var_ = params_.init_vel_std * params_.init_vel_std;
+  accel_var_ = params_.accel_std * params_.accel_std;
+
+  const auto n = static_cast<size_t>(params_.max_tracks);
+  x_.assign(n, 0.0f);  z_.assign(n, 0.0f);
+  vx_.assign(n, 0.0f); vz_.assign(n, 0.0f);
+  pa_.assign(n, 0.0f); pb_.assign(n, 0.0f); pc_.assign(n, 0.0f);
+  id_.assign(n, 0);
+  hits_.assign(n, 0);  misses_.assign(n, 0);
+  alive_.assign(n, 0); matched_.assign(n, 0);
+  free_.reserve(n);
+
+  int buckets = 1;
+  while (buckets < std::max(params_.grid_buckets, 1)) buckets <<= 1;
+  bucket_mask_ = buckets - 1;
+  bucket_head_.assign(static_cast<size_t>(buckets), -1);
+  bucket_next_.assign(n, -1);
+
+  det_track_.reserve(2 * n);
+  tracks_.reserve(n);
+  reset();
+}
+
+void GroundTracker::reset() {
+  free_.clear();
+  for (int i = params_.max_tracks - 1; i >= 0; --i) {
+    alive_[i] = 0;
+    free_.push_back(i);
+  }
+  live_ = 0;
+  tracks_.clear();
+}
+
+int GroundTracker::allocate() {
+  if (free_.empty()) return -1;
+  const int i = free_.back();
+  free_.pop_back();
+  alive_[i] = 1;
+  ++live_;
+  return i;
+}
+
+void GroundTracker::release(int i) {
+  alive_[i] = 0;
+  free_.push_back(i);
+  --live_;
+}
+
+void GroundTracker::update(const std::vector<cv::Point3f>& detections, float dt) {
+  if (dt > 0.0f) predict(dt);
+  buildGrid();
+
+  const int n = params_.max_tracks;
+  std::fill(matched_.begin(), matched_.end(), 0);
+  det_track_.assign(detections.size(), -1);
+
+  // ---- Gated nearest-neighbour association through the grid ----
+  const float gate2 = params_.gate_m * params_.gate_m;
+  for (size_t d = 0; d < detections.size(); ++d) {
+    const float mx = detections[d].x;
+    const float mz = detections[d].z;
+    // Horizon points come back from projectToGround() as NaN: never match or spawn them.
+    if (!std::isfinite(mx) || !std::isfinite(mz)) {
+      det_track_[d] = kSkipped;
+      continue;
+    }
+    const int cx = cellOf(mx);
+    const int cz = cellOf(mz);
+    float best_d2 = gate2;
+    int best = -1;
+    for (int oz = -1; oz <= 1; ++oz) {
+      for (int ox = -1; ox <= 1; ++ox) {
+        for (int i = bucket_head_[bucketOf(cx + ox, cz + oz)]; i >= 0; i = bucket_next_[i]) {
+          if (matched_[i]) continue;
+          const float dx = x_[i] - mx, dz = z_[i] - mz;
+          const float d2 = dx*dx + dz*dz;
+          if (d2 < best_d2) { best_d2 = d2; best = i; }
+        }
+      }
+    }
+    if (best >= 0) {
+      matched_[best] = 1;
+      det_track_[d] = best;
+    }
+  }
+
+  // ---- Correct matched tracks, age the rest ----
+  for (size_t d = 0; d < detections.size(); ++d) {
+    const int i = det_track_[d];
+    if (i >= 0) correct(i, detections[d].x, detections[d].z);
+  }
+  for (int i = 0; i < n; ++i) {
+    if (!alive_[i] || matched_[i]) continue;
+    ++misses_[i];
+    const bool confirmed = hits_[i] >= params_.confirm_hits;
+    if (!confirmed || misses_[i] > params_.max_misses) release(i);
+  }
+
+  // ---- Spawn tracks for unmatched detections ----
+  for (size_t d = 0; d < detections.size(); ++d) {
+    if (det_track_[d] != -1) continue;
+    const int i = allocate();
+    if (i < 0) break;
+    x_[i] = detections[d].x;
+    z_[i] = detections[d].z;
+    vx_[i] = 0.0f;
+    vz_[i] = 0.0f;
+    pa_[i] = meas_var_;
+    pb_[i] = 0.0f;
+    pc_[i] = init_vel_var_;
+    id_[i] = next_id_++;
+    hits_[i] = 1;
+    misses_[i] = 0;
+  }
+
+  publish();
+}
+
+void GroundTracker::predict(float dt) {
+  // x' = F x, P' = F P F^T + Q with F = [1 dt; 0 1] and
+  // Q = q [dt^4/4 dt^3/2; dt^3/2 dt^2] (white acceleration noise).
+  const float dt2 = dt * dt;
+  const float q_a = accel_var_ * dt2 * dt2 * 0.25f;
+  const float q_b = accel_var_ * dt2 * dt * 0.5f;
+  const float q_c = accel_var_ * dt2;
+  for (int i = 0; i < params_.max_tracks; ++i) {
+    if (!alive_[i]) continue;
+    x_[i] += vx_[i] * dt;
+    z_[i] += vz_[i] * dt;
+    const float a = pa_[i], b = pb_[i], c = pc_[i];
+    pa_[i] = a + 2.0f * dt * b + dt2 * c + q_a;
+    pb_[i] = b + dt * c + q_b;
+    pc_[i] = c + q_c;
+  }
+}
+
+void GroundTracker::correct(int i, float mx, float mz) {
+  // H = [1 0]: S = a + r, K = [a b]^T / S, P' = (I - K H) P.
+  const float a = pa_[i], b = pb_[i], c = pc_[i];
+  const float s = a + meas_var_;
+  const float k0 = a / s;
+  const float k1 = b / s;
+  const float ex = mx - x_[i];
+  const float ez = mz - z_[i];
+  x_[i] += k0 * ex;
+  z_[i] += k0 * ez;
+  vx_[i] += k1 * ex;
+  vz_[i] += k1 * ez;
+  pa_[i] = (1.0f - k0) * a;
+  pb_[i] = (1.0f - k0) * b;
+  pc_[i] = c - k1 * b;
+  ++hits_[i];
+  misses_[i] = 0;
+}
+
+int GroundTracker::cellOf(float v) const {
+  // Clamped so far-away (finite) points can't overflow the int conversion.
+  constexpr float kMaxCell = 1 << 30;
+  return static_cast<int>(std::clamp(std::floor(v / params_.gate_m), -kMaxCell, kMaxCell));
+}
+
+int GroundTracker::bucketOf(int cx, int cz) const {
+  const auto h = static_cast<std::uint32_t>(cx) * 73856093u ^
+                 static_cast<std::uint32_t>(cz) * 19349663u;
+  return static_cast<int>(h & static_cast<std::uint32_t>(bucket_mask_));
+}
+
+void GroundTracker::buildGrid() {
+  std::fill(bucket_head_.begin(), bucket_head_.end(), -1);
+  for (int i = 0; i < params_.max_tracks; ++i) {
+    if (!alive_[i]) continue;
+    const int b = bucketOf(cellOf(x_[i]), cellOf(z_[i]));
+    bucket_next_[i] = bucket_head_[b];
+    bucket_head_[b] = i;
+  }
+}
+
+void GroundTracker::publish() {
+  tracks_.clear();
+  for (int i = 0; i < params_.max_tracks; ++i) {
+    if (!alive_[i]) continue;
+    Track t;
+    t.id = id_[i];
+    t.position = {x_[i], z_[i]};
+    t.velocity = {vx_[i], vz_[i]};
+    t.range_m = std::sqrt(x_[i]*x_[i] + z_[i]*z_[i]);
+    t.hits = hits_[i];
+    t.misses = misses_[i];
+    t.confirmed = hits_[i] >= params_.confirm_hits;
+
+    // Time until the range shrinks to D_close at the current radial speed.
+    if (t.range_m <= params_.zone.D_close_m) {
+      t.time_to_close_s = 0.0f;
+    } else {
+      const float range_rate = (x_[i]*vx_[i] + z_[i]*vz_[i]) / t.range_m;
+      t.time_to_close_s = range_rate < -1e-6f
+          ? (t.range_m - params_.zone.D_close_m) / -range_rate
+          : std::numeric_limits<float>::infinity();
+    }
+    tracks_.push_back(t);
+  }
+}
+
+const std::vector<GroundTracker::Track>& GroundTracker::tracks() const { return tracks_; }
+int GroundTracker::size() const { return live_; }
+const GroundTracker::Params& GroundTracker::params() const { return params_; }
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "zone_thresholds.hpp"
+
+/**
+ * @file ground_tracker.hpp
+ * @brief Multi-target tracker that turns per-frame ground detections (X,0,Z)
+ *        into persistent, smoothed tracks.
+ *
+ * @details
+ * Each track carries a constant-velocity Kalman filter over the ground plane
+ * state (X, Z, Vx, Vz). Because both axes share the same motion and measurement
+ * noise and are always updated together, their 2x2 covariances stay identical,
+ * so a single (a, b, c) covariance triple is stored per track.
+ *
+ * Per frame:
+ *   1) predict every live track by dt,
+ *   2) bucket the predicted tracks into a spatial hash grid (cell = gate size),
+ *   3) associate each detection with the nearest free track in the 3x3
+ *      neighbouring cells that lies within the gate,
+ *   4) correct matched tracks, spawn tracks for unmatched detections and
+ *      retire tracks that missed too many frames.
+ *
+ * Track state lives in a fixed-capacity structure-of-arrays pool with a free
+ * list, so creating and deleting tracks never allocates after construction.
+ */
+class GroundTracker {
+public:
+  /**
+   * @brief Tunable parameters for association, filtering and track lifetime.
+   */
+  struct Params {
+    int   max_tracks     = 64;    ///< Pool capacity (maximum simultaneous tracks).
+    float gate_m         = 0.5f;  ///< Association gate radius and grid cell size (m).
+    float accel_std      = 1.0f;  ///< Process noise: white acceleration std-dev (m/s^2).
+    float meas_std_m     = 0.05f; ///< Measurement noise std-dev on X and Z (m).
+    float init_vel_std   = 1.0f;  ///< Initial velocity std-dev for new tracks (m/s).
+    int   confirm_hits   = 3;     ///< Hits needed before a track is reported as confirmed.
+    int   max_misses     = 5;     ///< Consecutive misses after which a confirmed track is dropped.
+    ZoneThresholds zone;          ///< zone.D_close_m is the time-to-close target range.
+    int   grid_buckets   = 256;   ///< Number of spatial hash buckets (rounded up to a power of two).
+  };
+
+  /**
+   * @brief Read-only view of one track after the latest update.
+   */
+  struct Track {
+    std::uint32_t id = 0;          ///< Unique, monotonically increasing track id.
+    cv::Point2f position{};        ///< Smoothed (X, Z) on the ground plane (m).
+    cv::Point2f velocity{};        ///< Estimated (Vx, Vz) (m/s).
+    float range_m = 0.0f;          ///< Distance from the camera, sqrt(X^2 + Z^2) (m).
+    float time_to_close_s = 0.0f;  ///< Time until range reaches zone.D_close_m; +inf if not closing.
+    int hits = 0;                  ///< Number of associated detections.
+    int misses = 0;                ///< Consecutive frames without a detection.
+    bool confirmed = false;        ///< True once hits >= confirm_hits.
+  };
+
+  GroundTracker();
+  explicit GroundTracker(const Params& p);
+
+  /**
+   * @brief Advance all tracks by @p dt and fold in this frame's detections.
+   *
+   * @param detections Ground points (X,0,Z) from pixelToGround(); Y is ignored.
+   *                   Non-finite points (projectToGround()'s horizon NaNs) are skipped.
+   * @param dt         Time since the previous update (s). Values <= 0 skip prediction.
+   */
+  void update(const std::vector<cv::Point3f>& detections, float dt);
+
+  /**
+   * @brief Tracks alive after the latest update (tentative and confirmed).
+   */
+  const std::vector<Track>& tracks() const;
+
+  /**
+   * @brief Number of live tracks in the pool.
+   */
+  int size() const;
+
+  /**
+   * @brief Drop every track and return all slots to the free list.
+   */
+  void reset();
+
+  const Params& params() const;
+
+private:
+  static constexpr int kSkipped = -2;  ///< det_track_ value of a non-finite detection.
+
+  int allocate();
+  void release(int i);
+  void predict(float dt);
+  void correct(int i, float mx, float mz);
+  void buildGrid();
+  int bucketOf(int cx, int cz) const;
+  int cellOf(float v) const;
+  void publish();
+
+  Params params_;
+  float meas_var_;
+  float init_vel_var_;
+  float accel_var_;
+  std::uint32_t next_id_ = 1;
+  int live_ = 0;
+
+  // ---- Structure-of-arrays track pool (size == max_tracks) ----
+  std::vector<float> x_, z_, vx_, vz_;  ///< State estimate.
+  std::vector<float> pa_, pb_, pc_;     ///< Shared per-axis covariance [a b; b c].
+  std::vector<std::uint32_t> id_;
+  std::vector<int> hits_, misses_;
+  std::vector<std::uint8_t> alive_;
+  std::vector<std::uint8_t> matched_;   ///< Scratch: matched during this update.
+  std::vector<int> free_;               ///< Stack of free slot indices.
+
+  // ---- Spatial hash grid (intrusive linked lists, no allocation) ----
+  std::vector<int> bucket_head_;
+  std::vector<int> bucket_next_;
+  int bucket_mask_ = 0;
+
+  std::vector<int> det_track_;          ///< Scratch: track index per detection, -1 or kSkipped.
+  std::vector<Track> tracks_;           ///< Output view, rebuilt by publish().
+};
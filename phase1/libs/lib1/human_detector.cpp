@@ -1,6 +1,7 @@
 #include "human_detector.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <stdexcept>
@@ -9,15 +10,62 @@
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
+namespace {
+
+TiledCornerDetector::Params tiledParams(const HumanDetector::Params& p) {
+  TiledCornerDetector::Params t;
+  t.tiles_x = p.tiles_x;
+  t.tiles_y = p.tiles_y;
+  t.corners_per_tile = p.corners_per_tile;
+  t.quality_level = p.quality_level;
+  t.min_distance = p.min_distance;
+  t.block_size = p.block_size;
+  t.use_harris = p.use_harris;
+  return t;
+}
+
+MotionGate::Params motionParams(const HumanDetector::Params& p) {
+  MotionGate::Params m;
+  m.block_size = p.motion_block_size;
+  m.diff_threshold = p.motion_threshold;
+  return m;
+}
+
+// Native-pixel rectangle -> covering rectangle at processing scale @p s.
+cv::Rect scaleRect(const cv::Rect& r, double s) {
+  const int x0 = static_cast<int>(std::floor(r.x * s));
+  const int y0 = static_cast<int>(std::floor(r.y * s));
+  const int x1 = static_cast<int>(std::ceil((r.x + r.width) * s));
+  const int y1 = static_cast<int>(std::ceil((r.y + r.height) * s));
+  return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+MultiRoiDetector::Params multiParams(const HumanDetector::Params& p) {
+  MultiRoiDetector::Params m;
+  m.max_corners = p.max_corners;
+  m.quality_level = p.quality_level;
+  m.min_distance = p.min_distance;
+  m.block_size = p.block_size;
+  m.use_harris = p.use_harris;
+  return m;
+}
+
+}  // namespace
+
 // Base must be initialized explicitly
 HumanDetector::HumanDetector(const std::string& window_name,
     const std::string& intrinsics_path)
 : CameraModel(intrinsics_path),  
 window_name_(window_name),
-params_(Params{}) {
+params_(Params{}),
+tiled_(tiledParams(params_)),
+multi_(multiParams(params_)),
+motion_(motionParams(params_)) {
 CV_Assert(!K_mat.empty());
 CV_Assert(K_mat.type() == CV_32F && K_mat.rows == 3 && K_mat.cols == 3);
-cv::namedWindow(window_name_);
+syncIntrinsics();
+setProcessingScale(params_.processing_scale);
+if (params_.show_window) cv::namedWindow(window_name_);
 }
 
 HumanDetector::HumanDetector(const std::string& window_name,
@@ -25,96 +73,203 @@ HumanDetector::HumanDetector(const std::string& window_name,
     const Params& p)
 : CameraModel(intrinsics_path),  
 window_name_(window_name),
-params_(p) {
+params_(p),
+tiled_(tiledParams(params_)),
+multi_(multiParams(params_)),
+motion_(motionParams(params_)) {
 CV_Assert(!K_mat.empty());
 CV_Assert(K_mat.type() == CV_32F && K_mat.rows == 3 && K_mat.cols == 3);
-cv::namedWindow(window_name_);
+syncIntrinsics();
+setProcessingScale(params_.processing_scale);
+if (params_.show_window) cv::namedWindow(window_name_);
 }
 
 void HumanDetector::bindWindow() {
+  if (!params_.show_window) return;  // headless: no window was created
   cv::setMouseCallback(window_name_, &HumanDetector::MouseThunk, this);
 }
 
 void HumanDetector::setFrame(const cv::Mat& bgr) {
   CV_Assert(!bgr.empty() && bgr.channels() == 3);
-  src_bgr_ = bgr.clone();
+  last_frame_allocs_ = frame_allocs_.delta();
+  frame_allocs_.restart();
+  arena_.reset();
+  ++frame_id_;
+  frame_time_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  setNativeSize(bgr.size());  // no-op unless the stream's resolution changed
+
+  if (params_.motion_gating) {
+    const bool moved = motion_.update(bgr);
+    const bool refresh = params_.motion_refresh_frames > 0 &&
+                         frames_since_processed_ + 1 >= params_.motion_refresh_frames;
+    frame_changed_ = moved || refresh || src_bgr_.empty();
+    if (!frame_changed_) {
+      ++frames_since_processed_;
+      publishSnapshot();
+      return;  // static scene: keep the previous image, overlays and results
+    }
+    frames_since_processed_ = 0;
+    if (moved) {
+      for (const auto& r : motion_.changedRegions()) dirty_.push_back(scaleRect(r, processingScale()));
+    }
+    if (!moved || dirty_.size() > 64) {
+      // Forced refresh (sub-threshold drift may have accumulated anywhere), or
+      // detectInRois() has not run for a while: treat the whole frame as dirty.
+      dirty_.assign(1, scaleRect(cv::Rect(0, 0, bgr.cols, bgr.rows), processingScale()));
+    }
+  }
+
+  toProcessing(bgr, src_bgr_);
+  publishSnapshot();
   cv::cvtColor(src_bgr_, gray_, cv::COLOR_BGR2GRAY);
-  if (display_.empty() || display_.size() != src_bgr_.size()) {
+  if (params_.show_window && (display_.empty() || display_.size() != src_bgr_.size())) {
     display_.create(src_bgr_.size(), src_bgr_.type());
   }
   redraw();
 }
 
 void HumanDetector::redraw() {
-  if (src_bgr_.empty()) return;
-  display_ = src_bgr_.clone();
-
-  if (dragging_ || box_finalized_) {
-    cv::rectangle(display_, box_, cv::Scalar(0,255,255), 2);
-  }
+  if (src_bgr_.empty() || !params_.show_window) return;
+  buildOverlay(overlay_);
+  src_bgr_.copyTo(display_);  // reuses display_'s buffer
+  drawOverlay(display_, overlay_);
+  cv::imshow(window_name_, display_);
+}
 
-  for (const auto& p : features_) {
-    cv::circle(display_, p, 3, cv::Scalar(0,255,0), cv::FILLED, cv::LINE_AA);
+void HumanDetector::buildOverlay(Overlay& ov) const {
+  ov.frame_id = frame_id_;
+  ov.show_box = dragging_ || box_finalized_;
+  ov.box = box_;
+  ov.features = features_;
+  ov.people.clear();
+  for (const auto& d : people_results_) ov.people.push_back(d.box);
+  ov.rois.clear();
+  ov.roi_features.clear();
+  for (const auto& r : roi_results_) {
+    ov.rois.push_back(r.roi);
+    ov.roi_features.insert(ov.roi_features.end(), r.features.begin(), r.features.end());
   }
-
-  if (feature_chosen_) {
-    cv::circle(display_, chosen_pt_, 6, cv::Scalar(0,0,255), 2, cv::LINE_AA);
+  ov.has_chosen = feature_chosen_;
+  ov.chosen = chosen_pt_;
+  if (!params_.draw_hud) {
+    ov.hud = Overlay::Hud::None;
+  } else {
+    ov.hud = mode_ == Mode::DRAW_BOX ? Overlay::Hud::DrawBox : Overlay::Hud::PickFeature;
   }
+}
 
-  if (params_.draw_hud) {
-    int y = 22;
-    auto put = [&](const std::string& s) {
-      cv::putText(display_, s, {10,y}, cv::FONT_HERSHEY_SIMPLEX, 0.6,
-                  cv::Scalar(255,255,255), 2, cv::LINE_AA);
-      y += 24;
-    };
-    if (mode_ == Mode::DRAW_BOX) {
-      put("Step 1: Drag a rectangle (Left mouse). Release to finalize.");
-    } else {
-      put("Step 2: Click a feature dot to select it. Press 'r' to redo box.");
-      put("(Z=fy*h/(v-cy), X=Z*(u-cx)/fx)");
-    }
-  }
+void HumanDetector::attachRecorder(AnnotatedRecorder* rec) { recorder_ = rec; }
 
-  cv::imshow(window_name_, display_);
+bool HumanDetector::recordFrame() {
+  if (!recorder_ || src_bgr_.empty()) return false;
+  buildOverlay(overlay_);
+  return recorder_->submit(src_bgr_, overlay_);
 }
 
 void HumanDetector::reset() {
   features_.clear();
+  roi_results_.clear();
+  people_results_.clear();
   feature_chosen_ = false;
   dragging_ = false;
   box_finalized_ = false;
   box_ = {};
   mode_ = Mode::DRAW_BOX;
+  publishSnapshot();
   redraw();
 }
 
 void HumanDetector::handleKey(int key) {
   if (key == 'r' || key == 'R') reset();
+  if ((key == 'f' || key == 'F') && !gray_.empty()) {
+    detectFeaturesFullFrame();
+    redraw();
+  }
 }
 
 bool HumanDetector::hasChosen() const { return feature_chosen_; }
 cv::Point2f HumanDetector::lastChosen() const { return chosen_pt_; }
+cv::Point2f HumanDetector::lastChosenNative() const { return toNative(chosen_pt_); }
 HumanDetector::Mode HumanDetector::mode() const { return mode_; }
 const cv::Mat& HumanDetector::display() const { return display_; }
 const cv::Rect& HumanDetector::box() const { return box_; }
 const std::vector<cv::Point2f>& HumanDetector::features() const { return features_; }
-void HumanDetector::setCameraHeight(float h) { params_.camera_height_m = h; }
+void HumanDetector::setCameraHeight(float h) {
+  params_.camera_height_m = h;
+  publishSnapshot();
+}
+
+void HumanDetector::featuresNative(std::vector<cv::Point2f>& out) const {
+  out.resize(features_.size());
+  for (size_t i = 0; i < features_.size(); ++i) out[i] = toNative(features_[i]);
+}
 const cv::Matx33f& HumanDetector::K() const { return K_; }
+float HumanDetector::cameraHeight() const { return params_.camera_height_m; }
+std::uint64_t HumanDetector::frameId() const { return frame_id_; }
+HumanDetector::SnapshotHandle HumanDetector::snapshot() const { return snapshots_.acquire(); }
+std::uint64_t HumanDetector::snapshotVersion() const { return snapshots_.version(); }
+
+void HumanDetector::publishSnapshot() {
+  cv::Point3f ground;
+  const bool has_ground = feature_chosen_ &&
+      projectToGround(processing_intrinsics, params_.camera_height_m, chosen_pt_, &ground);
+  // Vector assignment into the recycled slot reuses its capacity.
+  snapshots_.publishWith([&](Snapshot& s) {
+    s.frame_id = frame_id_;
+    s.mode = mode_;
+    s.box = box_;
+    s.features = features_;
+    s.has_chosen = feature_chosen_;
+    s.chosen = chosen_pt_;
+    s.has_ground = has_ground;
+    s.ground = has_ground ? ground : cv::Point3f();
+  });
+}
+void HumanDetector::attachPublisher(GroundPublisher* pub) { publisher_ = pub; }
+FrameArena& HumanDetector::frameArena() { return arena_; }
+bool HumanDetector::frameChanged() const { return frame_changed_; }
+const MotionGate& HumanDetector::motionGate() const { return motion_; }
+const alloc_stats::Counters& HumanDetector::lastFrameAllocations() const { return last_frame_allocs_; }
+
+void HumanDetector::publishGround() {
+  if (!publisher_) return;
+  std::size_t total = 1;
+  for (const auto& r : roi_results_) total += r.ground.size();
+  std::pmr::vector<cv::Point3f> pts(&arena_);
+  pts.reserve(total);
+
+  cv::Point3f g;
+  if (feature_chosen_ &&
+      projectToGround(processing_intrinsics, params_.camera_height_m, chosen_pt_, &g)) {
+    pts.push_back(g);
+  }
+  for (const auto& r : roi_results_) {
+    for (const auto& p : r.ground) {
+      if (!std::isnan(p.z)) pts.push_back(p);
+    }
+  }
+  const auto zone = ground_shm::classify(pts.data(), pts.size(), params_.zone);
+  publisher_->publish(frame_id_, frame_time_ns_, pts.data(), pts.size(), zone);
+}
+
+void HumanDetector::syncIntrinsics() {
+  CameraModel::syncIntrinsics();
+  K_ = processing_intrinsics.K();
+}
 
 cv::Point3f HumanDetector::pixelToGround(const cv::Point2f& uv) const {
-  const float fx = static_cast<float>(K_mat.at<float>(0,0));
-  const float fy = static_cast<float>(K_mat.at<float>(1,1));
-  const float cx = static_cast<float>(K_mat.at<float>(0,2));
-  const float cy = static_cast<float>(K_mat.at<float>(1,2));
-  const float denom = (uv.y - cy);
-  if (std::abs(denom) < 1e-6f) {
+  cv::Point3f Xw;
+  if (!projectToGround(processing_intrinsics, params_.camera_height_m, uv, &Xw)) {
     throw std::runtime_error("pixelToGround: v ~= cy → singular depth");
   }
-  std::cout<<fx<<fy;
-  const float Z = (fy * params_.camera_height_m) / denom;
-  const float X = Z * ((uv.x - cx) / fx);
-  return {X, 0.0f, Z};
+  return Xw;
+}
+
+void HumanDetector::pixelsToGround(const std::vector<cv::Point2f>& uv,
+                                   std::vector<cv::Point3f>& out) const {
+  out.resize(uv.size());
+  projectToGround(processing_intrinsics, params_.camera_height_m, uv.data(), uv.size(), out.data());
 }
 
 // --- Mouse plumbing ---
@@ -134,20 +289,11 @@ void HumanDetector::onMouse(int event, int x, int y, int /*flags*/) {
     } else if (event == cv::EVENT_MOUSEMOVE && dragging_) {
       box_ = cv::Rect(start_pt_, cv::Point(x,y));
       clampBoxToImage();
+      publishSnapshot();
       redraw();
     } else if (event == cv::EVENT_LBUTTONUP && dragging_) {
       dragging_ = false;
-      box_ = normalizeRect(cv::Rect(start_pt_, cv::Point(x,y)));
-      clampBoxToImage();
-      if (box_.width < 4 || box_.height < 4) {
-        std::cout << "[warn] Box too small, try again.\n";
-        box_finalized_ = false;
-      } else {
-        box_finalized_ = true;
-        detectFeaturesInBox();
-        mode_ = Mode::PICK_FEATURE;
-      }
-      redraw();
+      selectBox(cv::Rect(start_pt_, cv::Point(x,y)));
     }
   } else {
     if (event == cv::EVENT_LBUTTONDOWN) {
@@ -166,9 +312,10 @@ void HumanDetector::onMouse(int event, int x, int y, int /*flags*/) {
       }
       chosen_pt_ = features_[best_idx];
       feature_chosen_ = true;
+      publishSnapshot();
       redraw();
 
-      std::cout << chosen_pt_ << "\n";
+      std::cout << chosen_pt_ << " (native " << lastChosenNative() << ")\n";
       std::cout << K_mat << "\n";
       try {
         const auto Xw = pixelToGround(chosen_pt_);
@@ -177,19 +324,35 @@ void HumanDetector::onMouse(int event, int x, int y, int /*flags*/) {
       } catch (const std::exception& e) {
         std::cout << "[error] " << e.what() << "\n";
       }
+      publishGround();
     }
   }
 }
 
 // --- Features ---
+bool HumanDetector::selectBox(const cv::Rect& box) {
+  box_ = normalizeRect(box);
+  clampBoxToImage();
+  if (box_.width < 4 || box_.height < 4) {
+    std::cout << "[warn] Box too small, try again.\n";
+    box_finalized_ = false;
+  } else {
+    box_finalized_ = true;
+    detectFeaturesInBox();
+    mode_ = Mode::PICK_FEATURE;
+  }
+  publishSnapshot();
+  redraw();
+  return box_finalized_;
+}
+
 void HumanDetector::detectFeaturesInBox() {
   features_.clear();
   if (box_.width <= 1 || box_.height <= 1) return;
   CV_Assert(!gray_.empty());
 
-  cv::Mat gray_roi = gray_(box_);
-  std::vector<cv::Point2f> pts;
-  cv::goodFeaturesToTrack(gray_roi, pts,
+  const cv::Mat gray_roi = gray_(box_);
+  cv::goodFeaturesToTrack(gray_roi, pts_,
                           params_.max_corners,
                           params_.quality_level,
                           params_.min_distance,
@@ -197,8 +360,8 @@ void HumanDetector::detectFeaturesInBox() {
                           params_.block_size,
                           params_.use_harris);
 
-  features_.reserve(pts.size());
-  for (const auto& p : pts) {
+  features_.reserve(pts_.size());
+  for (const auto& p : pts_) {
     features_.emplace_back(p.x + static_cast<float>(box_.x),
                            p.y + static_cast<float>(box_.y));
   }
@@ -210,6 +373,69 @@ void HumanDetector::detectFeaturesInBox() {
   }
 }
 
+void HumanDetector::detectFeaturesFullFrame() {
+  CV_Assert(!gray_.empty());
+  box_ = cv::Rect(0, 0, gray_.cols, gray_.rows);
+  box_finalized_ = true;
+  dragging_ = false;
+  feature_chosen_ = false;
+  tiled_.detect(gray_, features_);
+  mode_ = Mode::PICK_FEATURE;
+  publishSnapshot();
+
+  if (features_.empty()) {
+    std::cout << "[warn] No features found in frame.\n";
+  } else {
+    std::cout << "[info] Found " << features_.size() << " features in frame.\n";
+  }
+}
+
+const std::vector<PeopleDetector::Detection>& HumanDetector::detectPeople() {
+  CV_Assert(!gray_.empty());
+  people_.setGeometry(processing_intrinsics, params_.camera_height_m, gray_.size());
+  people_.detect(gray_, people_results_);
+  return people_results_;
+}
+
+const std::vector<HumanDetector::RoiResult>& HumanDetector::detectInRois(
+    const std::vector<cv::Rect>& rois) {
+  CV_Assert(!gray_.empty());
+  const cv::Rect canvas(0, 0, gray_.cols, gray_.rows);
+  roi_scratch_.resize(rois.size());
+  for (size_t i = 0; i < rois.size(); ++i) roi_scratch_[i] = normalizeRect(rois[i]) & canvas;
+
+  // Re-detect only ROIs that are new, moved, or touched by motion; without
+  // gating (or on a different ROI count) that is all of them.
+  roi_todo_.clear();
+  const bool reuse = params_.motion_gating && roi_results_.size() == rois.size();
+  for (size_t i = 0; i < rois.size(); ++i) {
+    bool stale = !reuse || roi_results_[i].roi != roi_scratch_[i];
+    for (size_t d = 0; !stale && d < dirty_.size(); ++d) {
+      stale = (dirty_[d] & roi_scratch_[i]).area() > 0;
+    }
+    if (stale) roi_todo_.push_back(static_cast<int>(i));
+  }
+  dirty_.clear();
+  if (roi_todo_.empty()) return roi_results_;
+
+  roi_subset_.resize(roi_todo_.size());
+  for (size_t j = 0; j < roi_todo_.size(); ++j) roi_subset_[j] = roi_scratch_[roi_todo_[j]];
+  multi_.detect(gray_, roi_subset_, roi_features_);
+
+  roi_results_.resize(rois.size());
+  for (size_t j = 0; j < roi_todo_.size(); ++j) {
+    RoiResult& r = roi_results_[roi_todo_[j]];
+    r.roi = roi_subset_[j];
+    r.features.swap(roi_features_[j]);
+    pixelsToGround(r.features, r.ground);
+    r.features_native.resize(r.features.size());
+    for (size_t k = 0; k < r.features.size(); ++k) {
+      r.features_native[k] = toNative(r.features[k]);
+    }
+  }
+  return roi_results_;
+}
+
 // --- Utils ---
 void HumanDetector::clampBoxToImage() {
   const cv::Rect canvas(0, 0, src_bgr_.cols, src_bgr_.rows);
@@ -1,8 +1,18 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <opencv2/core.hpp>
 #include "camera_model.hpp"
+#include "tiled_corner_detector.hpp"
+#include "multi_roi_detector.hpp"
+#include "ground_publisher.hpp"
+#include "snapshot_cell.hpp"
+#include "frame_arena.hpp"
+#include "alloc_stats.hpp"
+#include "motion_gate.hpp"
+#include "people_detector.hpp"
+#include "annotated_recorder.hpp"
 
 /**
  * @file human_detector.hpp
@@ -34,6 +44,33 @@ public:
     PICK_FEATURE  ///< User clicks a detected feature to select it.
   };
 
+  /**
+   * @brief Per-ROI output of detectInRois().
+   */
+  struct RoiResult {
+    cv::Rect roi;                       ///< ROI as requested (clamped to the frame).
+    std::vector<cv::Point2f> features;  ///< Corners inside the ROI (processing coords).
+    std::vector<cv::Point2f> features_native; ///< Same corners in native sensor coords.
+    std::vector<cv::Point3f> ground;    ///< pixelToGround() of each feature; NaN if v ~= cy.
+  };
+
+  /**
+   * @brief Immutable copy of the UI/detection state, published after every update.
+   */
+  struct Snapshot {
+    std::uint64_t frame_id = 0;           ///< frameId() when published.
+    Mode mode = Mode::DRAW_BOX;           ///< UI mode.
+    cv::Rect box;                         ///< ROI (empty until one is drawn).
+    std::vector<cv::Point2f> features;    ///< Detected corners (processing coords).
+    bool has_chosen = false;              ///< A feature has been selected.
+    cv::Point2f chosen{};                 ///< Selected feature (processing coords).
+    bool has_ground = false;              ///< @ref ground is valid (chosen and v != cy).
+    cv::Point3f ground{};                 ///< pixelToGround() of @ref chosen.
+  };
+
+  /// Pin on one published Snapshot; release by destroying it.
+  using SnapshotHandle = SnapshotCell<Snapshot>::Handle;
+
   /**
    * @brief Tunable parameters for detection, selection, and HUD.
    *
@@ -48,6 +85,16 @@ public:
     double choose_max_pix_dist = 12.0;  ///< Max click distance (px) to snap to nearest corner.
     float  camera_height_m     = 0.063f;  ///< Camera height h above ground (meters).
     bool   draw_hud            = true;  ///< Draw textual HUD instructions on the display.
+    int    tiles_x             = 4;     ///< Full-frame mode: tile columns.
+    int    tiles_y             = 4;     ///< Full-frame mode: tile rows.
+    int    corners_per_tile    = 16;    ///< Full-frame mode: corner budget per tile.
+    double processing_scale    = 1.0;   ///< Processing resolution / native, in (0,1] (e.g. 0.5, 0.25).
+    ZoneThresholds zone;                ///< Published zone ranges.
+    bool   motion_gating       = false; ///< Skip static frames and reuse results (see MotionGate).
+    int    motion_block_size   = 16;    ///< Motion gate block edge (native pixels).
+    double motion_threshold    = 12.0;  ///< Motion gate block-mean difference (gray levels).
+    int    motion_refresh_frames = 30;  ///< Process at least every Nth frame even if static (0 = never).
+    bool   show_window         = true;  ///< Create the window and render/imshow in redraw(); false for headless runs (display() stays empty).
   };
 
 /**
@@ -89,13 +136,23 @@ HumanDetector(const std::string& window_name,
    * @brief Bind the mouse callback for @p window_name to this instance.
    *
    * @details Must be called once after construction and before interactive use.
+   *          No-op when Params::show_window is false.
    */
   void bindWindow();
 
   /**
    * @brief Set the current BGR frame and update the internal grayscale copy.
    *
-   * @param bgr Input BGR frame (CV_8UC3).
+   * @param bgr Input BGR frame (CV_8UC3) at native sensor resolution.
+   *
+   * @details The frame is downscaled once here to Params::processing_scale;
+   *          detection, display, mouse coordinates and pixelToGround() then all
+   *          work at processing resolution against the rescaled intrinsics.
+   *
+   *          With Params::motion_gating, a MotionGate looks at the frame first.
+   *          If nothing moved, the frame is dropped before any conversion: the
+   *          previous image, overlays and detection results stay current
+   *          (frameChanged() is false) and only the frame id advances.
    *
    * @post Triggers a redraw of overlays to the window.
    * @throws cv::Exception if @p bgr is empty or not 3-channel (assert).
@@ -105,7 +162,8 @@ HumanDetector(const std::string& window_name,
   /**
    * @brief Redraw overlays (ROI, corners, chosen point, HUD) and show via imshow.
    *
-   * @note Safe to call frequently (e.g., in a video loop).
+   * @note Safe to call frequently (e.g., in a video loop). No-op when
+   *       Params::show_window is false.
    */
   void redraw();
 
@@ -117,7 +175,155 @@ HumanDetector(const std::string& window_name,
   void reset();
 
   /**
-   * @brief Convenience key handler (e.g., press 'r' to reset).
+   * @brief Finalize @p box as the ROI and detect corners in it, as releasing
+   *        a mouse drag does; for headless use.
+   *
+   * @param box ROI in processing coordinates (normalized and clamped).
+   * @return false if the clamped box is smaller than 4x4 px; the UI then
+   *         stays in DRAW_BOX.
+   */
+  bool selectBox(const cv::Rect& box);
+
+  /**
+   * @brief Detect corners over the whole frame instead of a drawn ROI.
+   *
+   * @details Splits @ref gray_ into tiles_x * tiles_y tiles, detects in parallel
+   *          with a per-tile budget and merges with cross-tile min_distance
+   *          suppression (see TiledCornerDetector). The ROI becomes the full
+   *          frame and the UI switches to PICK_FEATURE.
+   */
+  void detectFeaturesFullFrame();
+
+  /**
+   * @brief Detect corners in many ROIs of the current frame at once.
+   *
+   * @param rois ROIs in image coordinates (e.g. one per detected person).
+   * @return Per-ROI features and ground points, in the order of @p rois. The
+   *         reference stays valid until the next call or reset().
+   *
+   * @details All ROIs share the grayscale image from setFrame(). Overlapping
+   *          ROIs are merged so the corner response of shared pixels is
+   *          computed once, and both response maps and per-ROI selection run
+   *          in parallel (see MultiRoiDetector). Ground points come from the
+   *          batched pixelsToGround(). Does not change the UI mode.
+   *
+   *          With Params::motion_gating, an ROI identical to the previous call
+   *          that no motion touched since then keeps its previous result; only
+   *          the others are re-detected (none at all on a static scene).
+   */
+  const std::vector<RoiResult>& detectInRois(const std::vector<cv::Rect>& rois);
+
+  /**
+   * @brief Find people in the current frame with the geometry-constrained HOG detector.
+   *
+   * @return Detections in processing coordinates, strongest first, each with
+   *         its ground position. Valid until the next call or reset().
+   *
+   * @details Only the scales a 1.5-2.0 m person can have at each image row
+   *          (from processing_intrinsics and the camera height) are searched;
+   *          see PeopleDetector. The boxes can be fed to detectInRois().
+   */
+  const std::vector<PeopleDetector::Detection>& detectPeople();
+
+  /**
+   * @brief Batched pixelToGround(); singular points map to NaN instead of throwing.
+   *
+   * @param uv  Image points (u,v).
+   * @param out Ground points (X,0,Z), resized to uv.size().
+   */
+  void pixelsToGround(const std::vector<cv::Point2f>& uv, std::vector<cv::Point3f>& out) const;
+
+  /**
+   * @brief Pin the most recently published state.
+   *
+   * @details Safe to call from any thread while the UI/processing thread keeps
+   *          updating the detector: readers never lock and never block it, and
+   *          the snapshot stays consistent and unchanged while the handle lives.
+   *          Hold handles briefly; the writer recycles a fixed set of slots.
+   */
+  SnapshotHandle snapshot() const;
+
+  /**
+   * @brief Version of the latest published snapshot; cheap change check for pollers.
+   */
+  std::uint64_t snapshotVersion() const;
+
+  /**
+   * @brief Publish this frame's ground points to shared memory.
+   *
+   * @param pub Non-owning publisher; nullptr detaches. Must outlive the detector
+   *            or be detached first.
+   */
+  void attachPublisher(GroundPublisher* pub);
+
+  /**
+   * @brief Write one record for the current frame to the attached publisher.
+   *
+   * @details The record holds the chosen point's ground position (if any)
+   *          followed by the ground points of the last detectInRois(), with a
+   *          zone state from Params::zone. Call once per frame
+   *          after detection; choosing a feature with the mouse also publishes.
+   *          No-op without a publisher.
+   */
+  void publishGround();
+
+  /**
+   * @brief Record annotated frames with @p rec.
+   *
+   * @param rec Non-owning recorder; nullptr detaches. Must outlive the detector
+   *            or be detached first.
+   */
+  void attachRecorder(AnnotatedRecorder* rec);
+
+  /**
+   * @brief Hand the current frame and its overlay description to the recorder.
+   *
+   * @details Copies the frame and the overlay into the recorder's queue;
+   *          drawing and encoding happen on the recorder thread. Call once per
+   *          frame after detection. Works with Params::show_window off.
+   *          No-op without a recorder.
+   * @return false if the recorder dropped the frame (or none is attached).
+   */
+  bool recordFrame();
+
+  /**
+   * @brief Number of frames passed to setFrame() so far (id of the current frame).
+   */
+  std::uint64_t frameId() const;
+
+  /**
+   * @brief Arena for transient buffers of the current frame; reset by setFrame().
+   *
+   * @details Callers on the processing thread may draw per-frame scratch from
+   *          it (std::pmr containers) instead of the global heap.
+   */
+  FrameArena& frameArena();
+
+  /**
+   * @brief Whether the last setFrame() was processed (always true without motion gating).
+   */
+  bool frameChanged() const;
+
+  /**
+   * @brief The motion gate (changed blocks/regions of the last gated frame, native coords).
+   */
+  const MotionGate& motionGate() const;
+
+  /**
+   * @brief Heap allocations made by the processing thread during the previous
+   *        frame (from one setFrame() to the next).
+   *
+   * @note All zero unless the alloc_stats hooks are linked in (see alloc_stats.hpp).
+   *       Only the calling thread is counted; wrap frames in an
+   *       alloc_stats::Scope(Threads::All) to include worker threads. The
+   *       per-frame loop setFrame(), undistort(), detectInRois() is
+   *       allocation-free once buffers reach their steady size; one-off UI
+   *       work such as selectBox() is not.
+   */
+  const alloc_stats::Counters& lastFrameAllocations() const;
+
+  /**
+   * @brief Convenience key handler (press 'r' to reset, 'f' for full-frame features).
    *
    * @param key Key code from cv::waitKey(...).
    */
@@ -136,6 +342,17 @@ HumanDetector(const std::string& window_name,
    */
   cv::Point2f lastChosen() const;
 
+  /**
+   * @brief Last chosen feature in native sensor coordinates.
+   */
+  cv::Point2f lastChosenNative() const;
+
+  /**
+   * @brief Detected features mapped to native sensor coordinates.
+   * @param out Output, resized to features().size().
+   */
+  void featuresNative(std::vector<cv::Point2f>& out) const;
+
   /**
    * @brief Current UI mode.
    * @return Mode::DRAW_BOX or Mode::PICK_FEATURE.
@@ -145,19 +362,23 @@ HumanDetector(const std::string& window_name,
   /**
    * @brief Access the last rendered display image (with overlays).
    * @return const reference to the display image.
-   * @note Useful for testing or saving screenshots.
+   * @note Useful for testing or saving screenshots. Empty when
+   *       Params::show_window is false: headless runs never render, so use
+   *       attachRecorder()/recordFrame() to capture annotated frames instead.
    */
   const cv::Mat& display() const;
 
   /**
    * @brief Access the current ROI rectangle.
    * @return const reference to the ROI (may be empty if not finalized).
+   * @warning Live state; only the UI thread may read it. Other threads use snapshot().
    */
   const cv::Rect& box() const;
 
   /**
    * @brief Access the vector of detected features (image coordinates).
    * @return const reference to the detected corner list.
+   * @warning Live state; only the UI thread may read it. Other threads use snapshot().
    */
   const std::vector<cv::Point2f>& features() const;
 
@@ -170,11 +391,22 @@ HumanDetector(const std::string& window_name,
   void setCameraHeight(float h);
 
   /**
-   * @brief Access the intrinsic matrix.
-   * @return const reference to K.
+   * @brief Camera height above the ground plane (meters), as used by pixelToGround().
+   */
+  float cameraHeight() const;
+
+  /**
+   * @brief Access the intrinsic matrix at processing resolution.
+   * @return const reference to processing_intrinsics.K(), the matrix
+   *         pixelToGround() uses (the native K_mat at processing_scale 1).
    */
   const cv::Matx33f& K() const;
 
+  /**
+   * @brief Refresh @ref intrinsics, processing_intrinsics and @ref K_ from K_mat / D_mat.
+   */
+  void syncIntrinsics() override;
+
   /**
    * @brief Map an image pixel (u,v) to ground coordinates (X,0,Z).
    *
@@ -183,7 +415,8 @@ HumanDetector(const std::string& window_name,
    *
    * @details Uses:
    *   Z = fy * h / (v - cy)  and  X = Z * (u - cx) / fx,  Y ≡ 0
-   *   where (fx, fy, cx, cy) are taken from K, and h is the camera height.
+   *   where (fx, fy, cx, cy) are taken from @ref processing_intrinsics, and h is
+   *   the camera height. @p uv is in processing coordinates, like features().
    *
    * @throws std::runtime_error if (v - cy) ≈ 0, causing a singular depth.
    *
@@ -224,6 +457,19 @@ private:
    */
   void detectFeaturesInBox();
 
+  /**
+   * @brief Copy the current state into @ref snapshots_ for concurrent readers.
+   *
+   * @details Called after every state change. If readers pin every spare slot
+   *          the publish is skipped and retried on the next change or frame.
+   */
+  void publishSnapshot();
+
+  /**
+   * @brief Describe what redraw() draws for the current state into @p ov.
+   */
+  void buildOverlay(Overlay& ov) const;
+
   /**
    * @brief Clamp the ROI rectangle to lie within the current frame’s bounds.
    */
@@ -239,8 +485,10 @@ private:
 
   // ---- Configuration (intrinsics + tunables) ----
   std::string window_name_;  ///< Name of the OpenCV window for rendering.
-  cv::Matx33f K_;            ///< Camera intrinsics (fx, fy, cx, cy).
+  cv::Matx33f K_;            ///< Processing-resolution camera matrix (fx, fy, cx, cy).
   Params params_;            ///< Parameters for detection/selection/HUD.
+  TiledCornerDetector tiled_;///< Full-frame tiled detector (built from @ref params_).
+  MultiRoiDetector multi_;   ///< Batched multi-ROI detector (built from @ref params_).
 
   // ---- Runtime state (images, ROI, features, UI flags) ----
   cv::Mat src_bgr_;          ///< Latest input frame (BGR).
@@ -252,6 +500,31 @@ private:
   std::vector<cv::Point2f> features_; ///< Detected corners in image coords.
   bool feature_chosen_ = false;       ///< True once a feature has been selected.
   cv::Point2f chosen_pt_{};           ///< Last chosen feature (u,v).
+  std::vector<RoiResult> roi_results_;///< Results of the last detectInRois().
+  std::vector<cv::Rect> roi_scratch_; ///< Clamped ROIs for detectInRois().
+  std::vector<std::vector<cv::Point2f>> roi_features_; ///< Scratch for MultiRoiDetector.
+
+  PeopleDetector people_;             ///< HOG detector; geometry refreshed per call.
+  std::vector<PeopleDetector::Detection> people_results_; ///< Results of the last detectPeople().
+
+  // ---- Motion gating ----
+  MotionGate motion_;                 ///< Built from @ref params_.
+  bool frame_changed_ = true;         ///< Last setFrame() was processed.
+  int frames_since_processed_ = 0;    ///< Static frames skipped in a row.
+  std::vector<cv::Rect> dirty_;       ///< Changed regions (processing coords) since the last detectInRois().
+  std::vector<int> roi_todo_;         ///< Indices of ROIs to re-detect.
+  std::vector<cv::Rect> roi_subset_;  ///< Their rectangles.
+
+  SnapshotCell<Snapshot> snapshots_{Snapshot{}}; ///< Published copies of the state below.
+  GroundPublisher* publisher_ = nullptr;  ///< Optional shared-memory output.
+  AnnotatedRecorder* recorder_ = nullptr; ///< Optional annotated-video output.
+  Overlay overlay_;                   ///< Scratch for redraw()/recordFrame(); keeps capacity.
+  FrameArena arena_;                  ///< Per-frame transient buffers; reset by setFrame().
+  alloc_stats::Scope frame_allocs_;   ///< Allocations since the last setFrame().
+  alloc_stats::Counters last_frame_allocs_{}; ///< Result for the previous frame.
+  std::vector<cv::Point2f> pts_;      ///< goodFeaturesToTrack output, reused across ROIs.
+  std::uint64_t frame_id_ = 0;        ///< Incremented by setFrame().
+  std::int64_t frame_time_ns_ = 0;    ///< steady_clock time of the last setFrame().
 
   Mode mode_ = Mode::DRAW_BOX;        ///< Current UI mode.
   bool dragging_ = false;             ///< True while mouse drag is active.
@@ -0,0 +1,155 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <opencv2/core.hpp>
+
+/**
+ * @file intrinsics.hpp
+ * @brief Fixed-size, trivially copyable pinhole intrinsics and distortion.
+ *
+ * @details
+ * CameraModel keeps K_mat / D_mat as heap-backed cv::Mat for the OpenCV calls,
+ * and mirrors them into this struct whenever they change. Per-point math
+ * (pixelToGround and friends) reads this instead: it is one cache line, holds
+ * precomputed reciprocals, and is cheap to pass by value across threads.
+ *
+ * Distortion follows the OpenCV coefficient order (k1, k2, p1, p2, k3, k4, k5, k6);
+ * k4..k6 are the denominator of the rational model and stay zero otherwise.
+ * See distortion_model.hpp for the per-model distort/undistort code.
+ */
+struct alignas(64) Intrinsics {
+  float fx = 0.0f, fy = 0.0f;          ///< Focal lengths (px).
+  float cx = 0.0f, cy = 0.0f;          ///< Principal point (px).
+  float inv_fx = 0.0f, inv_fy = 0.0f;  ///< 1/fx, 1/fy.
+  float k1 = 0.0f, k2 = 0.0f, k3 = 0.0f;  ///< Radial distortion.
+  float p1 = 0.0f, p2 = 0.0f;             ///< Tangential distortion.
+  float k4 = 0.0f, k5 = 0.0f, k6 = 0.0f;  ///< Rational-model denominator.
+
+  /**
+   * @brief Build from focal lengths and principal point; no distortion.
+   */
+  static Intrinsics fromPinhole(float fx, float fy, float cx, float cy) {
+    Intrinsics in;
+    in.fx = fx;  in.fy = fy;
+    in.cx = cx;  in.cy = cy;
+    in.inv_fx = fx != 0.0f ? 1.0f / fx : 0.0f;
+    in.inv_fy = fy != 0.0f ? 1.0f / fy : 0.0f;
+    return in;
+  }
+
+  /**
+   * @brief Build from a 3x3 camera matrix and an OpenCV distortion vector.
+   *
+   * @param K 3x3 CV_32F or CV_64F camera matrix.
+   * @param D 1xN / Nx1 CV_32F or CV_64F coefficients (may be empty; N <= 8 read).
+   */
+  static Intrinsics fromMats(const cv::Mat& K, const cv::Mat& D) {
+    cv::Mat k, d;
+    K.convertTo(k, CV_32F);
+    Intrinsics in = fromPinhole(k.at<float>(0,0), k.at<float>(1,1),
+                                k.at<float>(0,2), k.at<float>(1,2));
+    if (!D.empty()) {
+      D.convertTo(d, CV_32F);
+      const int n = static_cast<int>(d.total());
+      const float* c = d.ptr<float>();
+      if (n > 0) in.k1 = c[0];
+      if (n > 1) in.k2 = c[1];
+      if (n > 2) in.p1 = c[2];
+      if (n > 3) in.p2 = c[3];
+      if (n > 4) in.k3 = c[4];
+      if (n > 5) in.k4 = c[5];
+      if (n > 6) in.k5 = c[6];
+      if (n > 7) in.k6 = c[7];
+    }
+    return in;
+  }
+
+  /**
+   * @brief Intrinsics for the same camera imaging at @p s times the resolution.
+   *
+   * @details Focal lengths scale by @p s; the principal point is mapped with
+   *          the pixel-centre convention used by cv::resize,
+   *          c' = (c + 0.5) * s - 0.5. Distortion acts on normalized
+   *          coordinates and is unchanged.
+   */
+  Intrinsics scaled(float s) const { return scaled(s, s); }
+
+  /**
+   * @brief Per-axis scaled(): x quantities by @p sx, y quantities by @p sy.
+   */
+  Intrinsics scaled(float sx, float sy) const {
+    Intrinsics out = *this;
+    out.fx = fx * sx;
+    out.fy = fy * sy;
+    out.cx = (cx + 0.5f) * sx - 0.5f;
+    out.cy = (cy + 0.5f) * sy - 0.5f;
+    out.inv_fx = out.fx != 0.0f ? 1.0f / out.fx : 0.0f;
+    out.inv_fy = out.fy != 0.0f ? 1.0f / out.fy : 0.0f;
+    return out;
+  }
+
+  /**
+   * @brief Intrinsics for a frame resized from @p from to @p to pixels.
+   *
+   * @details Uses the exact per-axis factors, which differ from the nominal
+   *          scale whenever the resized size was rounded.
+   */
+  Intrinsics scaledTo(const cv::Size& from, const cv::Size& to) const {
+    return scaled(static_cast<float>(to.width) / static_cast<float>(from.width),
+                  static_cast<float>(to.height) / static_cast<float>(from.height));
+  }
+
+  /**
+   * @brief Camera matrix as a fixed-size Matx.
+   */
+  cv::Matx33f K() const {
+    return cv::Matx33f(fx, 0.0f, cx,
+                       0.0f, fy, cy,
+                       0.0f, 0.0f, 1.0f);
+  }
+};
+
+static_assert(std::is_trivially_copyable<Intrinsics>::value,
+              "Intrinsics must stay trivially copyable");
+static_assert(sizeof(Intrinsics) == 64, "Intrinsics should fill exactly one cache line");
+
+/**
+ * @brief Flat-ground, zero-tilt back-projection of a pixel.
+ *
+ *   Z = fy * h / (v - cy),   X = Z * (u - cx) / fx,   Y = 0
+ *
+ * @return false (and leaves @p out untouched) if v ~= cy.
+ */
+inline bool projectToGround(const Intrinsics& in, float camera_height_m,
+                            const cv::Point2f& uv, cv::Point3f* out) {
+  const float denom = uv.y - in.cy;
+  if (std::abs(denom) < 1e-6f) return false;
+  const float Z = (in.fy * camera_height_m) / denom;
+  const float X = Z * ((uv.x - in.cx) * in.inv_fx);
+  *out = {X, 0.0f, Z};
+  return true;
+}
+
+/**
+ * @brief Batched projectToGround(): @p n pixels in, @p n ground points out.
+ *
+ * @details Points with v ~= cy come back as NaN. The loop reads only @p in
+ *          and the two arrays, so it is safe to call from
+ *          several threads on disjoint outputs.
+ */
+inline void projectToGround(const Intrinsics& in, float camera_height_m,
+                            const cv::Point2f* uv, std::size_t n, cv::Point3f* out) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const float fyh = in.fy * camera_height_m;
+  for (std::size_t i = 0; i < n; ++i) {
+    const float denom = uv[i].y - in.cy;
+    if (std::abs(denom) < 1e-6f) {
+      out[i] = {nan, nan, nan};
+      continue;
+    }
+    const float Z = fyh / denom;
+    out[i] = {Z * ((uv[i].x - in.cx) * in.inv_fx), 0.0f, Z};
+  }
+}
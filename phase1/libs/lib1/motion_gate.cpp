@@ -0,0 +1,93 @@
+#include "motion_gate.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <opencv2/imgproc.hpp>
+
+MotionGate::MotionGate() : MotionGate(Params{}) {}
+
+MotionGate::MotionGate(const Params& p) : params_(p) {
+  if (params_.block_size < 1) {
+    throw std::invalid_argument("MotionGate: block_size must be >= 1");
+  }
+}
+
+bool MotionGate::update(const cv::Mat& frame) {
+  CV_Assert(!frame.empty() && frame.depth() == CV_8U &&
+            (frame.channels() == 1 || frame.channels() == 3));
+  const int bs = params_.block_size;
+  const cv::Size grid((frame.cols + bs - 1) / bs, (frame.rows + bs - 1) / bs);
+
+  // Block means: averaging before the colour conversion is equivalent (both
+  // are linear) and converts only grid.area() pixels. Block (i, j) must cover
+  // exactly the pixels changedRegions() reports for it, so whole tiles are
+  // averaged by an integer-factor resize and a partial last column, row and
+  // corner (frame size not a multiple of bs) by their own resizes.
+  small_.create(grid, frame.type());
+  const int full_w = frame.cols / bs, full_h = frame.rows / bs;
+  const int rem_w = frame.cols - full_w * bs, rem_h = frame.rows - full_h * bs;
+  auto average = [&](const cv::Rect& src, const cv::Rect& cells) {
+    if (cells.empty()) return;
+    cv::Mat dst = small_(cells);
+    cv::resize(frame(src), dst, cells.size(), 0, 0, cv::INTER_AREA);
+  };
+  average(cv::Rect(0, 0, full_w * bs, full_h * bs), cv::Rect(0, 0, full_w, full_h));
+  if (rem_w > 0) {
+    average(cv::Rect(full_w * bs, 0, rem_w, full_h * bs), cv::Rect(full_w, 0, 1, full_h));
+  }
+  if (rem_h > 0) {
+    average(cv::Rect(0, full_h * bs, full_w * bs, rem_h), cv::Rect(0, full_h, full_w, 1));
+  }
+  if (rem_w > 0 && rem_h > 0) {
+    average(cv::Rect(full_w * bs, full_h * bs, rem_w, rem_h), cv::Rect(full_w, full_h, 1, 1));
+  }
+  if (small_.channels() == 3) {
+    cv::cvtColor(small_, small_gray_, cv::COLOR_BGR2GRAY);
+  } else {
+    small_gray_ = small_;
+  }
+  small_gray_.convertTo(small_f_, CV_32F);
+
+  if (background_.empty() || frame.size() != frame_size_) {
+    frame_size_ = frame.size();
+    small_f_.copyTo(background_);
+    mask_.create(grid, CV_8U);
+    mask_.setTo(cv::Scalar(255));
+    changed_blocks_ = grid.area();
+    regions_.assign(1, cv::Rect(0, 0, frame.cols, frame.rows));
+    return changed();
+  }
+
+  cv::absdiff(small_f_, background_, diff_);
+  cv::compare(diff_, params_.diff_threshold, mask_, cv::CMP_GT);
+  changed_blocks_ = cv::countNonZero(mask_);
+  cv::accumulateWeighted(small_f_, background_, params_.learning_rate);
+
+  regions_.clear();
+  if (changed_blocks_ > 0) {
+    const cv::Rect canvas(0, 0, frame.cols, frame.rows);
+    const int n = cv::connectedComponentsWithStats(mask_, labels_, stats_, centroids_, 8, CV_32S);
+    for (int i = 1; i < n; ++i) {
+      const int* s = stats_.ptr<int>(i);
+      const cv::Rect blocks(s[cv::CC_STAT_LEFT], s[cv::CC_STAT_TOP],
+                            s[cv::CC_STAT_WIDTH], s[cv::CC_STAT_HEIGHT]);
+      regions_.push_back(cv::Rect(blocks.x * bs, blocks.y * bs,
+                                  blocks.width * bs, blocks.height * bs) & canvas);
+    }
+  }
+  return changed();
+}
+
+bool MotionGate::changed() const { return changed_blocks_ >= std::max(1, params_.min_changed_blocks); }
+int MotionGate::changedBlocks() const { return changed_blocks_; }
+const std::vector<cv::Rect>& MotionGate::changedRegions() const { return regions_; }
+const cv::Mat& MotionGate::changedMask() const { return mask_; }
+const MotionGate::Params& MotionGate::params() const { return params_; }
+
+void MotionGate::reset() {
+  background_.release();
+  frame_size_ = {};
+  regions_.clear();
+  changed_blocks_ = 0;
+}
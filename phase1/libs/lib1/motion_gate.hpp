@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @file motion_gate.hpp
+ * @brief Cheap scene-change detector to skip work on static frames.
+ *
+ * @details
+ * Each frame is reduced to one mean gray value per block_size x block_size
+ * block (INTER_AREA resizes straight from the BGR frame, then a colour
+ * conversion of the tiny image). Blocks are exact tiles of the frame: when
+ * its size is not a multiple of block_size, the last column and row of
+ * blocks are narrower. The block means are compared with a running background
+ * of the same resolution, and every block whose absolute difference exceeds
+ * diff_threshold is marked changed. The background follows the scene with
+ * cv::accumulateWeighted, so lighting drift and objects that stop moving are
+ * absorbed after roughly 1 / learning_rate frames.
+ *
+ * Changed blocks are grouped into connected regions and reported as image
+ * rectangles, so callers can either skip a frame entirely or restrict work
+ * to what moved.
+ */
+class MotionGate {
+public:
+  struct Params {
+    int    block_size         = 16;    ///< Block edge in frame pixels.
+    double diff_threshold     = 12.0;  ///< Block-mean difference (gray levels) that counts as change.
+    double learning_rate      = 0.05;  ///< Background update weight per frame.
+    int    min_changed_blocks = 1;     ///< Fewer changed blocks than this = static frame.
+  };
+
+  MotionGate();
+  explicit MotionGate(const Params& p);
+
+  /**
+   * @brief Compare @p frame with the background and update it.
+   *
+   * @param frame 8-bit gray or BGR image. The first frame, and any frame whose
+   *              size differs from the previous one, counts as fully changed.
+   * @return changed().
+   */
+  bool update(const cv::Mat& frame);
+
+  /** @brief Whether the last update() saw at least min_changed_blocks changed blocks. */
+  bool changed() const;
+
+  /** @brief Number of changed blocks in the last update(). */
+  int changedBlocks() const;
+
+  /**
+   * @brief Bounding rectangles (frame pixels) of connected changed blocks.
+   */
+  const std::vector<cv::Rect>& changedRegions() const;
+
+  /** @brief Block grid of the last update(), CV_8U, 255 = changed. */
+  const cv::Mat& changedMask() const;
+
+  /** @brief Forget the background; the next frame counts as fully changed. */
+  void reset();
+
+  const Params& params() const;
+
+private:
+  Params params_;
+  cv::Size frame_size_{};
+  cv::Mat small_;        ///< Frame resized to the block grid.
+  cv::Mat small_gray_;   ///< Same, single channel.
+  cv::Mat small_f_;      ///< Same, CV_32F.
+  cv::Mat background_;   ///< Running block-mean background (CV_32F).
+  cv::Mat diff_;
+  cv::Mat mask_;
+  cv::Mat labels_, stats_, centroids_;
+  std::vector<cv::Rect> regions_;
+  int changed_blocks_ = 0;
+};
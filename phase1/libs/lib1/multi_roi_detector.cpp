@@ -0,0 +1,224 @@
+#include "multi_roi_detector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// OpenCV's BORDER_DEFAULT (reflect-101): -1 -> 1, n -> n - 2.
+int reflect101(int i, int n) {
+  if (n == 1) return 0;
+  while (i < 0 || i >= n) i = i < 0 ? -i : 2 * n - 2 - i;
+  return i;
+}
+
+}  // namespace
+
+MultiRoiDetector::MultiRoiDetector() : MultiRoiDetector(Params{}) {}
+
+MultiRoiDetector::MultiRoiDetector(const Params& p) : params_(p) {}
+
+const MultiRoiDetector::Params& MultiRoiDetector::params() const { return params_; }
+void MultiRoiDetector::setParams(const Params& p) { params_ = p; }
+const std::vector<cv::Rect>& MultiRoiDetector::clusters() const { return clusters_; }
+
+void MultiRoiDetector::mergeOverlapping(const std::vector<cv::Rect>& rects, const cv::Rect& canvas,
+                                        std::vector<cv::Rect>& merged, std::vector<int>& owner) {
+  merged.clear();
+  owner.assign(rects.size(), -1);
+  for (size_t i = 0; i < rects.size(); ++i) {
+    const cv::Rect r = rects[i] & canvas;
+    if (r.empty()) continue;
+    owner[i] = static_cast<int>(merged.size());
+    merged.push_back(r);
+  }
+
+  // Repeatedly fold overlapping clusters together until none overlap.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t a = 0; a < merged.size() && !changed; ++a) {
+      for (size_t b = a + 1; b < merged.size(); ++b) {
+        if ((merged[a] & merged[b]).empty()) continue;
+        merged[a] |= merged[b];
+        merged.erase(merged.begin() + static_cast<long>(b));
+        for (int& o : owner) {
+          if (o == static_cast<int>(b)) o = static_cast<int>(a);
+          else if (o > static_cast<int>(b)) --o;
+        }
+        changed = true;
+        break;
+      }
+    }
+  }
+}
+
+void MultiRoiDetector::detect(const cv::Mat& gray, const std::vector<cv::Rect>& rois,
+                              std::vector<std::vector<cv::Point2f>>& out) {
+  CV_Assert(!gray.empty() && gray.type() == CV_8UC1);
+  CV_Assert(params_.block_size >= 1);
+  const cv::Rect canvas(0, 0, gray.cols, gray.rows);
+  out.resize(rois.size());
+  for (auto& o : out) o.clear();
+  if (candidates_.size() < rois.size()) candidates_.resize(rois.size());
+
+  // ---- Cluster ROIs by their response support (block + Sobel + dilate margin) ----
+  const int margin = params_.block_size / 2 + 2;
+  clamped_.resize(rois.size());
+  support_.resize(rois.size());
+  for (size_t i = 0; i < rois.size(); ++i) {
+    const cv::Rect r = rois[i] & canvas;
+    clamped_[i] = r;
+    support_[i] = r.empty() ? r
+                            : cv::Rect(r.x - margin, r.y - margin,
+                                       r.width + 2 * margin, r.height + 2 * margin);
+  }
+  mergeOverlapping(support_, canvas, clusters_, owner_);
+
+  // ---- One response map per cluster, shared by every ROI inside it ----
+  if (response_.size() < clusters_.size()) {
+    response_.resize(clusters_.size());
+    dilated_.resize(clusters_.size());
+    products_.resize(clusters_.size());
+    column_sums_.resize(clusters_.size());
+  }
+  // Two-pointer captures fit std::function's inline storage: no allocation.
+  cv::parallel_for_(cv::Range(0, static_cast<int>(clusters_.size())), [this, &gray](const cv::Range& range) {
+    for (int c = range.start; c < range.end; ++c) {
+      computeResponse(gray, clusters_[c], products_[c], column_sums_[c], response_[c]);
+      dilate3x3(response_[c], dilated_[c]);
+    }
+  });
+
+  // ---- Per-ROI selection ----
+  cv::parallel_for_(cv::Range(0, static_cast<int>(rois.size())), [this, &out](const cv::Range& range) {
+    for (int i = range.start; i < range.end; ++i) {
+      if (owner_[i] < 0) continue;
+      selectInRoi(clamped_[i], owner_[i], candidates_[i], out[i]);
+    }
+  });
+}
+
+void MultiRoiDetector::computeResponse(const cv::Mat& gray, const cv::Rect& region, cv::Mat& products,
+                                       cv::Mat& column_sums, cv::Mat& response) const {
+  const int w = region.width, h = region.height;
+  products.create(h, w, CV_32FC3);
+  column_sums.create(h, w, CV_32FC3);
+  response.create(h, w, CV_32F);
+
+  // Same normalization as cornerEigenValsVecs for an 8-bit image and ksize 3.
+  const int block = params_.block_size;
+  const float scale = 1.0f / (4.0f * static_cast<float>(block) * 255.0f);
+
+  // ---- Sobel 3x3 gradients and their products ----
+  for (int y = 0; y < h; ++y) {
+    const int gy = region.y + y;
+    const uchar* up = gray.ptr<uchar>(reflect101(gy - 1, gray.rows));
+    const uchar* mid = gray.ptr<uchar>(gy);
+    const uchar* dn = gray.ptr<uchar>(reflect101(gy + 1, gray.rows));
+    float* p = products.ptr<float>(y);
+    for (int x = 0; x < w; ++x) {
+      const int gx = region.x + x;
+      const int l = reflect101(gx - 1, gray.cols), r = reflect101(gx + 1, gray.cols);
+      const float dx = static_cast<float>((up[r] - up[l]) + 2 * (mid[r] - mid[l]) + (dn[r] - dn[l])) * scale;
+      const float dy = static_cast<float>((dn[l] - up[l]) + 2 * (dn[gx] - up[gx]) + (dn[r] - up[r])) * scale;
+      p[3 * x] = dx * dx;
+      p[3 * x + 1] = dx * dy;
+      p[3 * x + 2] = dy * dy;
+    }
+  }
+
+  // ---- Unnormalized block sums (vertical, then horizontal) ----
+  const int anchor = block / 2;
+  for (int y = 0; y < h; ++y) {
+    float* s = column_sums.ptr<float>(y);
+    std::fill(s, s + 3 * w, 0.0f);
+    for (int k = 0; k < block; ++k) {
+      const float* p = products.ptr<float>(reflect101(y + k - anchor, h));
+      for (int i = 0; i < 3 * w; ++i) s[i] += p[i];
+    }
+  }
+  const float harris_k = static_cast<float>(params_.harris_k);
+  for (int y = 0; y < h; ++y) {
+    const float* s = column_sums.ptr<float>(y);
+    float* out = response.ptr<float>(y);
+    for (int x = 0; x < w; ++x) {
+      float a = 0.0f, b = 0.0f, c = 0.0f;
+      for (int k = 0; k < block; ++k) {
+        const float* q = s + 3 * reflect101(x + k - anchor, w);
+        a += q[0];
+        b += q[1];
+        c += q[2];
+      }
+      if (params_.use_harris) {
+        out[x] = a * c - b * b - harris_k * (a + c) * (a + c);
+      } else {
+        a *= 0.5f;
+        c *= 0.5f;
+        out[x] = (a + c) - std::sqrt((a - c) * (a - c) + b * b);
+      }
+    }
+  }
+}
+
+void MultiRoiDetector::dilate3x3(const cv::Mat& src, cv::Mat& dst) {
+  dst.create(src.rows, src.cols, CV_32F);
+  for (int y = 0; y < src.rows; ++y) {
+    const float* rows[3] = {src.ptr<float>(std::max(y - 1, 0)), src.ptr<float>(y),
+                            src.ptr<float>(std::min(y + 1, src.rows - 1))};
+    float* d = dst.ptr<float>(y);
+    for (int x = 0; x < src.cols; ++x) {
+      const int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, src.cols - 1);
+      float m = rows[0][x0];
+      for (const float* row : rows) {
+        for (int i = x0; i <= x1; ++i) m = std::max(m, row[i]);
+      }
+      d[x] = m;
+    }
+  }
+}
+
+void MultiRoiDetector::selectInRoi(const cv::Rect& roi, int cluster, std::vector<Candidate>& cand,
+                                   std::vector<cv::Point2f>& out) const {
+  const cv::Rect& cr = clusters_[cluster];
+  const cv::Rect local(roi.x - cr.x, roi.y - cr.y, roi.width, roi.height);
+  const cv::Mat resp = response_[cluster](local);
+  const cv::Mat dil = dilated_[cluster](local);
+
+  float max_resp = 0.0f;
+  for (int y = 0; y < resp.rows; ++y) {
+    const float* r = resp.ptr<float>(y);
+    for (int x = 0; x < resp.cols; ++x) max_resp = std::max(max_resp, r[x]);
+  }
+  if (max_resp <= 0.0f) return;
+  const float thresh = static_cast<float>(max_resp * params_.quality_level);
+
+  cand.clear();
+  for (int y = 0; y < resp.rows; ++y) {
+    const float* r = resp.ptr<float>(y);
+    const float* d = dil.ptr<float>(y);
+    for (int x = 0; x < resp.cols; ++x) {
+      if (r[x] > thresh && r[x] == d[x]) {
+        cand.push_back({r[x], cv::Point(x + roi.x, y + roi.y)});
+      }
+    }
+  }
+  // Strongest first, ties in raster order. std::sort, unlike std::stable_sort,
+  // needs no temporary buffer.
+  std::sort(cand.begin(), cand.end(), [](const Candidate& a, const Candidate& b) {
+    if (a.response != b.response) return a.response > b.response;
+    return a.pt.y != b.pt.y ? a.pt.y < b.pt.y : a.pt.x < b.pt.x;
+  });
+
+  const float d2min = static_cast<float>(params_.min_distance * params_.min_distance);
+  for (const auto& c : cand) {
+    if (params_.max_corners > 0 && static_cast<int>(out.size()) >= params_.max_corners) break;
+    const cv::Point2f p(static_cast<float>(c.pt.x), static_cast<float>(c.pt.y));
+    bool ok = true;
+    for (const auto& q : out) {
+      const float dx = q.x - p.x, dy = q.y - p.y;
+      if (dx*dx + dy*dy < d2min) { ok = false; break; }
+    }
+    if (ok) out.push_back(p);
+  }
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @file multi_roi_detector.hpp
+ * @brief Corner detection in many ROIs of one frame with shared preprocessing.
+ *
+ * @details
+ * The expensive part of Shi–Tomasi / Harris detection is the per-pixel corner
+ * response (structure tensor + eigenvalues). Detecting every ROI independently
+ * recomputes it wherever ROIs overlap, e.g. for people standing close together.
+ *
+ * This detector:
+ *   1) merges ROIs whose support windows overlap into clusters (bounding union),
+ *   2) computes the response map (min eigenvalue / Harris, as cornerMinEigenVal
+ *      / cornerHarris with a 3x3 Sobel) and its 3x3 dilation once per
+ *      cluster, clusters in parallel,
+ *   3) selects corners per ROI from its cluster's maps, ROIs in parallel,
+ *      following goodFeaturesToTrack: threshold at quality_level * ROI max,
+ *      local maxima only, strongest first, min_distance, max_corners.
+ *
+ * All maps and scratch buffers are members and are reused across frames, and
+ * the response is computed here rather than through cv::cornerMinEigenVal /
+ * cv::dilate, whose temporaries are allocated on every call: with unchanged
+ * ROI sizes a steady-state detect() does not touch the heap. The caller
+ * provides the single grayscale image shared by every ROI.
+ */
+class MultiRoiDetector {
+public:
+  struct Params {
+    int    max_corners   = 200;   ///< Max corners per ROI.
+    double quality_level = 0.01;  ///< Relative to the strongest response inside the ROI.
+    double min_distance  = 8.0;   ///< Minimum distance between corners of one ROI (px).
+    int    block_size    = 3;     ///< Structure-tensor window.
+    bool   use_harris    = false; ///< Harris response instead of min eigenvalue.
+    double harris_k      = 0.04;  ///< Harris free parameter.
+  };
+
+  MultiRoiDetector();
+  explicit MultiRoiDetector(const Params& p);
+
+  /**
+   * @brief Detect corners in every ROI of @p gray.
+   *
+   * @param gray Single-channel 8-bit image shared by all ROIs.
+   * @param rois ROIs in image coordinates (clamped; empty ROIs yield no corners).
+   * @param out  One corner list per ROI, image coordinates; inner vectors reused.
+   */
+  void detect(const cv::Mat& gray, const std::vector<cv::Rect>& rois,
+              std::vector<std::vector<cv::Point2f>>& out);
+
+  /**
+   * @brief Cluster rectangles that overlap (after clamping to @p canvas).
+   *
+   * @param rects   Input rectangles.
+   * @param canvas  Bounds to clamp to.
+   * @param merged  Output cluster rectangles (bounding union of their members).
+   * @param owner   Output cluster index per input rectangle (-1 if empty).
+   */
+  static void mergeOverlapping(const std::vector<cv::Rect>& rects, const cv::Rect& canvas,
+                               std::vector<cv::Rect>& merged, std::vector<int>& owner);
+
+  /** @brief Clusters used by the last detect() call. */
+  const std::vector<cv::Rect>& clusters() const;
+
+  const Params& params() const;
+  void setParams(const Params& p);
+
+private:
+  struct Candidate {
+    float response;
+    cv::Point pt;
+  };
+
+  /**
+   * @brief Corner response of @p region of @p gray into @p response.
+   *
+   * @details Sobel gradients (pixels outside @p region are read from @p gray,
+   *          reflect-101 at the image border), block sums of their products
+   *          (reflect-101 at the region border), then the min eigenvalue or
+   *          Harris score, scaled like OpenCV's.
+   */
+  void computeResponse(const cv::Mat& gray, const cv::Rect& region, cv::Mat& products,
+                       cv::Mat& column_sums, cv::Mat& response) const;
+
+  /** @brief 3x3 max filter; neighbours outside the map are ignored (like cv::dilate). */
+  static void dilate3x3(const cv::Mat& src, cv::Mat& dst);
+
+  void selectInRoi(const cv::Rect& roi, int cluster, std::vector<Candidate>& cand,
+                   std::vector<cv::Point2f>& out) const;
+
+  Params params_;
+  std::vector<cv::Rect> clamped_;       ///< ROIs clamped to the image.
+  std::vector<cv::Rect> support_;       ///< ROIs grown by the response support margin.
+  std::vector<cv::Rect> clusters_;
+  std::vector<int> owner_;
+  std::vector<cv::Mat> response_;       ///< Per-cluster corner response.
+  std::vector<cv::Mat> dilated_;        ///< Per-cluster 3x3 dilated response.
+  std::vector<cv::Mat> products_;       ///< Per-cluster (Ix^2, IxIy, Iy^2), CV_32FC3.
+  std::vector<cv::Mat> column_sums_;    ///< Per-cluster vertical block sums of products_.
+  std::vector<std::vector<Candidate>> candidates_;  ///< Per-ROI scratch.
+};
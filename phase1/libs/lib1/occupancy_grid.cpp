@@ -0,0 +1,150 @@
+#include "occupancy_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+namespace {
+
+constexpr int kFloatsPerLine = 64 / sizeof(float);
+
+}  // namespace
+
+void OccupancyGrid::FreeDeleter::operator()(float* p) const { std::free(p); }
+
+OccupancyGrid::OccupancyGrid() : OccupancyGrid(Params{}) {}
+
+OccupancyGrid::OccupancyGrid(const Params& p) : params_(p) {
+  if (!(params_.cell_size_m > 0.0f) || !(params_.range_m > 0.0f)) {
+    throw std::invalid_argument("OccupancyGrid: cell_size_m and range_m must be > 0");
+  }
+  if (params_.half_width_m <= 0.0f) params_.half_width_m = params_.range_m;
+
+  inv_cell_ = 1.0f / params_.cell_size_m;
+  rows_ = static_cast<int>(std::ceil(params_.range_m * inv_cell_));
+  cols_ = static_cast<int>(std::ceil(2.0f * params_.half_width_m * inv_cell_));
+  stride_ = (cols_ + kFloatsPerLine - 1) / kFloatsPerLine * kFloatsPerLine;
+
+  const std::size_t bytes = static_cast<std::size_t>(rows_) * stride_ * sizeof(float);
+  cells_.reset(static_cast<float*>(std::aligned_alloc(64, bytes)));
+  if (!cells_) throw std::bad_alloc();
+
+  cell_range_.resize(static_cast<std::size_t>(rows_) * cols_);
+  for (int r = 0; r < rows_; ++r) {
+    const float z = (r + 0.5f) * params_.cell_size_m;
+    for (int c = 0; c < cols_; ++c) {
+      const float x = (c + 0.5f) * params_.cell_size_m - params_.half_width_m;
+      cell_range_[static_cast<std::size_t>(r) * cols_ + c] = std::sqrt(x * x + z * z);
+    }
+  }
+  sat_.resize(static_cast<std::size_t>(rows_ + 1) * (cols_ + 1));
+  clear();
+}
+
+void OccupancyGrid::clear() {
+  std::memset(cells_.get(), 0, static_cast<std::size_t>(rows_) * stride_ * sizeof(float));
+  std::fill(sat_.begin(), sat_.end(), 0);
+  nearest_ = std::numeric_limits<float>::infinity();
+}
+
+void OccupancyGrid::decay() {
+  float* __restrict v = cells_.get();
+  const std::size_t n = static_cast<std::size_t>(rows_) * stride_;
+  const float k = params_.decay;
+  for (std::size_t i = 0; i < n; ++i) v[i] *= k;
+}
+
+bool OccupancyGrid::cellOf(float x, float z, int& row, int& col) const {
+  // Written so NaN fails the range checks.
+  const float fr = z * inv_cell_;
+  const float fc = (x + params_.half_width_m) * inv_cell_;
+  if (!(fr >= 0.0f && fr < static_cast<float>(rows_))) return false;
+  if (!(fc >= 0.0f && fc < static_cast<float>(cols_))) return false;
+  row = static_cast<int>(fr);
+  col = static_cast<int>(fc);
+  return true;
+}
+
+void OccupancyGrid::splat(const cv::Point3f* pts, std::size_t n) {
+  float* v = cells_.get();
+  const float hit = params_.hit;
+  const float sat = params_.saturation;
+  for (std::size_t i = 0; i < n; ++i) {
+    int r, c;
+    if (!cellOf(pts[i].x, pts[i].z, r, c)) continue;
+    float& cell = v[static_cast<std::size_t>(r) * stride_ + c];
+    cell = std::min(cell + hit, sat);
+  }
+}
+
+void OccupancyGrid::splat(const std::vector<cv::Point3f>& pts) {
+  splat(pts.data(), pts.size());
+}
+
+void OccupancyGrid::splatPixels(const Intrinsics& in, float camera_height_m,
+                                const cv::Point2f* uv, std::size_t n) {
+  project_scratch_.resize(n);
+  projectToGround(in, camera_height_m, uv, n, project_scratch_.data());
+  splat(project_scratch_.data(), n);
+}
+
+void OccupancyGrid::commit() {
+  const float thr = params_.occupied_threshold;
+  const float* v = cells_.get();
+  const int w = cols_ + 1;
+  float nearest = std::numeric_limits<float>::infinity();
+
+  for (int r = 0; r < rows_; ++r) {
+    const float* row = v + static_cast<std::size_t>(r) * stride_;
+    const float* range = cell_range_.data() + static_cast<std::size_t>(r) * cols_;
+    const std::int32_t* above = sat_.data() + static_cast<std::size_t>(r) * w;
+    std::int32_t* out = sat_.data() + static_cast<std::size_t>(r + 1) * w;
+    std::int32_t run = 0;
+    for (int c = 0; c < cols_; ++c) {
+      const bool occ = row[c] >= thr;
+      run += occ;
+      out[c + 1] = above[c + 1] + run;
+      if (occ && range[c] < nearest) nearest = range[c];
+    }
+  }
+  nearest_ = nearest;
+}
+
+float OccupancyGrid::nearestOccupiedRange() const { return nearest_; }
+bool OccupancyGrid::isOccupiedWithin(float range_m) const { return nearest_ <= range_m; }
+
+int OccupancyGrid::occupiedCells(const cv::Rect2f& zone_m) const {
+  const float s = inv_cell_;
+  const int c0 = std::max(0, static_cast<int>(std::floor((zone_m.x + params_.half_width_m) * s)));
+  const int c1 = std::min(cols_, static_cast<int>(std::ceil((zone_m.x + zone_m.width + params_.half_width_m) * s)));
+  const int r0 = std::max(0, static_cast<int>(std::floor(zone_m.y * s)));
+  const int r1 = std::min(rows_, static_cast<int>(std::ceil((zone_m.y + zone_m.height) * s)));
+  if (c0 >= c1 || r0 >= r1) return 0;
+  const int w = cols_ + 1;
+  const std::int32_t* t = sat_.data();
+  return t[r1 * w + c1] - t[r0 * w + c1] - t[r1 * w + c0] + t[r0 * w + c0];
+}
+
+bool OccupancyGrid::isOccupied(const cv::Rect2f& zone_m) const { return occupiedCells(zone_m) > 0; }
+int OccupancyGrid::occupiedCount() const { return sat_.back(); }
+
+int OccupancyGrid::rows() const { return rows_; }
+int OccupancyGrid::cols() const { return cols_; }
+const OccupancyGrid::Params& OccupancyGrid::params() const { return params_; }
+
+float OccupancyGrid::at(int row, int col) const {
+  CV_Assert(row >= 0 && row < rows_ && col >= 0 && col < cols_);
+  return cells_[static_cast<std::size_t>(row) * stride_ + col];
+}
+
+void OccupancyGrid::toMat(cv::Mat& out) const {
+  out.create(rows_, cols_, CV_32F);
+  for (int r = 0; r < rows_; ++r) {
+    std::memcpy(out.ptr<float>(r), cells_.get() + static_cast<std::size_t>(r) * stride_,
+                cols_ * sizeof(float));
+  }
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "intrinsics.hpp"
+
+/**
+ * @file occupancy_grid.hpp
+ * @brief Bird's-eye occupancy grid on the ground plane in front of the camera.
+ *
+ * @details
+ * Cells cover X in [-half_width_m, half_width_m) and Z in [0, range_m) in the
+ * camera's ground frame (the (X,0,Z) of pixelToGround()). Row 0 is nearest
+ * the camera. Values live in one flat, 64-byte aligned float buffer whose rows
+ * are padded to whole cache lines, so decay() is one straight vectorizable
+ * pass and splatting touches one cell per point.
+ *
+ * Per frame:
+ * \code{.cpp}
+ *   grid.decay();                      // fade the previous evidence
+ *   grid.splat(ground_points);         // or splatPixels(intrinsics, h, uv, n)
+ *   grid.commit();                     // refresh the query summary
+ *   if (grid.isOccupiedWithin(D_close_m)) { ... }
+ * \endcode
+ *
+ * commit() walks the grid once, records the nearest occupied range and builds
+ * a summed-area table of occupied cells. Every query after that is O(1), no
+ * matter how many consumers ask or how often.
+ */
+class OccupancyGrid {
+public:
+  struct Params {
+    float cell_size_m        = 0.05f; ///< Cell edge length (meters).
+    float range_m            = 5.0f;  ///< Forward extent; typically D_max_m.
+    float half_width_m       = 0.0f;  ///< Lateral half extent; 0 = same as range_m.
+    float decay              = 0.7f;  ///< Multiplier applied by decay() (0..1).
+    float hit                = 1.0f;  ///< Evidence added per splatted point.
+    float saturation         = 4.0f;  ///< Cap on a cell's value.
+    float occupied_threshold = 0.5f;  ///< A cell at or above this is occupied.
+  };
+
+  OccupancyGrid();
+  explicit OccupancyGrid(const Params& p);
+
+  /** @brief Zero every cell and the summary. */
+  void clear();
+
+  /** @brief Multiply every cell by Params::decay. */
+  void decay();
+
+  /**
+   * @brief Add evidence for ground points (X,0,Z). Points outside the grid or
+   *        with NaN coordinates are ignored.
+   */
+  void splat(const cv::Point3f* pts, std::size_t n);
+  void splat(const std::vector<cv::Point3f>& pts);
+
+  /**
+   * @brief Project pixels with the flat-ground model and splat the results.
+   *
+   * @details Same back-projection as HumanDetector::pixelsToGround(); pass the
+   *          detector's processing_intrinsics and camera height.
+   */
+  void splatPixels(const Intrinsics& in, float camera_height_m,
+                   const cv::Point2f* uv, std::size_t n);
+
+  /**
+   * @brief Recompute the query summary from the current cell values.
+   */
+  void commit();
+
+  // ---- O(1) queries (valid as of the last commit()) ----
+
+  /** @brief Range sqrt(X^2+Z^2) of the nearest occupied cell centre; +inf if none. */
+  float nearestOccupiedRange() const;
+
+  /** @brief Whether any occupied cell centre lies within @p range_m. */
+  bool isOccupiedWithin(float range_m) const;
+
+  /**
+   * @brief Number of occupied cells overlapping the ground rectangle @p zone_m
+   *        (x = lateral X, y = forward Z, meters).
+   */
+  int occupiedCells(const cv::Rect2f& zone_m) const;
+
+  /** @brief Whether any occupied cell overlaps @p zone_m. */
+  bool isOccupied(const cv::Rect2f& zone_m) const;
+
+  /** @brief Total occupied cells. */
+  int occupiedCount() const;
+
+  // ---- Raw access ----
+  int rows() const;
+  int cols() const;
+  float at(int row, int col) const;
+  const Params& params() const;
+
+  /**
+   * @brief Copy the grid into @p out (CV_32F, rows() x cols()).
+   *
+   * @details Row 0 is nearest the camera; flip vertically for a conventional
+   *          bird's-eye view, e.g. before cv::applyColorMap.
+   */
+  void toMat(cv::Mat& out) const;
+
+private:
+  struct FreeDeleter {
+    void operator()(float* p) const;
+  };
+
+  bool cellOf(float x, float z, int& row, int& col) const;
+
+  Params params_;
+  int rows_ = 0, cols_ = 0;
+  int stride_ = 0;                              ///< Floats per row (multiple of 16).
+  float inv_cell_ = 0.0f;
+  std::unique_ptr<float[], FreeDeleter> cells_; ///< rows_ * stride_, 64-byte aligned.
+  std::vector<float> cell_range_;               ///< Centre range per cell, rows_ * cols_.
+
+  // ---- Summary from commit() ----
+  std::vector<std::int32_t> sat_;               ///< (rows_+1) x (cols_+1) occupied prefix sums.
+  float nearest_ = 0.0f;
+  std::vector<cv::Point3f> project_scratch_;    ///< splatPixels() buffer.
+};
@@ -0,0 +1,156 @@
+#include "people_detector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+cv::HOGDescriptor makeHog() {
+  return cv::HOGDescriptor(cv::Size(PeopleDetector::kWinWidth, PeopleDetector::kWinHeight),
+                           cv::Size(16, 16), cv::Size(8, 8), cv::Size(8, 8), 9);
+}
+
+}  // namespace
+
+PeopleDetector::PeopleDetector() : PeopleDetector(Params{}) {}
+
+PeopleDetector::PeopleDetector(const Params& p) : params_(p), hog_(makeHog()) {
+  if (params_.svm_detector.empty()) {
+    hog_.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
+  } else {
+    hog_.setSVMDetector(params_.svm_detector);
+  }
+}
+
+void PeopleDetector::computeDescriptor(const cv::Mat& window, std::vector<float>& out) {
+  CV_Assert(window.cols == kWinWidth && window.rows == kWinHeight);
+  makeHog().compute(window, out);
+}
+
+const std::vector<PeopleDetector::Band>& PeopleDetector::bands() const { return bands_; }
+const PeopleDetector::Params& PeopleDetector::params() const { return params_; }
+
+void PeopleDetector::planBands(const Intrinsics& in, float camera_height_m, cv::Size image_size,
+                               const Params& p, std::vector<Band>& out) {
+  out.clear();
+  const float h = camera_height_m;
+  if (!(h > 0.0f) || image_size.area() <= 0 || p.scale_step <= 1.0) return;
+
+  // Feet must be on screen and below the horizon (v > cy).
+  const int last_row = image_size.height - 1;
+  const double tallest_px = p.person_height_max_m * (last_row - in.cy) / h;
+  const double cap = p.max_person_px > 0 ? p.max_person_px : image_size.height;
+  const double largest = std::min(tallest_px, cap);
+  const double half_step = std::sqrt(p.scale_step);
+
+  for (double person_px = p.min_person_px; person_px <= largest; person_px *= p.scale_step) {
+    // This scale covers people of [person_px / half_step, person_px * half_step) pixels.
+    const double lo = person_px / half_step;
+    const double hi = person_px * half_step;
+    const int foot_min = std::max(0, static_cast<int>(std::ceil(in.cy + lo * h / p.person_height_max_m)));
+    const int foot_max = std::min(last_row, static_cast<int>(std::floor(in.cy + hi * h / p.person_height_min_m)));
+    if (foot_min > foot_max) continue;
+
+    Band b;
+    b.scale = person_px / kPersonPx;
+    b.foot_min = foot_min;
+    b.foot_max = foot_max;
+    const int win_h = static_cast<int>(std::lround(kWinHeight * b.scale));
+    const int win_w = static_cast<int>(std::lround(kWinWidth * b.scale));
+    if (win_h > image_size.height || win_w > image_size.width) break;
+
+    int top = foot_min - static_cast<int>(std::lround((kTopPad + kPersonPx) * b.scale));
+    int bottom = foot_max + static_cast<int>(std::lround((kWinHeight - kTopPad - kPersonPx) * b.scale)) + 1;
+    top = std::max(0, top);
+    bottom = std::min(image_size.height, bottom);
+    // Windows that start above the band still need a full window of rows.
+    if (bottom - top < win_h) {
+      bottom = std::min(image_size.height, top + win_h);
+      top = bottom - win_h;
+    }
+    b.region = cv::Rect(0, top, image_size.width, bottom - top);
+    out.push_back(b);
+  }
+}
+
+void PeopleDetector::setGeometry(const Intrinsics& in, float camera_height_m, cv::Size image_size) {
+  if (in.fx == in_.fx && in.fy == in_.fy && in.cx == in_.cx && in.cy == in_.cy &&
+      camera_height_m == camera_height_m_ && image_size == image_size_ && !bands_.empty()) {
+    return;
+  }
+  in_ = in;
+  camera_height_m_ = camera_height_m;
+  image_size_ = image_size;
+  planBands(in_, camera_height_m_, image_size_, params_, bands_);
+  band_img_.resize(bands_.size());
+  band_locs_.resize(bands_.size());
+  band_weights_.resize(bands_.size());
+  band_hits_.resize(bands_.size());
+}
+
+void PeopleDetector::detect(const cv::Mat& image, std::vector<Detection>& out) {
+  out.clear();
+  if (bands_.empty()) return;
+  CV_Assert(image.size() == image_size_ && image.depth() == CV_8U);
+  if (image.channels() == 3) {
+    cv::cvtColor(image, gray_, cv::COLOR_BGR2GRAY);
+  } else {
+    gray_ = image;
+  }
+
+  cv::parallel_for_(cv::Range(0, static_cast<int>(bands_.size())), [&](const cv::Range& range) {
+    for (int b = range.start; b < range.end; ++b) {
+      const Band& band = bands_[b];
+      std::vector<Detection>& hits = band_hits_[b];
+      hits.clear();
+
+      const cv::Size small(static_cast<int>(std::lround(band.region.width / band.scale)),
+                           static_cast<int>(std::lround(band.region.height / band.scale)));
+      if (small.width < kWinWidth || small.height < kWinHeight) continue;
+      cv::resize(gray_(band.region), band_img_[b], small, 0, 0,
+                 band.scale > 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+      hog_.detect(band_img_[b], band_locs_[b], band_weights_[b], params_.hit_threshold,
+                  cv::Size(params_.win_stride, params_.win_stride), cv::Size(0, 0));
+
+      const double sx = static_cast<double>(band.region.width) / small.width;
+      const double sy = static_cast<double>(band.region.height) / small.height;
+      for (size_t i = 0; i < band_locs_[b].size(); ++i) {
+        const cv::Point& loc = band_locs_[b][i];
+        const float foot_v = static_cast<float>(band.region.y + (loc.y + kTopPad + kPersonPx) * sy);
+        if (foot_v < band.foot_min || foot_v > band.foot_max + 1) continue;
+
+        Detection d;
+        d.box = cv::Rect(static_cast<int>(std::lround(band.region.x + loc.x * sx)),
+                         static_cast<int>(std::lround(band.region.y + loc.y * sy)),
+                         static_cast<int>(std::lround(kWinWidth * sx)),
+                         static_cast<int>(std::lround(kWinHeight * sy)));
+        d.score = i < band_weights_[b].size() ? band_weights_[b][i] : 0.0;
+        d.foot = {static_cast<float>(band.region.x + (loc.x + 0.5 * kWinWidth) * sx), foot_v};
+        if (!projectToGround(in_, camera_height_m_, d.foot, &d.ground)) continue;
+        d.height_m = static_cast<float>(kPersonPx * sy) * camera_height_m_ / (foot_v - in_.cy);
+        hits.push_back(d);
+      }
+    }
+  });
+
+  for (const auto& hits : band_hits_) out.insert(out.end(), hits.begin(), hits.end());
+  suppress(out, params_.nms_iou);
+}
+
+void PeopleDetector::suppress(std::vector<Detection>& dets, double iou) {
+  std::sort(dets.begin(), dets.end(),
+            [](const Detection& a, const Detection& b) { return a.score > b.score; });
+  size_t kept = 0;
+  for (size_t i = 0; i < dets.size(); ++i) {
+    bool keep = true;
+    for (size_t k = 0; k < kept && keep; ++k) {
+      const double inter = (dets[i].box & dets[k].box).area();
+      const double uni = dets[i].box.area() + dets[k].box.area() - inter;
+      keep = uni <= 0.0 || inter / uni <= iou;
+    }
+    if (keep) dets[kept++] = dets[i];
+  }
+  dets.resize(kept);
+}
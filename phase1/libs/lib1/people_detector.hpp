@@ -0,0 +1,127 @@
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+#include "intrinsics.hpp"
+
+/**
+ * @file people_detector.hpp
+ * @brief HOG people detector that searches only the scales the ground geometry allows.
+ *
+ * @details
+ * Under the flat-ground, zero-tilt model of HumanDetector a person of height
+ * H standing with their feet on image row v is
+ *
+ *   pixel height = fy * H / Z = H * (v - cy) / h        (Z = fy * h / (v - cy))
+ *
+ * pixels tall, independent of fx/fy. So for each detection scale only a band
+ * of foot rows is physically possible. Instead of cv::HOGDescriptor::
+ * detectMultiScale scanning every scale over the whole frame, the detector
+ * plans a ladder of scales (one per scale_step) and, for each, the image band
+ * that can contain a person of Params::person_height_min_m..max_m at that
+ * scale. Each band is resized once and scanned at its single scale with the
+ * default OpenCV people SVM (no model files) or a caller-supplied linear SVM
+ * over the same descriptor (Params::svm_detector); bands run in parallel
+ * (cv::parallel_for_). Hits whose feet land outside the band's feasible rows
+ * are dropped, the rest are merged with greedy non-maximum suppression and
+ * back-projected to the ground from their foot point.
+ *
+ * The 64x128 HOG window holds a person about 96 px tall with ~16 px margin
+ * above and below; the constants below encode that layout.
+ */
+class PeopleDetector {
+public:
+  static constexpr int kWinWidth = 64;    ///< HOG window width (px at scale 1).
+  static constexpr int kWinHeight = 128;  ///< HOG window height.
+  static constexpr int kPersonPx = 96;    ///< Person height inside the window.
+  static constexpr int kTopPad = 16;      ///< Window rows above the head.
+
+  struct Params {
+    float  person_height_min_m = 1.5f;   ///< Shortest person searched for.
+    float  person_height_max_m = 2.0f;   ///< Tallest person searched for.
+    double scale_step          = 1.2;    ///< Ratio between consecutive scales.
+    int    min_person_px       = 64;     ///< Smallest person height searched (px).
+    int    max_person_px       = 0;      ///< Largest person height searched (0 = image height).
+    double hit_threshold       = 0.0;    ///< SVM margin threshold.
+    int    win_stride          = 8;      ///< Window stride at each scale (px of the resized band).
+    double nms_iou             = 0.4;    ///< Suppress overlaps above this IoU.
+    std::vector<float> svm_detector;     ///< Linear SVM weights + bias (see computeDescriptor()); empty = OpenCV's default people SVM.
+  };
+
+  /**
+   * @brief One scale of the search plan.
+   */
+  struct Band {
+    double scale = 1.0;        ///< Window scale (person px / kPersonPx).
+    int    foot_min = 0;       ///< Feasible foot rows [foot_min, foot_max].
+    int    foot_max = 0;
+    cv::Rect region;           ///< Image area scanned at this scale.
+  };
+
+  struct Detection {
+    cv::Rect box;              ///< Person bounding box (HOG window, image coords).
+    double score = 0.0;        ///< SVM margin.
+    cv::Point2f foot;          ///< Bottom-centre of the person (image coords).
+    cv::Point3f ground;        ///< projectToGround(foot).
+    float height_m = 0.0f;     ///< Person height implied by box scale and foot row.
+  };
+
+  PeopleDetector();
+  /**
+   * @throws cv::Exception if Params::svm_detector is neither empty nor the
+   *         descriptor size (+1 for the bias).
+   */
+  explicit PeopleDetector(const Params& p);
+
+  /**
+   * @brief Plan the search for a camera. Cheap when nothing changed.
+   *
+   * @param in              Intrinsics at the resolution of the images passed to detect().
+   * @param camera_height_m Camera height above the ground.
+   * @param image_size      Size of the images passed to detect().
+   */
+  void setGeometry(const Intrinsics& in, float camera_height_m, cv::Size image_size);
+
+  /**
+   * @brief Detect people in @p image (8-bit gray or BGR, size as in setGeometry()).
+   *
+   * @param out Detections, strongest first; cleared first.
+   */
+  void detect(const cv::Mat& image, std::vector<Detection>& out);
+
+  const std::vector<Band>& bands() const;
+  const Params& params() const;
+
+  /**
+   * @brief Compute the scale/band plan (what setGeometry() stores).
+   */
+  static void planBands(const Intrinsics& in, float camera_height_m, cv::Size image_size,
+                        const Params& p, std::vector<Band>& out);
+
+  /**
+   * @brief Greedy NMS: keep the strongest box, drop any overlapping it by more
+   *        than @p iou, repeat. Sorts @p dets by score (descending).
+   */
+  static void suppress(std::vector<Detection>& dets, double iou);
+
+  /**
+   * @brief HOG descriptor of a kWinWidth x kWinHeight window, exactly as
+   *        detect() scores it; for building a Params::svm_detector.
+   */
+  static void computeDescriptor(const cv::Mat& window, std::vector<float>& out);
+
+private:
+  Params params_;
+  cv::HOGDescriptor hog_;
+  Intrinsics in_{};
+  float camera_height_m_ = 0.0f;
+  cv::Size image_size_{};
+  std::vector<Band> bands_;
+
+  // ---- Per-band scratch (indexed like bands_) ----
+  cv::Mat gray_;
+  std::vector<cv::Mat> band_img_;
+  std::vector<std::vector<cv::Point>> band_locs_;
+  std::vector<std::vector<double>> band_weights_;
+  std::vector<std::vector<Detection>> band_hits_;
+};
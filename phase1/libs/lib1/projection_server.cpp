@@ -0,0 +1,414 @@
+#include "projection_server.hpp"
+#include "camera_model.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+sockaddr_un socketAddress(const std::string& path, const char* who) {
+  sockaddr_un addr{};
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error(std::string(who) + ": socket path too long: " + path);
+  }
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return addr;
+}
+
+template <typename T>
+void append(std::vector<unsigned char>& buf, const T* data, std::size_t n) {
+  const auto* p = reinterpret_cast<const unsigned char*>(data);
+  buf.insert(buf.end(), p, p + n * sizeof(T));
+}
+
+}  // namespace
+
+// --- Server ---
+ProjectionServer::ProjectionServer(const std::string& socket_path)
+: ProjectionServer(socket_path, Params{}) {}
+
+ProjectionServer::ProjectionServer(const std::string& socket_path, const Params& p)
+: path_(socket_path), params_(p) {
+  if (params_.latency_window < 1) {
+    throw std::invalid_argument("ProjectionServer: latency_window must be >= 1");
+  }
+  const sockaddr_un addr = socketAddress(path_, "ProjectionServer");
+
+  listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    throw std::runtime_error("ProjectionServer: socket() failed: " + std::string(std::strerror(errno)));
+  }
+  ::unlink(path_.c_str());  // stale socket from a previous run
+  if (::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      ::listen(listen_fd_, SOMAXCONN) != 0) {
+    const int err = errno;
+    ::close(listen_fd_);
+    throw std::runtime_error("ProjectionServer: could not listen on " + path_ + ": " + std::strerror(err));
+  }
+  if (::pipe2(wake_, O_NONBLOCK | O_CLOEXEC) != 0) {
+    const int err = errno;
+    ::close(listen_fd_);
+    ::unlink(path_.c_str());
+    throw std::runtime_error("ProjectionServer: pipe2() failed: " + std::string(std::strerror(err)));
+  }
+  latencies_us_.reserve(params_.latency_window);
+}
+
+ProjectionServer::~ProjectionServer() {
+  stop();
+  ::close(listen_fd_);
+  ::close(wake_[0]);
+  ::close(wake_[1]);
+  ::unlink(path_.c_str());
+}
+
+void ProjectionServer::addCamera(std::uint32_t camera_id, const Intrinsics& in,
+                                 float camera_height_m) {
+  std::lock_guard<std::mutex> lock(cameras_mutex_);
+  cameras_[camera_id] = Camera{in, camera_height_m};
+}
+
+bool ProjectionServer::addCamera(std::uint32_t camera_id, const std::string& intrinsics_path,
+                                 float camera_height_m) {
+  CameraModel model(intrinsics_path);
+  if (model.intrinsics.fx == 0.0f || model.intrinsics.fy == 0.0f) {
+    std::cerr << "Error: no intrinsics loaded from " << intrinsics_path << std::endl;
+    return false;
+  }
+  addCamera(camera_id, model.intrinsics, camera_height_m);
+  return true;
+}
+
+void ProjectionServer::removeCamera(std::uint32_t camera_id) {
+  std::lock_guard<std::mutex> lock(cameras_mutex_);
+  cameras_.erase(camera_id);
+}
+
+void ProjectionServer::start() {
+  if (running_.exchange(true)) return;
+  thread_ = std::thread(&ProjectionServer::run, this);
+}
+
+void ProjectionServer::stop() {
+  if (!running_.exchange(false)) return;
+  const char byte = 1;
+  (void)::write(wake_[1], &byte, 1);
+  if (thread_.joinable()) thread_.join();
+
+  char drain[16];
+  while (::read(wake_[0], drain, sizeof(drain)) > 0) {}
+  for (auto& c : conns_) ::close(c.fd);
+  conns_.clear();
+}
+
+void ProjectionServer::run() {
+  std::vector<pollfd> fds;
+  while (running_.load()) {
+    fds.clear();
+    fds.push_back({wake_[0], POLLIN, 0});
+    fds.push_back({listen_fd_, POLLIN, 0});
+    for (const auto& c : conns_) {
+      const short events = c.out_off < c.out.size() ? (POLLIN | POLLOUT) : POLLIN;
+      fds.push_back({c.fd, events, 0});
+    }
+
+    if (::poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "Error: ProjectionServer poll() failed: " << std::strerror(errno) << std::endl;
+      break;
+    }
+    if (fds[0].revents) break;  // stop()
+
+    // Read every ready connection first, then answer all of it at once.
+    for (std::size_t i = 0; i < conns_.size(); ++i) {
+      const short re = fds[i + 2].revents;
+      if (re & POLLOUT) flush(conns_[i]);
+      if (re & (POLLIN | POLLHUP | POLLERR)) receive(i);
+    }
+    answer();
+
+    if (fds[1].revents & POLLIN) accept();  // appends; indices above stay valid
+
+    conns_.erase(std::remove_if(conns_.begin(), conns_.end(), [](const Connection& c) {
+                   if (c.closed) ::close(c.fd);
+                   return c.closed;
+                 }),
+                 conns_.end());
+  }
+}
+
+void ProjectionServer::accept() {
+  for (;;) {
+    const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      return;  // EAGAIN: backlog empty
+    }
+    if (static_cast<int>(conns_.size()) >= params_.max_clients) {
+      ::close(fd);
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      ++stats_.rejected;
+      continue;
+    }
+    Connection c;
+    c.fd = fd;
+    conns_.push_back(std::move(c));
+  }
+}
+
+void ProjectionServer::receive(std::size_t conn) {
+  using projection_wire::RequestHeader;
+  Connection& c = conns_[conn];
+
+  unsigned char buf[64 * 1024];
+  for (;;) {
+    const ssize_t r = ::recv(c.fd, buf, sizeof(buf), 0);
+    if (r > 0) {
+      c.in.insert(c.in.end(), buf, buf + r);
+      continue;
+    }
+    if (r < 0 && errno == EINTR) continue;
+    if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) c.closed = true;
+    break;
+  }
+
+  // Queue every complete request; a partial one waits for the next cycle.
+  const auto now = std::chrono::steady_clock::now();
+  std::size_t off = 0;
+  while (c.in.size() - off >= sizeof(RequestHeader)) {
+    RequestHeader h;
+    std::memcpy(&h, c.in.data() + off, sizeof(h));
+    if (h.magic != projection_wire::kMagic || h.version != projection_wire::kVersion ||
+        h.count > projection_wire::kMaxPoints) {
+      c.closed = true;
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      ++stats_.rejected;
+      break;
+    }
+    const std::size_t need = sizeof(h) + h.count * sizeof(cv::Point2f);
+    if (c.in.size() - off < need) break;
+
+    Batch& b = batches_[h.camera_id];
+    Pending p;
+    p.conn = conn;
+    p.request_id = h.request_id;
+    p.camera_id = h.camera_id;
+    p.count = h.count;
+    p.offset = b.uv.size();
+    p.received = now;
+    b.uv.resize(p.offset + h.count);
+    std::memcpy(b.uv.data() + p.offset, c.in.data() + off + sizeof(h), h.count * sizeof(cv::Point2f));
+    b.pending.push_back(pending_.size());
+    pending_.push_back(p);
+    off += need;
+  }
+  c.in.erase(c.in.begin(), c.in.begin() + off);
+}
+
+void ProjectionServer::answer() {
+  using projection_wire::ResponseHeader;
+  if (pending_.empty()) return;
+
+  // One projectToGround() per camera over all of its points in this cycle.
+  std::uint64_t batches = 0, coalesced = 0, points = 0;
+  for (auto& [camera_id, b] : batches_) {
+    if (b.pending.empty()) continue;
+    b.known = false;
+    Camera cam;
+    {
+      std::lock_guard<std::mutex> lock(cameras_mutex_);
+      const auto found = cameras_.find(camera_id);
+      if (found != cameras_.end()) {
+        cam = found->second;
+        b.known = true;
+      }
+    }
+    if (!b.known) continue;
+    b.ground.resize(b.uv.size());
+    projectToGround(cam.intrinsics, cam.height_m, b.uv.data(), b.uv.size(), b.ground.data());
+    ++batches;
+    points += b.uv.size();
+    if (b.pending.size() > 1) coalesced += b.pending.size();
+  }
+
+  // Responses in arrival order, so each connection is answered in order.
+  for (const Pending& p : pending_) {
+    const Batch& b = batches_.find(p.camera_id)->second;
+    Connection& c = conns_[p.conn];
+    ResponseHeader r{};
+    r.magic = projection_wire::kMagic;
+    r.version = projection_wire::kVersion;
+    r.status = static_cast<std::uint16_t>(b.known ? projection_wire::Status::OK
+                                                  : projection_wire::Status::UNKNOWN_CAMERA);
+    r.camera_id = p.camera_id;
+    r.count = b.known ? p.count : 0;
+    r.request_id = p.request_id;
+    append(c.out, &r, 1);
+    for (std::uint32_t j = 0; j < r.count; ++j) {
+      const cv::Point3f& g = b.ground[p.offset + j];
+      const projection_wire::GroundXZ xz{g.x, g.z};
+      append(c.out, &xz, 1);
+    }
+  }
+
+  // Keep buffers of registered cameras; forget ids nobody registered.
+  for (auto it = batches_.begin(); it != batches_.end();) {
+    it->second.uv.clear();
+    it->second.pending.clear();
+    it = it->second.known ? std::next(it) : batches_.erase(it);
+  }
+
+  // Count before sending, so a client that has its answer also sees it in stats().
+  const auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.requests += pending_.size();
+    stats_.points += points;
+    stats_.batches += batches;
+    stats_.coalesced += coalesced;
+    for (const auto& p : pending_) {
+      const double us = std::chrono::duration<double, std::micro>(now - p.received).count();
+      if (static_cast<int>(latencies_us_.size()) < params_.latency_window) {
+        latencies_us_.push_back(us);
+      } else {
+        latencies_us_[latency_next_] = us;
+      }
+      latency_next_ = (latency_next_ + 1) % params_.latency_window;
+    }
+  }
+  pending_.clear();
+
+  for (auto& c : conns_) {
+    if (c.out_off < c.out.size()) flush(c);
+  }
+}
+
+void ProjectionServer::flush(Connection& c) {
+  while (!c.closed && c.out_off < c.out.size()) {
+    const ssize_t w = ::send(c.fd, c.out.data() + c.out_off, c.out.size() - c.out_off, MSG_NOSIGNAL);
+    if (w > 0) {
+      c.out_off += static_cast<std::size_t>(w);
+    } else if (w < 0 && errno == EINTR) {
+      continue;
+    } else if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;  // socket full; poll() reports POLLOUT when it drains
+    } else {
+      c.closed = true;
+    }
+  }
+  c.out.clear();
+  c.out_off = 0;
+}
+
+ProjectionServer::Stats ProjectionServer::stats() const {
+  std::vector<double> lat;
+  Stats s;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    s = stats_;
+    lat = latencies_us_;
+  }
+  if (lat.empty()) return s;
+
+  double sum = 0.0;
+  for (double v : lat) sum += v;
+  s.latency_mean_us = sum / lat.size();
+  auto pct = [&](double q) {
+    const std::size_t k = std::min(lat.size() - 1, static_cast<std::size_t>(q * lat.size()));
+    std::nth_element(lat.begin(), lat.begin() + k, lat.end());
+    return lat[k];
+  };
+  s.latency_p50_us = pct(0.50);
+  s.latency_p99_us = pct(0.99);
+  s.latency_max_us = *std::max_element(lat.begin(), lat.end());
+  return s;
+}
+
+const std::string& ProjectionServer::socketPath() const { return path_; }
+
+// --- Client ---
+ProjectionClient::ProjectionClient(const std::string& socket_path) {
+  const sockaddr_un addr = socketAddress(socket_path, "ProjectionClient");
+  fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0 || ::connect(fd_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+    const int err = errno;
+    if (fd_ >= 0) ::close(fd_);
+    throw std::runtime_error("ProjectionClient: could not connect to " + socket_path + ": " + std::strerror(err));
+  }
+}
+
+ProjectionClient::~ProjectionClient() {
+  if (fd_ >= 0) ::close(fd_);
+}
+
+bool ProjectionClient::project(std::uint32_t camera_id, const std::vector<cv::Point2f>& uv,
+                               std::vector<cv::Point3f>& out) {
+  if (uv.size() > projection_wire::kMaxPoints) {
+    throw std::invalid_argument("ProjectionClient: too many points in one request");
+  }
+  const auto t0 = std::chrono::steady_clock::now();
+
+  projection_wire::RequestHeader h{};
+  h.magic = projection_wire::kMagic;
+  h.version = projection_wire::kVersion;
+  h.camera_id = camera_id;
+  h.count = static_cast<std::uint32_t>(uv.size());
+  h.request_id = next_id_++;
+  sendAll(&h, sizeof(h));
+  if (!uv.empty()) sendAll(uv.data(), uv.size() * sizeof(cv::Point2f));
+
+  projection_wire::ResponseHeader r;
+  recvAll(&r, sizeof(r));
+  if (r.magic != projection_wire::kMagic || r.request_id != h.request_id) {
+    throw std::runtime_error("ProjectionClient: malformed response");
+  }
+  xz_.resize(r.count);
+  if (r.count > 0) recvAll(xz_.data(), r.count * sizeof(projection_wire::GroundXZ));
+  last_latency_us_ = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - t0).count();
+
+  if (r.status != static_cast<std::uint16_t>(projection_wire::Status::OK)) {
+    out.clear();
+    return false;
+  }
+  if (r.count != uv.size()) {
+    throw std::runtime_error("ProjectionClient: malformed response");
+  }
+  out.resize(r.count);
+  for (std::size_t i = 0; i < out.size(); ++i) out[i] = {xz_[i].x, 0.0f, xz_[i].z};
+  return true;
+}
+
+double ProjectionClient::lastLatencyUs() const { return last_latency_us_; }
+
+void ProjectionClient::sendAll(const void* data, std::size_t n) {
+  const auto* p = static_cast<const unsigned char*>(data);
+  while (n > 0) {
+    const ssize_t w = ::send(fd_, p, n, MSG_NOSIGNAL);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) throw std::runtime_error("ProjectionClient: connection lost");
+    p += w;
+    n -= static_cast<std::size_t>(w);
+  }
+}
+
+void ProjectionClient::recvAll(void* data, std::size_t n) {
+  auto* p = static_cast<unsigned char*>(data);
+  while (n > 0) {
+    const ssize_t r = ::recv(fd_, p, n, 0);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) throw std::runtime_error("ProjectionClient: connection lost");
+    p += r;
+    n -= static_cast<std::size_t>(r);
+  }
+}
@@ -0,0 +1,237 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "intrinsics.hpp"
+
+/**
+ * @file projection_server.hpp
+ * @brief Local pixel-to-ground query service over a Unix domain socket.
+ *
+ * @details
+ * Other processes send a camera id and a batch of (u,v) pixels. They get back
+ * the flat-ground (X,Z) of each pixel, computed with the same batched
+ * projectToGround() HumanDetector uses. Camera intrinsics and heights stay
+ * resident in the server, so no client has to load a calibration or open a
+ * window.
+ *
+ * Wire format (native endianness, one request per message, any number of
+ * messages per connection, answered in order):
+ *   request:  RequestHeader  + count * {float u, float v}
+ *   response: ResponseHeader + count * {float X, float Z}   (NaN if v ~= cy)
+ *
+ * One thread serves all connections. Each poll() cycle reads whatever has
+ * arrived on every ready socket and groups the complete requests by camera.
+ * Each camera's points are then projected in one contiguous batch, and the
+ * results are scattered back to the individual responses. Concurrent clients
+ * are therefore coalesced without any per-request thread or lock.
+ */
+namespace projection_wire {
+
+constexpr std::uint32_t kMagic = 0x4A525050;   // "PPRJ"
+constexpr std::uint16_t kVersion = 1;
+constexpr std::uint32_t kMaxPoints = 1u << 16; ///< Points per request.
+
+/// Response status.
+enum class Status : std::uint16_t {
+  OK = 0,              ///< @c count ground points follow.
+  UNKNOWN_CAMERA = 1,  ///< No camera registered under the id; no points follow.
+};
+
+struct RequestHeader {
+  std::uint32_t magic;
+  std::uint16_t version;
+  std::uint16_t reserved;
+  std::uint32_t camera_id;
+  std::uint32_t count;       ///< Number of (u,v) pairs that follow.
+  std::uint64_t request_id;  ///< Echoed in the response.
+};
+
+struct ResponseHeader {
+  std::uint32_t magic;
+  std::uint16_t version;
+  std::uint16_t status;      ///< Status.
+  std::uint32_t camera_id;
+  std::uint32_t count;       ///< Number of (X,Z) pairs that follow.
+  std::uint64_t request_id;
+};
+
+struct GroundXZ {
+  float x;
+  float z;
+};
+
+static_assert(sizeof(RequestHeader) == 24 && sizeof(ResponseHeader) == 24,
+              "wire headers must not contain padding");
+
+}  // namespace projection_wire
+
+class ProjectionServer {
+public:
+  struct Params {
+    int latency_window = 4096;  ///< Requests kept for the latency percentiles.
+    int max_clients    = 64;    ///< Further connections are closed on accept.
+  };
+
+  /**
+   * @brief Server-side counters; latencies run from receipt of the last byte
+   *        of a request to its response being ready to send.
+   */
+  struct Stats {
+    std::uint64_t requests = 0;     ///< Requests answered.
+    std::uint64_t points = 0;       ///< Points projected.
+    std::uint64_t batches = 0;      ///< Batched projectToGround() calls.
+    std::uint64_t coalesced = 0;    ///< Requests that shared a batch with another.
+    std::uint64_t rejected = 0;     ///< Connections dropped for malformed input.
+    double latency_mean_us = 0.0;   ///< Over the latency window.
+    double latency_p50_us = 0.0;
+    double latency_p99_us = 0.0;
+    double latency_max_us = 0.0;
+  };
+
+  /**
+   * @brief Bind and listen on @p socket_path (an existing socket file is replaced).
+   *
+   * @throws std::runtime_error if the socket cannot be created or bound.
+   * @throws std::invalid_argument if Params::latency_window < 1.
+   */
+  explicit ProjectionServer(const std::string& socket_path);
+  ProjectionServer(const std::string& socket_path, const Params& p);
+  ~ProjectionServer();
+
+  ProjectionServer(const ProjectionServer&) = delete;
+  ProjectionServer& operator=(const ProjectionServer&) = delete;
+
+  /**
+   * @brief Register or replace a camera; takes effect for the next batch.
+   *
+   * @param camera_id       Id clients put in RequestHeader::camera_id.
+   * @param in              Intrinsics the clients' pixels refer to.
+   * @param camera_height_m Camera height above the ground plane.
+   */
+  void addCamera(std::uint32_t camera_id, const Intrinsics& in, float camera_height_m);
+
+  /**
+   * @brief Register a camera from a CameraModel input (CSV or calibration video).
+   *
+   * @return false if no intrinsics could be loaded from @p intrinsics_path.
+   */
+  bool addCamera(std::uint32_t camera_id, const std::string& intrinsics_path,
+                 float camera_height_m);
+
+  /** @brief Unregister a camera; later requests for it get UNKNOWN_CAMERA. */
+  void removeCamera(std::uint32_t camera_id);
+
+  /** @brief Start the serving thread (no-op if already running). */
+  void start();
+
+  /** @brief Stop the serving thread and close all client connections. */
+  void stop();
+
+  Stats stats() const;
+  const std::string& socketPath() const;
+
+private:
+  struct Camera {
+    Intrinsics intrinsics;
+    float height_m = 0.0f;
+  };
+
+  struct Connection {
+    int fd = -1;
+    std::vector<unsigned char> in;   ///< Received bytes not yet parsed.
+    std::vector<unsigned char> out;  ///< Response bytes not yet sent.
+    std::size_t out_off = 0;
+    bool closed = false;
+  };
+
+  /// A parsed request waiting for this cycle's batch.
+  struct Pending {
+    std::size_t conn = 0;            ///< Index into @ref conns_.
+    std::uint64_t request_id = 0;
+    std::uint32_t camera_id = 0;
+    std::uint32_t count = 0;
+    std::size_t offset = 0;          ///< First point in its camera's batch.
+    std::chrono::steady_clock::time_point received;
+  };
+
+  /// All of one camera's points in this cycle, contiguous.
+  struct Batch {
+    std::vector<cv::Point2f> uv;
+    std::vector<cv::Point3f> ground;
+    std::vector<std::size_t> pending;  ///< Indices into @ref pending_.
+    bool known = false;                ///< Camera registered when last answered.
+  };
+
+  void run();
+  void accept();
+  void receive(std::size_t conn);
+  void answer();
+  void flush(Connection& c);
+
+  std::string path_;
+  Params params_;
+  int listen_fd_ = -1;
+  int wake_[2] = {-1, -1};           ///< Self-pipe that interrupts poll() on stop().
+
+  mutable std::mutex cameras_mutex_;
+  std::unordered_map<std::uint32_t, Camera> cameras_;
+
+  // ---- Serving-thread state; reused every cycle ----
+  std::vector<Connection> conns_;
+  std::vector<Pending> pending_;
+  std::unordered_map<std::uint32_t, Batch> batches_;
+
+  mutable std::mutex stats_mutex_;
+  Stats stats_;
+  std::vector<double> latencies_us_; ///< Ring of the last latency_window latencies.
+  std::size_t latency_next_ = 0;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+};
+
+/**
+ * @brief Blocking client for ProjectionServer; one connection, one request at a time.
+ */
+class ProjectionClient {
+public:
+  /**
+   * @throws std::runtime_error if the server socket cannot be connected.
+   */
+  explicit ProjectionClient(const std::string& socket_path);
+  ~ProjectionClient();
+
+  ProjectionClient(const ProjectionClient&) = delete;
+  ProjectionClient& operator=(const ProjectionClient&) = delete;
+
+  /**
+   * @brief Project @p uv with camera @p camera_id.
+   *
+   * @param out Ground points (X,0,Z), resized to uv.size(); NaN where v ~= cy.
+   * @return false if the camera is unknown to the server.
+   * @throws std::invalid_argument if uv.size() > projection_wire::kMaxPoints.
+   * @throws std::runtime_error on a broken connection or malformed response.
+   */
+  bool project(std::uint32_t camera_id, const std::vector<cv::Point2f>& uv,
+               std::vector<cv::Point3f>& out);
+
+  /** @brief Round-trip time of the last project() call (microseconds). */
+  double lastLatencyUs() const;
+
+private:
+  void sendAll(const void* data, std::size_t n);
+  void recvAll(void* data, std::size_t n);
+
+  int fd_ = -1;
+  std::uint64_t next_id_ = 1;
+  double last_latency_us_ = 0.0;
+  std::vector<projection_wire::GroundXZ> xz_;  ///< Reused response buffer.
+};
@@ -0,0 +1,310 @@
+#include "sharded_processor.hpp"
+#include "distortion_model.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <opencv2/imgproc.hpp>
+
+namespace {
+
+double msSince(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+}  // namespace
+
+struct ShardedProcessor::ShardOutput {
+  std::vector<FrameResult> frames;             ///< Segment frames only (local track ids).
+  std::vector<GroundTracker::Track> boundary;  ///< Tracks after the last warm-up frame.
+  SegmentStats stats;
+  std::string error;                           ///< Non-empty if the shard failed.
+};
+
+ShardedProcessor::ShardedProcessor(const Intrinsics& in)
+: ShardedProcessor(in, Params{}) {}
+
+ShardedProcessor::ShardedProcessor(const Intrinsics& in, const Params& p)
+: intrinsics_(in), params_(p) {}
+
+const ShardedProcessor::Params& ShardedProcessor::params() const { return params_; }
+
+void ShardedProcessor::planSegments(const std::vector<std::int64_t>& keyframes,
+                                    std::int64_t frame_count, int shards,
+                                    std::int64_t min_segment_frames,
+                                    std::vector<Segment>& out) {
+  out.clear();
+  if (frame_count <= 0) return;
+  const std::int64_t min_len = std::max<std::int64_t>(1, min_segment_frames);
+  const std::int64_t n = std::clamp<std::int64_t>(shards, 1, std::max<std::int64_t>(1, frame_count / min_len));
+
+  std::int64_t begin = 0;
+  for (std::int64_t i = 1; i < n; ++i) {
+    std::int64_t cut = i * frame_count / n;
+    if (!keyframes.empty()) {
+      // Latest keyframe at or before the even split point.
+      const auto it = std::upper_bound(keyframes.begin(), keyframes.end(), cut);
+      if (it == keyframes.begin()) continue;
+      cut = *std::prev(it);
+    }
+    if (cut - begin < min_len || frame_count - cut < min_len) continue;
+    out.push_back({begin, cut});
+    begin = cut;
+  }
+  out.push_back({begin, frame_count});
+}
+
+void ShardedProcessor::stitchTracks(const std::vector<GroundTracker::Track>& prev,
+                                    const std::vector<GroundTracker::Track>& next, float gate_m,
+                                    std::unordered_map<std::uint32_t, std::uint32_t>& local_to_global) {
+  local_to_global.clear();
+  struct Pair { float d2; std::size_t p, n; };
+  std::vector<Pair> pairs;
+  const float gate2 = gate_m * gate_m;
+  for (std::size_t i = 0; i < prev.size(); ++i) {
+    for (std::size_t j = 0; j < next.size(); ++j) {
+      const float dx = prev[i].position.x - next[j].position.x;
+      const float dz = prev[i].position.y - next[j].position.y;
+      const float d2 = dx * dx + dz * dz;
+      if (d2 <= gate2) pairs.push_back({d2, i, j});
+    }
+  }
+  std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.d2 < b.d2; });
+
+  std::vector<bool> prev_used(prev.size(), false), next_used(next.size(), false);
+  for (const Pair& pr : pairs) {
+    if (prev_used[pr.p] || next_used[pr.n]) continue;
+    prev_used[pr.p] = next_used[pr.n] = true;
+    local_to_global[next[pr.n].id] = prev[pr.p].id;
+  }
+}
+
+void ShardedProcessor::runShard(const std::string& path, const Segment& seg,
+                                const FrameSource& indexer, ShardOutput& out) const {
+  const auto t0 = std::chrono::steady_clock::now();
+  out.stats.segment = seg;
+
+  // The shared index already gave us keyframes and timestamps; don't rescan.
+  FrameSource::Params sp;
+  sp.build_index = false;
+  FrameSource source(path, sp);
+  if (!source.open()) {
+    out.error = "could not open " + path;
+    return;
+  }
+  source.setIndex(indexer.index(), indexer.keyframesKnown());
+  const std::int64_t first = std::max<std::int64_t>(0, seg.begin - params_.warmup_frames);
+  source.setEndFrame(seg.end);
+  if (first > 0 && !source.seek(first)) {
+    out.error = "could not seek to frame " + std::to_string(first);
+    return;
+  }
+
+  TiledCornerDetector corners(params_.corners);
+  GroundTracker::Params tracker_params = params_.tracker;
+  tracker_params.zone = params_.zone;
+  GroundTracker tracker(tracker_params);
+  PeopleDetector people(params_.people);
+  if (params_.detect_people) {
+    people.setGeometry(intrinsics_, params_.camera_height_m, source.frameSize());
+  }
+  const DistortionKind kind = distortion::detectKind(intrinsics_);
+
+  cv::Mat gray;
+  std::vector<cv::Point2f> pts, undistorted;
+  std::vector<cv::Point3f> ground, detections;
+  std::vector<PeopleDetector::Detection> found;
+  double last_ts = -1.0;
+  const double frame_ms = source.fps() > 0.0 ? 1000.0 / source.fps() : 0.0;
+
+  out.frames.reserve(static_cast<std::size_t>(seg.end - seg.begin));
+  FrameSource::Frame f;
+  while (source.acquire(f)) {
+    const std::int64_t idx = f.index;
+    const double ts = f.timestamp_ms;  // from the shared index
+
+    cv::cvtColor(*f.image, gray, cv::COLOR_BGR2GRAY);
+    corners.detect(gray, pts);
+    undistorted.resize(pts.size());
+    distortion::undistortPoints(kind, intrinsics_, pts.data(), pts.size(), undistorted.data());
+    ground.resize(pts.size());
+    projectToGround(intrinsics_, params_.camera_height_m, undistorted.data(), undistorted.size(),
+                    ground.data());
+
+    detections.clear();
+    if (params_.detect_people) {
+      people.detect(*f.image, found);
+      for (const auto& d : found) detections.push_back(d.ground);
+    } else {
+      for (std::size_t i = 0; i < ground.size(); ++i) {
+        if (undistorted[i].y > intrinsics_.cy && ground[i].z > 0.0f) detections.push_back(ground[i]);
+      }
+    }
+    source.release(f);
+
+    const double dt_ms = last_ts >= 0.0 && ts > last_ts ? ts - last_ts : frame_ms;
+    last_ts = ts;
+    tracker.update(detections, static_cast<float>(dt_ms / 1000.0));
+
+    if (idx < seg.begin) {
+      ++out.stats.warmup;
+      if (idx + 1 == seg.begin) out.boundary = tracker.tracks();
+      continue;
+    }
+
+    FrameResult r;
+    r.frame_index = idx;
+    r.timestamp_ms = ts;
+    if (params_.keep_features) {
+      r.features = pts;
+      r.ground = ground;
+    }
+    r.detections = detections;
+    r.tracks = tracker.tracks();
+    r.zone = ground_shm::classify(detections.data(), detections.size(), params_.zone);
+    out.frames.push_back(std::move(r));
+  }
+
+  out.stats.frames = static_cast<std::int64_t>(out.frames.size());
+  out.stats.elapsed_ms = msSince(t0);
+}
+
+bool ShardedProcessor::run(const std::string& path, Result& out) {
+  return process(path, out, [&](FrameResult& fr) { out.frames.push_back(std::move(fr)); });
+}
+
+bool ShardedProcessor::run(const std::string& path, Result& out,
+                           const std::function<void(const FrameResult&)>& sink) {
+  return process(path, out, [&](FrameResult& fr) { sink(fr); });
+}
+
+bool ShardedProcessor::process(const std::string& path, Result& out,
+                               const std::function<void(FrameResult&)>& emit) {
+  const auto t0 = std::chrono::steady_clock::now();
+  out = Result{};
+
+  FrameSource indexer(path);  // one grab-only scan for keyframes and timestamps
+  if (!indexer.open()) {
+    std::cerr << "Error: could not open " << path << std::endl;
+    return false;
+  }
+  out.index_ms = msSince(t0);
+
+  int shards = params_.shards;
+  if (shards <= 0) shards = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  std::int64_t pieces = shards;
+  if (params_.max_segment_frames > 0) {
+    const std::int64_t len = params_.max_segment_frames;
+    pieces = std::max(pieces, (indexer.frameCount() + len - 1) / len);
+  }
+  // Without keyframe flags keyframes() is just {0}; any frame may start a segment then.
+  std::vector<Segment> segments;
+  planSegments(indexer.keyframesKnown() ? indexer.keyframes() : std::vector<std::int64_t>{},
+               indexer.frameCount(),
+               static_cast<int>(std::min<std::int64_t>(pieces, std::numeric_limits<int>::max())),
+               params_.min_segment_frames, segments);
+  if (static_cast<int>(segments.size()) < shards) {
+    std::cout << "[info] " << segments.size() << " segment(s) for " << shards
+              << " shards (keyframes or min_segment_frames limit the cuts)\n";
+  }
+
+  // Threads take segments in order, but never run more than `window` ahead
+  // of the merge, so finished segments don't pile up behind a slow one.
+  const std::size_t n = segments.size();
+  const std::size_t workers = std::min(n, static_cast<std::size_t>(shards));
+  const std::size_t window = 2 * workers;
+  std::vector<ShardOutput> outputs(n);
+  std::vector<char> done(n, 0);
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::size_t next = 0, merged = 0;
+  bool failed = false;
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers);
+  for (std::size_t w = 0; w < workers; ++w) {
+    threads.emplace_back([&] {
+      for (;;) {
+        std::size_t s;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&] { return failed || next >= n || next < merged + window; });
+          if (failed || next >= n) return;
+          s = next++;
+        }
+        try {
+          runShard(path, segments[s], indexer, outputs[s]);
+        } catch (const std::exception& e) {
+          outputs[s].error = e.what();
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          done[s] = 1;
+          if (!outputs[s].error.empty()) failed = true;
+        }
+        cv.notify_all();
+      }
+    });
+  }
+
+  // Merge in time order as segments complete, making track ids global across
+  // segment boundaries, and release each segment once it has been emitted.
+  std::uint32_t next_global = 1;
+  std::unordered_map<std::uint32_t, std::uint32_t> ids;
+  std::vector<GroundTracker::Track> prev_last;
+  ground_shm::ZoneState zone = ground_shm::ZoneState::CLEAR;
+  for (std::size_t s = 0; s < n; ++s) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return done[s] || failed; });
+      if (!done[s] || !outputs[s].error.empty()) break;
+    }
+    ShardOutput& o = outputs[s];
+    if (!o.boundary.empty() && !prev_last.empty()) {
+      stitchTracks(prev_last, o.boundary, params_.tracker.gate_m, ids);
+    } else {
+      ids.clear();
+    }
+    for (auto& fr : o.frames) {
+      for (auto& t : fr.tracks) {
+        auto it = ids.find(t.id);
+        if (it == ids.end()) it = ids.emplace(t.id, next_global++).first;
+        t.id = it->second;
+      }
+      if (&fr == &o.frames.back()) prev_last = fr.tracks;
+      if (fr.zone != zone) {
+        out.events.push_back({fr.frame_index, fr.timestamp_ms, zone, fr.zone});
+        zone = fr.zone;
+      }
+      emit(fr);
+    }
+    out.segments.push_back(o.stats);
+    std::vector<FrameResult>().swap(o.frames);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      merged = s + 1;
+    }
+    cv.notify_all();
+  }
+  for (auto& t : threads) t.join();
+
+  bool ok = true;
+  for (std::size_t s = 0; s < outputs.size(); ++s) {
+    if (!outputs[s].error.empty()) {
+      std::cerr << "Error: segment [" << segments[s].begin << ", " << segments[s].end
+                << ") failed: " << outputs[s].error << std::endl;
+      ok = false;
+    }
+  }
+  if (!ok) return false;
+
+  out.elapsed_ms = msSince(t0);
+  return true;
+}
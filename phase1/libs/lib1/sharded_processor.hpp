@@ -0,0 +1,192 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "intrinsics.hpp"
+#include "frame_source.hpp"
+#include "ground_publisher.hpp"
+#include "ground_tracker.hpp"
+#include "people_detector.hpp"
+#include "tiled_corner_detector.hpp"
+
+/**
+ * @file sharded_processor.hpp
+ * @brief Offline processing of a recorded video split into keyframe-aligned
+ *        segments that run concurrently.
+ *
+ * @details
+ * Decoding a long recording through one cv::VideoCapture keeps the whole run
+ * on one core. ShardedProcessor builds the file's keyframe index once, cuts
+ * the frame range into segments at keyframes (one per shard, or more when
+ * Params::max_segment_frames caps their length), and runs them on a pool of
+ * Params::shards threads. Each segment gets its own FrameSource, corner
+ * detector, people detector and GroundTracker; nothing is shared between
+ * segments while they run.
+ *
+ * Per frame, a shard detects corners (TiledCornerDetector), undistorts them
+ * and projects them onto the ground plane. The tracker input is either the
+ * people detections' ground points (Params::detect_people) or the corner
+ * ground points below the horizon. A zone state is derived from the same
+ * points.
+ *
+ * Segment boundaries:
+ *  - Each shard starts decoding Params::warmup_frames before its segment.
+ *    The warm-up frames only prime the tracker and are then discarded, so
+ *    tracks entering the segment carry a filtered state, not a cold start.
+ *  - Each shard opens its own decoder but adopts the shared index
+ *    (FrameSource::setIndex()), so its seek lands on the indexed keyframe and
+ *    its timestamps match the other shards'.
+ *  - Track ids are made global when the shards are merged. At the last
+ *    warm-up frame, which the previous shard processed as its own last frame,
+ *    each shard's tracks are matched to the previous shard's tracks within
+ *    the tracker gate and inherit their ids. Every other track gets a fresh id.
+ *    With warmup_frames == 0 there is no shared frame to match at, so every
+ *    track alive at a boundary gets a fresh id there.
+ *  - Zone events are derived after the merge from the time-ordered zone
+ *    states, so a transition that straddles a boundary is reported once.
+ *
+ * Memory: segments are merged in order as soon as they and every earlier
+ * segment are done. run() with a sink hands each merged frame to the sink and
+ * then frees the segment, and a thread only starts a segment that is fewer
+ * than 2 * shards segments ahead of the merge, so at most about
+ * 2 * shards * max_segment_frames frames are held at once, whatever the
+ * video's length.
+ * run() into a Result keeps every frame; leave keep_features off there for
+ * long recordings, since the corners and their ground points dominate.
+ *
+ * Wall time is roughly (decode + detect time) / shards, plus the warm-up
+ * frames and the single index scan.
+ */
+class ShardedProcessor {
+public:
+  struct Params {
+    int   shards          = 0;      ///< Concurrent segments; 0 = std::thread::hardware_concurrency().
+    int   min_segment_frames = 300; ///< Never cut segments shorter than this.
+    int   max_segment_frames = 9000; ///< Cut longer segments (5 min at 30 fps) to bound streaming memory; 0 = one per shard.
+    int   warmup_frames   = 30;     ///< Frames decoded before each segment to prime the tracker; 0 = no id stitching.
+    bool  keep_features   = false;  ///< Store corners and their ground points per frame.
+    bool  detect_people   = false;  ///< Track people (HOG) instead of corner ground points.
+    float camera_height_m = 1.0f;   ///< Camera height above the ground plane (m).
+    ZoneThresholds zone;            ///< Zone ranges; also replaces tracker.zone.
+    TiledCornerDetector::Params corners;  ///< Full-frame corner detection.
+    PeopleDetector::Params      people;   ///< Used with detect_people.
+    GroundTracker::Params       tracker;  ///< Per-shard tracker.
+  };
+
+  /**
+   * @brief Half-open frame range [begin, end).
+   */
+  struct Segment {
+    std::int64_t begin = 0;
+    std::int64_t end = 0;
+  };
+
+  /**
+   * @brief Output for one frame of the video.
+   */
+  struct FrameResult {
+    std::int64_t frame_index = 0;
+    double timestamp_ms = 0.0;
+    std::vector<cv::Point2f> features;  ///< Corners (image coords); empty unless keep_features.
+    std::vector<cv::Point3f> ground;    ///< Ground point per corner, NaN on the horizon.
+    std::vector<cv::Point3f> detections;///< Tracker input for this frame.
+    std::vector<GroundTracker::Track> tracks;  ///< Tracks after the update, global ids.
+    ground_shm::ZoneState zone = ground_shm::ZoneState::CLEAR;
+  };
+
+  /**
+   * @brief Zone state change between consecutive frames.
+   */
+  struct ZoneEvent {
+    std::int64_t frame_index = 0;       ///< First frame in the new state.
+    double timestamp_ms = 0.0;
+    ground_shm::ZoneState from = ground_shm::ZoneState::CLEAR;
+    ground_shm::ZoneState to = ground_shm::ZoneState::CLEAR;
+  };
+
+  struct SegmentStats {
+    Segment segment;
+    std::int64_t frames = 0;            ///< Frames kept.
+    std::int64_t warmup = 0;            ///< Frames decoded and discarded before the segment.
+    double elapsed_ms = 0.0;            ///< Shard wall time.
+  };
+
+  struct Result {
+    std::vector<FrameResult> frames;    ///< Every frame, in time order.
+    std::vector<ZoneEvent> events;      ///< In time order.
+    std::vector<SegmentStats> segments;
+    double index_ms = 0.0;              ///< Time spent building the keyframe index.
+    double elapsed_ms = 0.0;            ///< Total wall time of run().
+  };
+
+  /**
+   * @param in Intrinsics of the recording (native resolution).
+   */
+  explicit ShardedProcessor(const Intrinsics& in);
+  ShardedProcessor(const Intrinsics& in, const Params& p);
+
+  /**
+   * @brief Process the whole file at @p path.
+   *
+   * @return false if the file cannot be opened or a shard failed (logged).
+   */
+  bool run(const std::string& path, Result& out);
+
+  /**
+   * @brief Process the whole file, streaming merged frames to @p sink.
+   *
+   * @details @p sink is called on the calling thread, once per frame, in time
+   *          order and with global track ids. out.frames stays empty; events,
+   *          segment stats and timings are filled as by run(path, out). If a
+   *          segment fails, frames of earlier segments may already have been
+   *          delivered.
+   * @return false if the file cannot be opened or a shard failed (logged).
+   */
+  bool run(const std::string& path, Result& out,
+           const std::function<void(const FrameResult&)>& sink);
+
+  const Params& params() const;
+
+  /**
+   * @brief Cut [0, frame_count) into at most @p shards segments starting on keyframes.
+   *
+   * @param keyframes Keyframe indices, ascending; empty means any frame may start a segment
+   *                  (pass empty when FrameSource::keyframesKnown() is false).
+   */
+  static void planSegments(const std::vector<std::int64_t>& keyframes, std::int64_t frame_count,
+                           int shards, std::int64_t min_segment_frames,
+                           std::vector<Segment>& out);
+
+  /**
+   * @brief Map the next shard's local track ids onto the previous shard's global ids.
+   *
+   * @param prev   Tracks of the previous shard at the boundary frame (global ids).
+   * @param next   Tracks of the next shard at the same frame (local ids).
+   * @param gate_m Maximum position difference for a match.
+   * @param local_to_global Receives one entry per matched track (greedy, nearest pairs first).
+   */
+  static void stitchTracks(const std::vector<GroundTracker::Track>& prev,
+                           const std::vector<GroundTracker::Track>& next, float gate_m,
+                           std::unordered_map<std::uint32_t, std::uint32_t>& local_to_global);
+
+private:
+  struct ShardOutput;  ///< One shard's frames, boundary tracks and stats.
+
+  /** @brief Shared body of both run() overloads; @p emit may move from the frame. */
+  bool process(const std::string& path, Result& out,
+               const std::function<void(FrameResult&)>& emit);
+
+  /**
+   * @brief Decode and process @p seg (plus warm-up) with private decoder and detectors.
+   *
+   * @param indexer Source that scanned the whole file; its index is shared, read-only.
+   */
+  void runShard(const std::string& path, const Segment& seg, const FrameSource& indexer,
+                ShardOutput& out) const;
+
+  Intrinsics intrinsics_;
+  Params params_;
+};
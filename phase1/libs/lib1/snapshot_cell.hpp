@@ -0,0 +1,134 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+/**
+ * @file snapshot_cell.hpp
+ * @brief Single-writer / many-reader cell that publishes immutable snapshots
+ *        by swapping an atomic slot index.
+ *
+ * @details
+ * The cell owns a small fixed pool of slots. The writer fills a slot that is
+ * neither current nor pinned by a reader, then makes it current with one
+ * atomic store. Readers pin the current slot by bumping its reader count and
+ * re-checking that it is still current, so they never take a lock and never
+ * see a half-written value. Slots are reused, so publishing a T whose copy
+ * assignment keeps capacity (e.g. std::vector members) does not allocate.
+ *
+ * @note Exactly one thread may call publish()/publishWith() at a time.
+ */
+template <typename T, std::size_t Slots = 4>
+class SnapshotCell {
+  static_assert(Slots >= 2, "SnapshotCell needs at least two slots");
+
+  struct Slot {
+    std::optional<T> value;
+    std::uint64_t version = 0;
+    std::atomic<std::uint32_t> readers{0};
+  };
+
+public:
+  /**
+   * @brief RAII pin on one published snapshot. Move-only.
+   */
+  class Handle {
+  public:
+    Handle() = default;
+    Handle(Handle&& o) noexcept : slot_(std::exchange(o.slot_, nullptr)) {}
+    Handle& operator=(Handle&& o) noexcept {
+      if (this != &o) {
+        unpin();
+        slot_ = std::exchange(o.slot_, nullptr);
+      }
+      return *this;
+    }
+    Handle(const Handle&) = delete;
+    Handle& operator=(const Handle&) = delete;
+    ~Handle() { unpin(); }
+
+    const T& operator*() const { return *slot_->value; }
+    const T* operator->() const { return &*slot_->value; }
+    const T* get() const { return slot_ ? &*slot_->value : nullptr; }
+    std::uint64_t version() const { return slot_ ? slot_->version : 0; }
+    explicit operator bool() const { return slot_ != nullptr; }
+
+  private:
+    friend class SnapshotCell;
+    explicit Handle(Slot* s) : slot_(s) {}
+    void unpin() {
+      if (slot_) slot_->readers.fetch_sub(1, std::memory_order_release);
+      slot_ = nullptr;
+    }
+    Slot* slot_ = nullptr;
+  };
+
+  explicit SnapshotCell(const T& initial) {
+    slots_[0].value.emplace(initial);
+    slots_[0].version = 1;
+    version_ = 1;
+    published_.store(1);
+  }
+
+  SnapshotCell(const SnapshotCell&) = delete;
+  SnapshotCell& operator=(const SnapshotCell&) = delete;
+
+  /**
+   * @brief Pin and return the current snapshot. Lock-free; never blocks the writer.
+   */
+  Handle acquire() const {
+    for (;;) {
+      const std::size_t i = current_.load();
+      Slot& s = slots_[i];
+      s.readers.fetch_add(1);
+      if (current_.load() == i) return Handle(&s);
+      s.readers.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  /**
+   * @brief Publish a copy of @p value as the new current snapshot.
+   * @return false if every non-current slot is pinned by a reader (nothing published).
+   */
+  bool publish(const T& value) {
+    return publishWith([&](T& dst) { dst = value; });
+  }
+
+  /**
+   * @brief Publish by letting @p fill overwrite a recycled slot in place.
+   *
+   * @param fill Callable taking T&; the slot holds an older snapshot and must be
+   *             fully overwritten. Reusing its buffers avoids allocation.
+   * @return false if every non-current slot is pinned by a reader.
+   */
+  template <typename Fn>
+  bool publishWith(Fn&& fill) {
+    const std::size_t cur = current_.load(std::memory_order_relaxed);
+    for (std::size_t k = 1; k < Slots; ++k) {
+      const std::size_t i = (cur + k) % Slots;
+      Slot& s = slots_[i];
+      if (s.readers.load() != 0) continue;
+      if (!s.value) s.value.emplace(*slots_[cur].value);
+      fill(*s.value);
+      s.version = ++version_;
+      current_.store(i);
+      published_.store(s.version, std::memory_order_release);
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Version of the most recently published snapshot (starts at 1).
+   */
+  std::uint64_t version() const { return published_.load(std::memory_order_acquire); }
+
+private:
+  mutable std::array<Slot, Slots> slots_;
+  std::atomic<std::size_t> current_{0};
+  std::atomic<std::uint64_t> published_{0};
+  std::uint64_t version_ = 0;  ///< Writer-side counter.
+};
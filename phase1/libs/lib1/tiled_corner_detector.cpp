@@ -0,0 +1,131 @@
+#include "tiled_corner_detector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+
+TiledCornerDetector::TiledCornerDetector() : TiledCornerDetector(Params{}) {}
+
+TiledCornerDetector::TiledCornerDetector(const Params& p) { setParams(p); }
+
+const TiledCornerDetector::Params& TiledCornerDetector::params() const { return params_; }
+
+void TiledCornerDetector::setParams(const Params& p) {
+  params_ = p;
+  params_.tiles_x = std::max(params_.tiles_x, 1);
+  params_.tiles_y = std::max(params_.tiles_y, 1);
+  params_.corners_per_tile = std::max(params_.corners_per_tile, 1);
+  tile_pts_.resize(static_cast<size_t>(params_.tiles_x * params_.tiles_y));
+}
+
+void TiledCornerDetector::detect(const cv::Mat& gray, std::vector<cv::Point2f>& out) {
+  detect(gray, cv::Rect(0, 0, gray.cols, gray.rows), out);
+}
+
+void TiledCornerDetector::detect(const cv::Mat& gray, const cv::Rect& region,
+                                 std::vector<cv::Point2f>& out) {
+  CV_Assert(!gray.empty() && gray.channels() == 1);
+  out.clear();
+  const cv::Rect canvas(0, 0, gray.cols, gray.rows);
+  const cv::Rect r = region & canvas;
+  if (r.width <= 1 || r.height <= 1) return;
+
+  // ---- Split the region into tiles (last row/column absorbs the remainder) ----
+  const int nx = std::min(params_.tiles_x, r.width);
+  const int ny = std::min(params_.tiles_y, r.height);
+  tiles_.clear();
+  for (int ty = 0; ty < ny; ++ty) {
+    const int y0 = r.y + (r.height * ty) / ny;
+    const int y1 = r.y + (r.height * (ty + 1)) / ny;
+    for (int tx = 0; tx < nx; ++tx) {
+      const int x0 = r.x + (r.width * tx) / nx;
+      const int x1 = r.x + (r.width * (tx + 1)) / nx;
+      tiles_.emplace_back(x0, y0, x1 - x0, y1 - y0);
+    }
+  }
+  if (tile_pts_.size() < tiles_.size()) tile_pts_.resize(tiles_.size());
+
+  // ---- Detect per tile, in parallel ----
+  const int margin = params_.block_size;
+  cv::parallel_for_(cv::Range(0, static_cast<int>(tiles_.size())), [&](const cv::Range& range) {
+    for (int t = range.start; t < range.end; ++t) {
+      const cv::Rect core = tiles_[t];
+      const cv::Rect window = cv::Rect(core.x - margin, core.y - margin,
+                                       core.width + 2 * margin,
+                                       core.height + 2 * margin) & r;
+      std::vector<cv::Point2f>& pts = tile_pts_[t];
+      pts.clear();
+      if (core.width <= 1 || core.height <= 1) continue;
+      cv::goodFeaturesToTrack(gray(window), pts,
+                              params_.corners_per_tile,
+                              params_.quality_level,
+                              params_.min_distance,
+                              cv::noArray(),
+                              params_.block_size,
+                              params_.use_harris);
+      // Back to image coordinates; drop corners found in the margin (they
+      // belong to the neighbouring tile). Order (strongest first) is kept.
+      size_t kept = 0;
+      for (const auto& p : pts) {
+        const cv::Point2f q(p.x + static_cast<float>(window.x),
+                            p.y + static_cast<float>(window.y));
+        if (q.x >= core.x && q.x < core.x + core.width &&
+            q.y >= core.y && q.y < core.y + core.height) {
+          pts[kept++] = q;
+        }
+      }
+      pts.resize(kept);
+    }
+  });
+
+  merge(r, out);
+}
+
+void TiledCornerDetector::merge(const cv::Rect& region, std::vector<cv::Point2f>& out) {
+  cell_ = static_cast<float>(std::max(params_.min_distance, 1.0));
+  grid_region_ = region;
+  grid_cols_ = static_cast<int>(std::ceil(region.width / cell_)) + 1;
+  grid_rows_ = static_cast<int>(std::ceil(region.height / cell_)) + 1;
+  cell_head_.assign(static_cast<size_t>(grid_cols_ * grid_rows_), -1);
+
+  size_t longest = 0;
+  size_t total = 0;
+  for (size_t t = 0; t < tiles_.size(); ++t) {
+    longest = std::max(longest, tile_pts_[t].size());
+    total += tile_pts_[t].size();
+  }
+  const size_t cap = params_.max_corners > 0 ? static_cast<size_t>(params_.max_corners) : total;
+  out.reserve(std::min(cap, total));
+  next_.resize(total);
+
+  for (size_t rank = 0; rank < longest && out.size() < cap; ++rank) {
+    for (size_t t = 0; t < tiles_.size() && out.size() < cap; ++t) {
+      if (rank >= tile_pts_[t].size()) continue;
+      const cv::Point2f& p = tile_pts_[t][rank];
+      if (!farFromAccepted(p, out)) continue;
+      const int cx = static_cast<int>((p.x - grid_region_.x) / cell_);
+      const int cy = static_cast<int>((p.y - grid_region_.y) / cell_);
+      const int c = cy * grid_cols_ + cx;
+      next_[out.size()] = cell_head_[c];
+      cell_head_[c] = static_cast<int>(out.size());
+      out.push_back(p);
+    }
+  }
+}
+
+bool TiledCornerDetector::farFromAccepted(const cv::Point2f& p,
+                                          const std::vector<cv::Point2f>& out) const {
+  const float d2min = static_cast<float>(params_.min_distance * params_.min_distance);
+  const int cx = static_cast<int>((p.x - grid_region_.x) / cell_);
+  const int cy = static_cast<int>((p.y - grid_region_.y) / cell_);
+  for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, grid_rows_ - 1); ++y) {
+    for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, grid_cols_ - 1); ++x) {
+      for (int i = cell_head_[y * grid_cols_ + x]; i >= 0; i = next_[i]) {
+        const float dx = out[i].x - p.x, dy = out[i].y - p.y;
+        if (dx*dx + dy*dy < d2min) return false;
+      }
+    }
+  }
+  return true;
+}
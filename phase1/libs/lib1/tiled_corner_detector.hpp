@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @file tiled_corner_detector.hpp
+ * @brief Uniform Shi–Tomasi / Harris corner coverage by detecting per tile in parallel.
+ *
+ * @details
+ * cv::goodFeaturesToTrack applies its quality threshold relative to the
+ * strongest corner in the image, so one heavily textured area can starve the
+ * rest of the frame. This detector splits the region into a grid of tiles,
+ * runs goodFeaturesToTrack on every tile concurrently (cv::parallel_for_)
+ * with a per-tile corner budget, then merges the tile lists.
+ *
+ * The merge walks the tiles round-robin by rank (every tile's strongest corner
+ * first, then every tile's second, ...) and enforces min_distance across tile
+ * borders with a flat hash grid whose cell size is min_distance. Tiles are
+ * detected on a slightly enlarged window so corners right at a tile border are
+ * still scored with full support.
+ */
+class TiledCornerDetector {
+public:
+  struct Params {
+    int    tiles_x          = 4;     ///< Tile columns.
+    int    tiles_y          = 4;     ///< Tile rows.
+    int    corners_per_tile = 16;    ///< Corner budget per tile.
+    int    max_corners      = 0;     ///< Cap on merged corners (0 = no cap).
+    double quality_level    = 0.01;  ///< Relative quality, applied per tile.
+    double min_distance     = 8.0;   ///< Minimum distance between any two corners (px).
+    int    block_size       = 3;     ///< Block size for corner detection.
+    bool   use_harris       = false; ///< Use Harris instead of Shi–Tomasi.
+  };
+
+  TiledCornerDetector();
+  explicit TiledCornerDetector(const Params& p);
+
+  /**
+   * @brief Detect across the whole grayscale image.
+   *
+   * @param gray Single-channel 8-bit or float image.
+   * @param out  Output corners in image coordinates; cleared first, capacity reused.
+   */
+  void detect(const cv::Mat& gray, std::vector<cv::Point2f>& out);
+
+  /**
+   * @brief Detect inside @p region only (clamped to the image).
+   */
+  void detect(const cv::Mat& gray, const cv::Rect& region, std::vector<cv::Point2f>& out);
+
+  const Params& params() const;
+  void setParams(const Params& p);
+
+private:
+  void merge(const cv::Rect& region, std::vector<cv::Point2f>& out);
+  bool farFromAccepted(const cv::Point2f& p, const std::vector<cv::Point2f>& out) const;
+
+  Params params_;
+  std::vector<cv::Rect> tiles_;                   ///< Core rect per tile.
+  std::vector<std::vector<cv::Point2f>> tile_pts_;///< Per-tile results, strongest first.
+
+  // ---- Merge-time min-distance grid (intrusive lists into `out`) ----
+  cv::Rect grid_region_;
+  float cell_ = 1.0f;
+  int grid_cols_ = 0, grid_rows_ = 0;
+  std::vector<int> cell_head_;
+  std::vector<int> next_;
+};
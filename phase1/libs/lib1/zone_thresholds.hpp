@@ -0,0 +1,15 @@
+#pragma once
+
+/**
+ * @file zone_thresholds.hpp
+ * @brief The proximity ranges that every zone-aware stage shares.
+ *
+ * @details HumanDetector (published zone), GroundTracker (time-to-close) and
+ * ShardedProcessor (offline zone events) all take this one struct, and
+ * ConfigClass::zoneThresholds() builds it from the configuration, so the
+ * defaults and the configured values live in a single place.
+ */
+struct ZoneThresholds {
+  float D_close_m = 1.0f;  ///< CLOSE within this range (meters).
+  float D_max_m   = 5.0f;  ///< WATCH within this range (meters).
+};
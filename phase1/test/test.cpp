@@ -4,11 +4,48 @@
 #include "config_class.hpp"
 #include "camera_model.hpp"
 #include "human_detector.hpp"
+#include "ground_tracker.hpp"
+#include "frame_log.hpp"
+#include "config_watcher.hpp"
+#include "snapshot_cell.hpp"
+#include "intrinsics.hpp"
+#include "distortion_model.hpp"
+#include "frame_source.hpp"
+#include "tiled_corner_detector.hpp"
+#include "multi_roi_detector.hpp"
+#include "ground_publisher.hpp"
+#include "occupancy_grid.hpp"
+#include "frame_arena.hpp"
+#include "alloc_stats.hpp"
+#include "motion_gate.hpp"
+#include "people_detector.hpp"
+#include "annotated_recorder.hpp"
+#include "projection_server.hpp"
+#include "sharded_processor.hpp"
+#include "chessboard_synth.hpp"
 #include <opencv2/opencv.hpp>
 #include <chrono>
+#include <functional>
 #include <fstream>
 #include <filesystem>
 #include <string>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <unistd.h>
+
+// Per-process name for a temporary fixture, so concurrent test runs don't share files.
+static std::filesystem::path TempPath(const std::string& name) {
+  return std::filesystem::temp_directory_path() /
+         ("hd_" + std::to_string(::getpid()) + "_" + name);
+}
 
 // CameraModel class
 
@@ -40,32 +77,6 @@ TEST(camera_model_test, loads_From_csv_file) {
 
 }
 
-// TEST(camera_model_test, calibrates_from_file) {
-
-
-//   CameraModel cm("media/test_cal.MOV");
-
-//   std::vector<float> correct_kmat_values = {1148.941079262392,0,968.6603818232142,
-//                                       0,1157.532465485139,533.1086821168354,
-//                                       0,0,1};
-//   std::vector<float> correct_dmat_values = {
-//                                       -0.4518047618131186, 0.3228995925163289, 
-//                                       -0.001753905126417962, -0.0003906063544475221, 
-//                                       -0.1601718014427244};
-
-//   int i = 0;
-//   for (int r=0; r<3; r++) {
-//     for (int c=0; c<3; c++) {
-//       EXPECT_FLOAT_EQ(correct_kmat_values[i],cm.K_mat.at<float>(r,c));
-//       i++;
-//     }
-//   }
-
-//   for (int c=0; c<5; c++) {
-//     EXPECT_FLOAT_EQ(correct_dmat_values[c], cm.D_mat.at<float>(0,c));
-//   }
-// }
-
 TEST(camera_model_test, undistorts_image) {
 
 
@@ -209,4 +220,1783 @@ TEST(HumanDetectorParams, CameraHeightScalesDepth) {
   hd.setCameraHeight(2.4f);
   auto P2 = hd.pixelToGround(uv);
   EXPECT_NEAR(P2.z, 4.8f, 1e-5f);
-}
\ No newline at end of file
+}
+// GroundTracker class
+
+TEST(GroundTracker, KeepsIdsAndEstimatesVelocity) {
+  GroundTracker::Params p;
+  p.gate_m = 0.5f;
+  p.zone.D_close_m = 1.0f;
+  GroundTracker tracker(p);
+
+  // Two people: one walking straight at the camera at 1 m/s, one standing still.
+  const float dt = 0.1f;
+  for (int k = 0; k < 30; ++k) {
+    const float t = k * dt;
+    tracker.update({cv::Point3f(0.0f, 0.0f, 6.0f - t),
+                    cv::Point3f(2.0f, 0.0f, 4.0f)}, dt);
+  }
+
+  ASSERT_EQ(tracker.tracks().size(), 2u);
+  const auto& walker = tracker.tracks()[0].position.x < 1.0f
+                       ? tracker.tracks()[0] : tracker.tracks()[1];
+  const auto& stander = &walker == &tracker.tracks()[0]
+                        ? tracker.tracks()[1] : tracker.tracks()[0];
+  EXPECT_TRUE(walker.confirmed);
+  EXPECT_NE(walker.id, stander.id);
+  EXPECT_NEAR(walker.velocity.y, -1.0f, 0.05f);
+  EXPECT_NEAR(stander.velocity.y, 0.0f, 0.05f);
+  // Walker is at Z ~= 3.1 m, closing at 1 m/s → ~2.1 s to D_close.
+  EXPECT_NEAR(walker.time_to_close_s, 2.1f, 0.15f);
+  EXPECT_TRUE(std::isinf(stander.time_to_close_s));
+}
+
+TEST(GroundTracker, DropsLostTracksAndReusesSlots) {
+  GroundTracker::Params p;
+  p.max_tracks = 2;
+  p.max_misses = 2;
+  GroundTracker tracker(p);
+
+  for (int k = 0; k < 5; ++k) tracker.update({cv::Point3f(0.f, 0.f, 3.f)}, 0.1f);
+  ASSERT_EQ(tracker.size(), 1);
+  const auto first_id = tracker.tracks()[0].id;
+
+  for (int k = 0; k < 3; ++k) tracker.update({}, 0.1f);
+  EXPECT_EQ(tracker.size(), 0);
+
+  // Pool capacity caps spawning; new tracks get fresh ids.
+  tracker.update({cv::Point3f(0.f, 0.f, 3.f), cv::Point3f(1.f, 0.f, 3.f),
+                  cv::Point3f(2.f, 0.f, 3.f)}, 0.1f);
+  EXPECT_EQ(tracker.size(), 2);
+  EXPECT_GT(tracker.tracks()[0].id, first_id);
+}
+
+TEST(GroundTracker, SkipsNonFiniteDetections) {
+  GroundTracker tracker;
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const float inf = std::numeric_limits<float>::infinity();
+  for (int k = 0; k < 5; ++k) {
+    // projectToGround() returns NaN for points on the horizon.
+    tracker.update({cv::Point3f(nan, nan, nan), cv::Point3f(0.f, 0.f, 3.f),
+                    cv::Point3f(inf, 0.f, -inf), cv::Point3f(1e30f, 0.f, 2.f)}, 0.1f);
+  }
+  // The huge finite point is tracked too; only the non-finite ones are dropped.
+  ASSERT_EQ(tracker.size(), 2);
+  for (const auto& t : tracker.tracks()) {
+    EXPECT_TRUE(std::isfinite(t.position.x) && std::isfinite(t.position.y));
+    EXPECT_EQ(t.hits, 5);
+  }
+}
+
+// FrameLogWriter / FrameLogReader
+
+TEST(FrameLog, RoundTripsRecordsThroughMmap) {
+  const std::string path = TempPath("frame_log_roundtrip.bin");
+  std::filesystem::remove(path);
+  const LogProjection proj{800.f, 800.f, 640.f, 360.f, 1.2f};
+
+  {
+    FrameLogWriter writer(path, proj);
+    for (int k = 0; k < 3; ++k) {
+      FrameRecord rec;
+      rec.frame_id = 100 + k;
+      rec.timestamp_ns = 33'000'000LL * k;
+      rec.roi = cv::Rect(10, 20, 30, 40);
+      rec.features.assign(k + 1, cv::Point2f(1.5f * k, 2.5f));
+      rec.has_chosen = (k != 1);
+      rec.chosen = cv::Point2f(640.f + 120.f, 360.f + 400.f);
+      writer.append(rec);
+    }
+  }
+
+  FrameLogReader reader(path);
+  ASSERT_EQ(reader.size(), 3u);
+  EXPECT_FLOAT_EQ(reader.recorded().camera_height_m, 1.2f);
+  const FrameView v = reader.at(2);
+  EXPECT_EQ(v.frame_id, 102u);
+  EXPECT_EQ(v.timestamp_ns, 66'000'000LL);
+  EXPECT_EQ(v.roi, cv::Rect(10, 20, 30, 40));
+  ASSERT_EQ(v.num_features, 3u);
+  EXPECT_FLOAT_EQ(v.features[2].x, 3.0f);
+
+  // Re-run projection with a doubled camera height: depth must double.
+  LogProjection taller = proj;
+  taller.camera_height_m = 2.4f;
+  std::vector<ReprojectedPoint> out;
+  reader.reprojectChosen(taller, out);
+  ASSERT_EQ(out.size(), 3u);
+  EXPECT_TRUE(out[0].valid);
+  EXPECT_FALSE(out[1].valid);
+  EXPECT_NEAR(out[0].ground.z, 4.8f, 1e-5f);
+  EXPECT_NEAR(out[0].ground.x, 0.72f, 1e-5f);
+  std::filesystem::remove(path);
+}
+
+TEST(FrameLog, IgnoresTornTailRecord) {
+  const std::string path = TempPath("frame_log_torn.bin");
+  std::filesystem::remove(path);
+  {
+    FrameLogWriter writer(path, LogProjection{});
+    FrameRecord rec;
+    rec.features.resize(4);
+    writer.append(rec);
+    writer.append(rec);
+  }
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 5);
+
+  FrameLogReader reader(path);
+  EXPECT_EQ(reader.size(), 1u);
+  std::filesystem::remove(path);
+}
+
+TEST(FrameLog, AppendAfterTornTailKeepsEveryRecord) {
+  const std::string path = TempPath("frame_log_reopen.bin");
+  auto record = [](std::int64_t id) {
+    FrameRecord rec;
+    rec.frame_id = id;
+    rec.features.assign(4, cv::Point2f(static_cast<float>(id), 0.5f));
+    return rec;
+  };
+  // Cut 5 bytes: the last record's header survives but not its features.
+  // Cut 60: its header itself is torn.
+  for (const std::uintmax_t cut : {5u, 60u}) {
+    std::filesystem::remove(path);
+    {
+      FrameLogWriter writer(path, LogProjection{});
+      for (int k = 0; k < 3; ++k) writer.append(record(k));
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - cut);
+    {
+      FrameLogWriter writer(path, LogProjection{});  // drops the torn record 2
+      writer.append(record(10));
+      writer.append(record(11));
+    }
+
+    FrameLogReader reader(path);
+    ASSERT_EQ(reader.size(), 4u) << "cut " << cut;
+    const std::int64_t ids[] = {0, 1, 10, 11};
+    for (std::size_t i = 0; i < reader.size(); ++i) {
+      const FrameView v = reader.at(i);
+      EXPECT_EQ(v.frame_id, ids[i]);
+      ASSERT_EQ(v.num_features, 4u);
+      for (std::size_t f = 0; f < v.num_features; ++f) {
+        EXPECT_EQ(v.features[f], cv::Point2f(static_cast<float>(ids[i]), 0.5f));
+      }
+    }
+  }
+  std::filesystem::remove(path);
+}
+
+TEST(FrameLog, RefusesToAppendWithDifferentProjection) {
+  const std::string path = TempPath("frame_log_append.bin");
+  std::filesystem::remove(path);
+  const LogProjection proj{800.f, 800.f, 640.f, 360.f, 1.2f};
+  {
+    FrameLogWriter writer(path, proj);
+    writer.append(FrameRecord{});
+  }
+  {
+    FrameLogWriter writer(path, proj);  // same projection: extends the log
+    writer.append(FrameRecord{});
+  }
+  LogProjection moved = proj;
+  moved.camera_height_m = 1.5f;
+  EXPECT_THROW({ FrameLogWriter w(path, moved); }, std::runtime_error);
+
+  FrameLogReader reader(path);
+  EXPECT_EQ(reader.size(), 2u);
+  std::filesystem::remove(path);
+}
+
+TEST(FrameLog, ReportsFailedWrites) {
+  if (!std::filesystem::exists("/dev/full")) GTEST_SKIP() << "no /dev/full";
+  FrameLogWriter writer("/dev/full", LogProjection{});
+  FrameRecord rec;
+  rec.features.resize(16);
+  writer.append(rec);  // still buffered
+  EXPECT_THROW(writer.flush(), std::runtime_error);
+}
+
+TEST(config_test, loads_file_with_env_and_cli_overrides) {
+  const std::string path = TempPath("config_test.cfg");
+  {
+    std::ofstream ofs(path);
+    ofs << "# detector config\n"
+        << "intrinsics_path = media/test_cal.csv\n"
+        << "camera_height_m = 1.2\n"
+        << "D_max_m = 6\n"
+        << "D_close_m = 1.5\n";
+  }
+  setenv("HD_D_MAX_M", "7.5", 1);
+  ConfigClass cfg = ConfigClass::load(path, {"--D_close_m=0.75", "--model_path", "m.onnx"});
+  unsetenv("HD_D_MAX_M");
+
+  EXPECT_EQ("media/test_cal.csv", cfg.intrinsicsPath);
+  EXPECT_EQ("m.onnx", cfg.modelPath);
+  EXPECT_DOUBLE_EQ(1.2, cfg.cameraHeight_m);
+  EXPECT_DOUBLE_EQ(7.5, cfg.D_max_m);
+  EXPECT_DOUBLE_EQ(0.75, cfg.D_close_m);
+  EXPECT_FLOAT_EQ(0.75f, cfg.zoneThresholds().D_close_m);
+  EXPECT_FLOAT_EQ(7.5f, cfg.zoneThresholds().D_max_m);
+  std::filesystem::remove(path);
+}
+
+TEST(config_test, watcher_publishes_new_snapshot_on_change) {
+  const std::string path = TempPath("config_watch.cfg");
+  // Reloads must set every key.
+  auto complete = [](const std::string& height) {
+    return "intrinsics_path = cal.csv\nextrinsics_path = ext.csv\nmodel_path = m.onnx\n"
+           "D_max_m = 5.5\nD_close_m = 1\ncamera_height_m = " + height + "\n";
+  };
+  auto rewrite = [&](const std::string& text, int bump_s) {
+    { std::ofstream(path) << text; }
+    std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) +
+                                           std::chrono::seconds(bump_s));
+  };
+  { std::ofstream(path) << complete("1.0"); }
+
+  ConfigWatcher watcher(path);
+  auto before = watcher.current();
+  EXPECT_DOUBLE_EQ(1.0, before->cameraHeight_m);
+  EXPECT_FALSE(watcher.poll());
+
+  rewrite(complete("2.0"), 1);
+  EXPECT_TRUE(watcher.poll());
+  EXPECT_DOUBLE_EQ(2.0, watcher.current()->cameraHeight_m);
+  EXPECT_GT(watcher.version(), before.version());
+  // A pinned snapshot stays intact after a reload.
+  EXPECT_DOUBLE_EQ(1.0, before->cameraHeight_m);
+
+  std::streambuf* origCerr = std::cerr.rdbuf();
+  std::stringstream swallowed;
+  std::cerr.rdbuf(swallowed.rdbuf());
+  // Invalid, cut after a full line, cut mid-number: the previous snapshot stays current.
+  rewrite(complete("tall"), 2);
+  EXPECT_FALSE(watcher.poll());
+  rewrite("intrinsics_path = cal.csv\ncamera_height_m = 3.0\n", 3);
+  EXPECT_FALSE(watcher.poll());
+  const std::string full = complete("3.25");
+  rewrite(full.substr(0, full.size() - 3), 4);  // "... = 3.2"
+  EXPECT_FALSE(watcher.poll());
+  const std::size_t reported = swallowed.str().size();
+  EXPECT_FALSE(watcher.poll());  // same bad file: not parsed or reported again
+  EXPECT_EQ(swallowed.str().size(), reported);
+  std::cerr.rdbuf(origCerr);
+  EXPECT_DOUBLE_EQ(2.0, watcher.current()->cameraHeight_m);
+
+  // The writer finishes within the same mtime tick: the reload still happens.
+  const auto torn_time = std::filesystem::last_write_time(path);
+  { std::ofstream(path) << full; }
+  std::filesystem::last_write_time(path, torn_time);
+  EXPECT_TRUE(watcher.poll());
+  EXPECT_DOUBLE_EQ(3.25, watcher.current()->cameraHeight_m);
+  std::filesystem::remove(path);
+}
+
+TEST(config_test, from_args_tolerates_empty_argv) {
+  char* argv[] = {nullptr};
+  const ConfigClass cfg = ConfigClass::fromArgs(0, argv);
+  EXPECT_DOUBLE_EQ(ConfigClass::defaults().D_max_m, cfg.D_max_m);
+}
+
+TEST(SnapshotCell, ReadersNeverSeeTornSnapshots) {
+  SnapshotCell<std::vector<int>> cell(std::vector<int>(64, 0));
+  std::atomic<bool> done{false};
+  std::atomic<int> torn{0};
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 3; ++r) {
+    readers.emplace_back([&] {
+      while (!done) {
+        auto snap = cell.acquire();
+        const int first = (*snap)[0];
+        for (int v : *snap) if (v != first) ++torn;
+      }
+    });
+  }
+  for (int k = 1; k <= 20000; ++k) {
+    while (!cell.publishWith([k](std::vector<int>& v) { std::fill(v.begin(), v.end(), k); })) {
+      std::this_thread::yield();
+    }
+  }
+  done = true;
+  for (auto& t : readers) t.join();
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_EQ((*cell.acquire())[0], 20000);
+}
+
+// Intrinsics value type
+
+TEST(Intrinsics, IsOneTriviallyCopyableCacheLine) {
+  EXPECT_TRUE(std::is_trivially_copyable<Intrinsics>::value);
+  EXPECT_EQ(sizeof(Intrinsics), 64u);
+  EXPECT_EQ(alignof(Intrinsics), 64u);
+
+  const Intrinsics in = Intrinsics::fromPinhole(800.f, 800.f, 640.f, 360.f);
+  EXPECT_FLOAT_EQ(in.inv_fx, 1.0f / 800.f);
+  cv::Point3f Xw;
+  ASSERT_TRUE(projectToGround(in, 1.2f, cv::Point2f(760.f, 760.f), &Xw));
+  EXPECT_NEAR(Xw.z, 2.4f, 1e-5f);
+  EXPECT_NEAR(Xw.x, 0.36f, 1e-5f);
+  EXPECT_FALSE(projectToGround(in, 1.2f, cv::Point2f(640.f, 360.f), &Xw));
+}
+
+TEST(camera_model_test, keeps_intrinsics_in_sync_with_mats) {
+  const std::string path = TempPath("sync_intrinsics.csv");
+  {
+    std::ofstream ofs(path);
+    ofs << "800,0,640,\n0,810,360,\n0,0,1,\n-0.1,0.01,0.0005,-0.0003,-0.001\n";
+  }
+  CameraModel cm(path);
+  EXPECT_FLOAT_EQ(cm.intrinsics.fx, 800.f);
+  EXPECT_FLOAT_EQ(cm.intrinsics.fy, 810.f);
+  EXPECT_FLOAT_EQ(cm.intrinsics.cy, 360.f);
+  EXPECT_FLOAT_EQ(cm.intrinsics.k1, -0.1f);
+  EXPECT_FLOAT_EQ(cm.intrinsics.p1, 0.0005f);
+  EXPECT_FLOAT_EQ(cm.intrinsics.k3, -0.001f);
+
+  cv::Mat K = (cv::Mat_<double>(3,3) << 400, 0, 320, 0, 400, 240, 0, 0, 1);
+  cm.setIntrinsics(K, cv::Mat::zeros(1, 5, CV_64F));
+  EXPECT_FLOAT_EQ(cm.intrinsics.fx, 400.f);
+  EXPECT_FLOAT_EQ(cm.intrinsics.cx, 320.f);
+  EXPECT_FLOAT_EQ(cm.intrinsics.k1, 0.f);
+  EXPECT_EQ(cm.K_mat.type(), CV_32F);
+  std::filesystem::remove(path);
+}
+
+// FrameSource class
+
+static std::string WriteCountingVideo(int frames) {
+  // Each frame is a flat gray level equal to 8 * its index, so tests can tell frames apart.
+  const std::string path = TempPath("frame_source.avi");
+  cv::VideoWriter writer(path, cv::VideoWriter::fourcc('M','J','P','G'), 30.0, cv::Size(64, 48));
+  if (!writer.isOpened()) throw std::runtime_error("VideoWriter failed: " + path);
+  for (int i = 0; i < frames; ++i) {
+    writer.write(cv::Mat(48, 64, CV_8UC3, cv::Scalar::all(8 * i)));
+  }
+  return path;
+}
+
+TEST(FrameSource, DecodesAheadInOrderWithStride) {
+  const auto path = WriteCountingVideo(20);
+  FrameSource::Params p;
+  p.ring_size = 3;
+  p.stride = 3;
+  FrameSource src(path, p);
+  ASSERT_TRUE(src.open());
+  EXPECT_EQ(src.frameCount(), 20);
+  EXPECT_EQ(src.frameSize(), cv::Size(64, 48));
+
+  std::vector<std::int64_t> seen;
+  FrameSource::Frame f;
+  while (src.acquire(f)) {
+    seen.push_back(f.index);
+    EXPECT_NEAR(cv::mean(*f.image)[0], 8.0 * f.index, 3.0);
+    src.release(f);
+  }
+  EXPECT_EQ(seen, (std::vector<std::int64_t>{0, 3, 6, 9, 12, 15, 18}));
+  std::filesystem::remove(path);
+}
+
+TEST(FrameSource, SeeksToRandomFrame) {
+  const auto path = WriteCountingVideo(20);
+  FrameSource src(path);
+  ASSERT_TRUE(src.open());
+  ASSERT_EQ(src.index().size(), 20u);
+  EXPECT_TRUE(src.index()[0].keyframe);
+  EXPECT_LE(src.keyframeAtOrBefore(13), 13);
+
+  ASSERT_TRUE(src.seek(13));
+  src.setEndFrame(15);
+  FrameSource::Frame f;
+  ASSERT_TRUE(src.acquire(f));
+  EXPECT_EQ(f.index, 13);
+  EXPECT_NEAR(cv::mean(*f.image)[0], 8.0 * 13, 3.0);
+  src.release(f);
+  ASSERT_TRUE(src.acquire(f));
+  EXPECT_EQ(f.index, 14);
+  src.release(f);
+  EXPECT_FALSE(src.acquire(f));
+  EXPECT_FALSE(src.seek(20));
+  std::filesystem::remove(path);
+}
+
+TEST(FrameSource, StrideChangeAppliesFromNextSeek) {
+  const auto path = WriteCountingVideo(20);
+  FrameSource src(path);
+  ASSERT_TRUE(src.open());
+
+  FrameSource::Frame f;
+  ASSERT_TRUE(src.acquire(f));
+  EXPECT_EQ(f.index, 0);
+  src.release(f);
+  src.setStride(5);  // the running decoder keeps stride 1
+  ASSERT_TRUE(src.acquire(f));
+  EXPECT_EQ(f.index, 1);
+  src.release(f);
+
+  ASSERT_TRUE(src.seek(2));
+  std::vector<std::int64_t> seen;
+  while (src.acquire(f)) {
+    seen.push_back(f.index);
+    EXPECT_NEAR(cv::mean(*f.image)[0], 8.0 * f.index, 3.0);
+    src.release(f);
+  }
+  EXPECT_EQ(seen, (std::vector<std::int64_t>{2, 7, 12, 17}));
+  std::filesystem::remove(path);
+}
+
+TEST(FrameSource, SeeksWithAdoptedIndex) {
+  const auto path = WriteCountingVideo(30);
+  FrameSource indexer(path);
+  ASSERT_TRUE(indexer.open());
+  ASSERT_EQ(indexer.index().size(), 30u);
+
+  FrameSource::Params p;
+  p.build_index = false;
+  FrameSource src(path, p);
+  ASSERT_TRUE(src.open());
+  EXPECT_TRUE(src.index().empty());
+  src.setIndex(indexer.index(), indexer.keyframesKnown());
+  EXPECT_EQ(src.frameCount(), 30);
+  EXPECT_EQ(src.keyframes(), indexer.keyframes());
+
+  ASSERT_TRUE(src.seek(20));
+  FrameSource::Frame f;
+  ASSERT_TRUE(src.acquire(f));
+  EXPECT_EQ(f.index, 20);
+  EXPECT_DOUBLE_EQ(f.timestamp_ms, indexer.index()[20].timestamp_ms);
+  EXPECT_NEAR(cv::mean(*f.image)[0], 160.0, 3.0);
+  src.release(f);
+  std::filesystem::remove(path);
+}
+
+// TiledCornerDetector class
+
+static cv::Mat TwoTextureImage() {
+  // Left half: strong 8px checkerboard. Right half: faint 16px checkerboard.
+  cv::Mat gray(240, 320, CV_8UC1, cv::Scalar(100));
+  for (int y = 0; y < gray.rows; ++y) {
+    for (int x = 0; x < gray.cols; ++x) {
+      if (x < 160) {
+        gray.at<uchar>(y, x) = ((x / 8 + y / 8) % 2) ? 255 : 0;
+      } else {
+        gray.at<uchar>(y, x) = ((x / 16 + y / 16) % 2) ? 115 : 100;
+      }
+    }
+  }
+  return gray;
+}
+
+TEST(TiledCornerDetector, CoversWeakTextureThatGlobalThresholdStarves) {
+  const cv::Mat gray = TwoTextureImage();
+  auto right_half = [](const std::vector<cv::Point2f>& pts) {
+    return std::count_if(pts.begin(), pts.end(),
+                         [](const cv::Point2f& p) { return p.x >= 168.f; });
+  };
+
+  std::vector<cv::Point2f> global;
+  cv::goodFeaturesToTrack(gray, global, 256, 0.01, 8.0);
+  EXPECT_EQ(right_half(global), 0);
+
+  TiledCornerDetector::Params p;
+  p.corners_per_tile = 8;
+  p.min_distance = 8.0;
+  TiledCornerDetector det(p);
+  std::vector<cv::Point2f> tiled;
+  det.detect(gray, tiled);
+  EXPECT_GT(right_half(tiled), 8);
+}
+
+TEST(TiledCornerDetector, EnforcesMinDistanceAcrossTilesAndCap) {
+  const cv::Mat gray = TwoTextureImage();
+  TiledCornerDetector::Params p;
+  p.tiles_x = 5;
+  p.tiles_y = 3;
+  p.min_distance = 10.0;
+  p.max_corners = 40;
+  TiledCornerDetector det(p);
+  std::vector<cv::Point2f> pts;
+  det.detect(gray, cv::Rect(20, 20, 200, 150), pts);
+
+  ASSERT_FALSE(pts.empty());
+  EXPECT_LE(pts.size(), 40u);
+  for (size_t i = 0; i < pts.size(); ++i) {
+    EXPECT_TRUE(cv::Rect(20, 20, 200, 150).contains(cv::Point(pts[i])));
+    for (size_t j = i + 1; j < pts.size(); ++j) {
+      const float dx = pts[i].x - pts[j].x, dy = pts[i].y - pts[j].y;
+      EXPECT_GE(dx*dx + dy*dy, 100.f - 1e-3f);
+    }
+  }
+}
+
+// MultiRoiDetector class
+
+TEST(MultiRoiDetector, MergesOverlappingRois) {
+  const std::vector<cv::Rect> rois = {
+      {10, 10, 50, 50}, {40, 40, 50, 50},   // overlap → one cluster
+      {200, 10, 20, 20},                    // separate
+      {500, 500, 10, 10}};                  // outside the canvas
+  std::vector<cv::Rect> merged;
+  std::vector<int> owner;
+  MultiRoiDetector::mergeOverlapping(rois, cv::Rect(0, 0, 320, 240), merged, owner);
+
+  ASSERT_EQ(merged.size(), 2u);
+  EXPECT_EQ(owner[0], owner[1]);
+  EXPECT_NE(owner[0], owner[2]);
+  EXPECT_EQ(owner[3], -1);
+  EXPECT_EQ(merged[owner[0]], cv::Rect(10, 10, 80, 80));
+  EXPECT_EQ(merged[owner[2]], cv::Rect(200, 10, 20, 20));
+}
+
+TEST(MultiRoiDetector, DetectsPerRoiFromSharedResponse) {
+  const cv::Mat gray = TwoTextureImage();
+  const std::vector<cv::Rect> rois = {{8, 8, 64, 64}, {40, 40, 64, 64}, {180, 100, 96, 96}};
+  MultiRoiDetector det;
+  std::vector<std::vector<cv::Point2f>> out;
+  det.detect(gray, rois, out);
+
+  ASSERT_EQ(out.size(), 3u);
+  EXPECT_EQ(det.clusters().size(), 2u);
+  for (size_t i = 0; i < rois.size(); ++i) {
+    std::vector<cv::Point2f> reference;
+    cv::goodFeaturesToTrack(gray(rois[i]), reference, 200, 0.01, 8.0);
+    EXPECT_FALSE(out[i].empty());
+    EXPECT_NEAR(static_cast<double>(out[i].size()), static_cast<double>(reference.size()),
+                0.2 * reference.size() + 2);
+    for (const auto& p : out[i]) EXPECT_TRUE(rois[i].contains(cv::Point(p)));
+  }
+}
+
+TEST(Intrinsics, BatchedProjectionMatchesSingle) {
+  const Intrinsics in = Intrinsics::fromPinhole(800.f, 800.f, 640.f, 360.f);
+  const std::vector<cv::Point2f> uv = {{760.f, 760.f}, {640.f, 360.f}, {100.f, 500.f}};
+  std::vector<cv::Point3f> out(uv.size());
+  projectToGround(in, 1.2f, uv.data(), uv.size(), out.data());
+
+  cv::Point3f single;
+  ASSERT_TRUE(projectToGround(in, 1.2f, uv[0], &single));
+  EXPECT_FLOAT_EQ(out[0].z, single.z);
+  EXPECT_FLOAT_EQ(out[0].x, single.x);
+  EXPECT_TRUE(std::isnan(out[1].z));
+  ASSERT_TRUE(projectToGround(in, 1.2f, uv[2], &single));
+  EXPECT_FLOAT_EQ(out[2].x, single.x);
+}
+
+TEST(Intrinsics, ScaledIntrinsicsPreserveGroundProjection) {
+  const Intrinsics native = Intrinsics::fromPinhole(1200.f, 1180.f, 959.5f, 539.5f);
+  for (float s : {0.5f, 0.25f}) {
+    const Intrinsics proc = native.scaled(s);
+    EXPECT_FLOAT_EQ(proc.fx, 1200.f * s);
+    EXPECT_FLOAT_EQ(proc.inv_fy, 1.0f / (1180.f * s));
+
+    // The same scene point seen in native and in downscaled pixels.
+    const cv::Point2f uv_native(1500.f, 900.f);
+    const cv::Point2f uv_proc((uv_native.x + 0.5f) * s - 0.5f, (uv_native.y + 0.5f) * s - 0.5f);
+    cv::Point3f a, b;
+    ASSERT_TRUE(projectToGround(native, 1.2f, uv_native, &a));
+    ASSERT_TRUE(projectToGround(proc, 1.2f, uv_proc, &b));
+    EXPECT_NEAR(a.x, b.x, 1e-4f);
+    EXPECT_NEAR(a.z, b.z, 1e-4f);
+  }
+}
+
+TEST(camera_model_test, processing_scale_rescales_intrinsics_and_frames) {
+  const std::string path = TempPath("scale_intrinsics.csv");
+  {
+    std::ofstream ofs(path);
+    ofs << "800,0,639.5,\n0,800,359.5,\n0,0,1,\n-0.1,0.01,0,0,0\n";
+  }
+  CameraModel cm(path);
+  cm.setProcessingScale(0.25);
+  EXPECT_DOUBLE_EQ(cm.processingScale(), 0.25);
+  EXPECT_FLOAT_EQ(cm.processing_intrinsics.fx, 200.f);
+  EXPECT_FLOAT_EQ(cm.processing_intrinsics.cx, 159.5f);
+  EXPECT_FLOAT_EQ(cm.intrinsics.fx, 800.f);
+
+  cv::Mat native(720, 1280, CV_8UC3, cv::Scalar(10, 20, 30)), proc;
+  cm.toProcessing(native, proc);
+  EXPECT_EQ(proc.size(), cv::Size(320, 180));
+  const cv::Mat undistorted = cm.undistort(proc);
+  EXPECT_EQ(undistorted.size(), proc.size());
+
+  const cv::Point2f p(100.f, 50.f);
+  const cv::Point2f back = cm.toProcessing(cm.toNative(p));
+  EXPECT_NEAR(back.x, p.x, 1e-4f);
+  EXPECT_NEAR(back.y, p.y, 1e-4f);
+  std::filesystem::remove(path);
+}
+
+TEST(camera_model_test, processing_intrinsics_follow_rounded_frame_size) {
+  const std::string path = TempPath("rounded_intrinsics.csv");
+  {
+    std::ofstream ofs(path);
+    ofs << "800,0,640,\n0,800,360,\n0,0,1,\n-0.1,0.01,0,0,0\n";
+  }
+  CameraModel cm(path);
+  std::filesystem::remove(path);
+  cm.setProcessingScale(0.25);
+  cm.setNativeSize(cv::Size(1281, 721));  // resizes to 320x180, not exactly 1/4
+  ASSERT_EQ(cm.processingSize(cm.nativeSize()), cv::Size(320, 180));
+  EXPECT_FLOAT_EQ(cm.processing_intrinsics.fx, 800.f * 320.f / 1281.f);
+  EXPECT_FLOAT_EQ(cm.processing_intrinsics.fy, 800.f * 180.f / 721.f);
+  EXPECT_FLOAT_EQ(cm.processing_intrinsics.cx, 640.5f * 320.f / 1281.f - 0.5f);
+
+  // Intrinsics are picked by image size: a native frame keeps the native K.
+  EXPECT_FLOAT_EQ(cm.intrinsicsFor(cv::Size(1281, 721)).fx, 800.f);
+  EXPECT_FLOAT_EQ(cm.intrinsicsFor(cv::Size(320, 180)).fx, cm.processing_intrinsics.fx);
+
+  // Native and processing undistortion agree on where a pixel ends up.
+  cv::Mat native(721, 1281, CV_8UC1, cv::Scalar(0)), proc;
+  cv::circle(native, cv::Point(1100, 620), 6, cv::Scalar(255), cv::FILLED);
+  cm.toProcessing(native, proc);
+  auto centroid = [](const cv::Mat& m) {
+    const cv::Moments mo = cv::moments(m);
+    return cv::Point2f(static_cast<float>(mo.m10 / mo.m00), static_cast<float>(mo.m01 / mo.m00));
+  };
+  const cv::Mat und_native = cm.undistort(native), und_proc = cm.undistort(proc);
+  ASSERT_GT(cv::countNonZero(und_native), 0);
+  const cv::Point2f a = centroid(und_native);
+  const cv::Point2f b = cm.toNative(centroid(und_proc));
+  EXPECT_NEAR(a.x, b.x, 1.5f);
+  EXPECT_NEAR(a.y, b.y, 1.5f);
+}
+
+// ---------------- GroundPublisher ----------------
+TEST(GroundPublisher, SubscriberReadsLatestAndInOrder) {
+  const std::string name = "/hd_ground_test_" + std::to_string(::getpid());
+  GroundPublisher pub(name, 4);
+  GroundSubscriber sub(name);
+
+  GroundSample s;
+  EXPECT_FALSE(sub.latest(s));
+  EXPECT_FALSE(sub.next(s));
+
+  pub.publish(10, 1000, {{0.5f, 0.0f, 0.6f}}, ground_shm::ZoneState::CLOSE);
+  pub.publish(11, 2000, {{1.0f, 0.0f, 3.0f}, {2.0f, 0.0f, 4.0f}}, ground_shm::ZoneState::WATCH);
+
+  ASSERT_TRUE(sub.latest(s));
+  EXPECT_EQ(s.sequence, 1u);
+  EXPECT_EQ(s.frame_id, 11u);
+  EXPECT_EQ(s.timestamp_ns, 2000);
+  EXPECT_EQ(s.zone, ground_shm::ZoneState::WATCH);
+  ASSERT_EQ(s.num_points, 2u);
+  EXPECT_FLOAT_EQ(s.points[1].x, 2.0f);
+  EXPECT_FLOAT_EQ(s.points[1].z, 4.0f);
+
+  ASSERT_TRUE(sub.next(s));
+  EXPECT_EQ(s.frame_id, 10u);
+  ASSERT_TRUE(sub.next(s));
+  EXPECT_EQ(s.frame_id, 11u);
+  EXPECT_FALSE(sub.next(s));
+
+  // Fall more than a ring behind: the oldest records are reported as dropped.
+  for (std::uint64_t f = 12; f < 18; ++f) pub.publish(f, 0, {}, ground_shm::ZoneState::CLEAR);
+  ASSERT_TRUE(sub.next(s));
+  EXPECT_EQ(s.frame_id, 14u);
+  EXPECT_EQ(sub.dropped(), 2u);
+  EXPECT_EQ(sub.published(), 8u);
+}
+
+TEST(GroundPublisher, ClassifiesZonesAndSurvivesConcurrentReads) {
+  const std::vector<cv::Point3f> far{{0.0f, 0.0f, 9.0f}};
+  const std::vector<cv::Point3f> mid{{3.0f, 0.0f, 4.0f}, {0.0f, 0.0f, 9.0f}};
+  const std::vector<cv::Point3f> near{{NAN, NAN, NAN}, {0.3f, 0.0f, 0.4f}};
+  const ZoneThresholds zone;  // CLOSE within 1 m, WATCH within 5 m
+  EXPECT_EQ(ground_shm::classify(far.data(), far.size(), zone), ground_shm::ZoneState::CLEAR);
+  EXPECT_EQ(ground_shm::classify(mid.data(), mid.size(), zone), ground_shm::ZoneState::WATCH);
+  EXPECT_EQ(ground_shm::classify(near.data(), near.size(), zone), ground_shm::ZoneState::CLOSE);
+
+  // Every record carries points (f, f) for frame f; a torn read would mix frames.
+  const std::string name = "/hd_ground_race_" + std::to_string(::getpid());
+  GroundPublisher pub(name, 8);
+  GroundSubscriber sub(name);
+  std::thread writer([&] {
+    std::vector<cv::Point3f> pts(ground_shm::kMaxPoints);
+    for (std::uint64_t f = 1; f <= 20000; ++f) {
+      for (auto& p : pts) p = {static_cast<float>(f), 0.0f, static_cast<float>(f)};
+      pub.publish(f, static_cast<std::int64_t>(f), pts, ground_shm::ZoneState::CLEAR);
+    }
+  });
+  // Record failures and stop reading; assert only after the writer is joined.
+  GroundSample s;
+  std::uint64_t last = 0;
+  bool out_of_order = false, torn = false;
+  while (last < 20000 && !out_of_order && !torn) {
+    if (!sub.latest(s)) continue;
+    out_of_order = s.frame_id < last;
+    last = s.frame_id;
+    torn = s.num_points != static_cast<std::uint32_t>(ground_shm::kMaxPoints);
+    for (std::uint32_t k = 0; k < s.num_points && !torn; ++k) {
+      torn = s.points[k].x != static_cast<float>(s.frame_id) ||
+             s.points[k].z != static_cast<float>(s.frame_id);
+    }
+  }
+  writer.join();
+  EXPECT_FALSE(out_of_order) << "frame " << s.frame_id << " after " << last;
+  EXPECT_FALSE(torn) << "torn record for frame " << s.frame_id;
+}
+
+TEST(GroundPublisher, SubscriberResyncsWhenPublisherRestarts) {
+  const std::string name = "/hd_ground_restart_" + std::to_string(::getpid());
+  GroundSample s;
+  auto first = std::make_unique<GroundPublisher>(name, 4, /*unlink_on_close=*/false);
+  GroundSubscriber sub(name);
+  for (std::uint64_t f = 1; f <= 3; ++f) first->publish(f, 0, {}, ground_shm::ZoneState::CLEAR);
+  ASSERT_TRUE(sub.next(s));
+  EXPECT_EQ(s.frame_id, 1u);
+  first.reset();
+
+  // A restarted publisher with a larger ring: the segment grows, never shrinks,
+  // and the subscriber follows the new sequence instead of waiting for head to
+  // pass its old cursor.
+  GroundPublisher second(name, 16);
+  second.publish(100, 0, {{0.5f, 0.0f, 0.5f}}, ground_shm::ZoneState::CLOSE);
+  ASSERT_TRUE(sub.next(s));
+  EXPECT_EQ(s.frame_id, 100u);
+  EXPECT_EQ(s.sequence, 0u);
+  EXPECT_FALSE(sub.next(s));
+  for (std::uint64_t f = 101; f < 110; ++f) second.publish(f, 0, {}, ground_shm::ZoneState::CLEAR);
+  ASSERT_TRUE(sub.latest(s));
+  EXPECT_EQ(s.frame_id, 109u);
+  EXPECT_EQ(sub.dropped(), 0u);
+
+  // A smaller ring on the same (larger) segment keeps working as well.
+  GroundPublisher third(name, 2);
+  third.publish(200, 0, {}, ground_shm::ZoneState::CLEAR);
+  ASSERT_TRUE(sub.next(s));
+  EXPECT_EQ(s.frame_id, 200u);
+}
+
+// ---------------- HumanDetector snapshots ----------------
+TEST(HumanDetectorSnapshot, PublishesStateAfterEachUpdate) {
+  const auto csv = WriteTempIntrinsicsCSV(800.f, 800.f, 160.f, 120.f);
+  HumanDetector hd("unused", csv);
+  const std::uint64_t v0 = hd.snapshotVersion();
+  {
+    auto snap = hd.snapshot();
+    EXPECT_EQ(snap->mode, HumanDetector::Mode::DRAW_BOX);
+    EXPECT_TRUE(snap->features.empty());
+    EXPECT_FALSE(snap->has_chosen);
+  }
+
+  cv::Mat bgr;
+  cv::cvtColor(TwoTextureImage(), bgr, cv::COLOR_GRAY2BGR);
+  hd.setFrame(bgr);
+  hd.detectFeaturesFullFrame();
+  EXPECT_GT(hd.snapshotVersion(), v0);
+
+  auto pinned = hd.snapshot();
+  EXPECT_EQ(pinned->frame_id, hd.frameId());
+  EXPECT_EQ(pinned->mode, HumanDetector::Mode::PICK_FEATURE);
+  EXPECT_EQ(pinned->box, cv::Rect(0, 0, bgr.cols, bgr.rows));
+  EXPECT_EQ(pinned->features.size(), hd.features().size());
+  ASSERT_FALSE(pinned->features.empty());
+
+  // A pinned snapshot is immutable: later updates publish new versions.
+  const size_t n = pinned->features.size();
+  hd.reset();
+  EXPECT_EQ(pinned->features.size(), n);
+  EXPECT_EQ(pinned->mode, HumanDetector::Mode::PICK_FEATURE);
+  auto now = hd.snapshot();
+  EXPECT_GT(now.version(), pinned.version());
+  EXPECT_TRUE(now->features.empty());
+  EXPECT_EQ(now->mode, HumanDetector::Mode::DRAW_BOX);
+}
+
+TEST(HumanDetectorSnapshot, ConcurrentReadersSeeConsistentState) {
+  const auto csv = WriteTempIntrinsicsCSV(800.f, 800.f, 160.f, 120.f);
+  HumanDetector hd("unused", csv);
+  cv::Mat bgr;
+  cv::cvtColor(TwoTextureImage(), bgr, cv::COLOR_GRAY2BGR);
+  hd.setFrame(bgr);
+
+  // Invariant of every published state: features exist only in PICK_FEATURE,
+  // and then they all lie inside the box.
+  std::atomic<bool> done{false};
+  std::atomic<int> inconsistent{0};
+  std::thread reader([&] {
+    while (!done) {
+      auto s = hd.snapshot();
+      if (s->mode == HumanDetector::Mode::DRAW_BOX && !s->features.empty()) ++inconsistent;
+      for (const auto& p : s->features) {
+        if (!s->box.contains(cv::Point(static_cast<int>(p.x), static_cast<int>(p.y)))) {
+          ++inconsistent;
+        }
+      }
+    }
+  });
+  for (int k = 0; k < 50; ++k) {
+    hd.detectFeaturesFullFrame();
+    hd.reset();
+  }
+  done = true;
+  reader.join();
+  EXPECT_EQ(inconsistent.load(), 0);
+}
+
+// ---------------- OccupancyGrid ----------------
+TEST(OccupancyGrid, SplatCommitAndConstantTimeQueries) {
+  OccupancyGrid::Params p;
+  p.cell_size_m = 0.1f;
+  p.range_m = 5.0f;
+  p.half_width_m = 2.0f;
+  OccupancyGrid grid(p);
+  EXPECT_EQ(grid.rows(), 50);
+  EXPECT_EQ(grid.cols(), 40);
+
+  grid.commit();
+  EXPECT_TRUE(std::isinf(grid.nearestOccupiedRange()));
+  EXPECT_FALSE(grid.isOccupiedWithin(5.0f));
+
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const std::vector<cv::Point3f> pts{
+      {0.32f, 0.0f, 2.41f},   // cell (24, 23), centre (0.35, 2.45)
+      {-1.0f, 0.0f, 4.0f},
+      {0.0f, 0.0f, 7.0f},     // beyond range
+      {3.0f, 0.0f, 1.0f},     // beyond half width
+      {nan, nan, nan}};
+  grid.splat(pts);
+  grid.commit();
+
+  EXPECT_EQ(grid.occupiedCount(), 2);
+  EXPECT_FLOAT_EQ(grid.at(24, 23), 1.0f);
+  EXPECT_NEAR(grid.nearestOccupiedRange(), std::hypot(0.35f, 2.45f), 1e-5f);
+  EXPECT_FALSE(grid.isOccupiedWithin(1.0f));
+  EXPECT_TRUE(grid.isOccupiedWithin(2.5f));
+
+  EXPECT_TRUE(grid.isOccupied(cv::Rect2f(0.0f, 2.0f, 1.0f, 1.0f)));
+  EXPECT_FALSE(grid.isOccupied(cv::Rect2f(-0.5f, 0.0f, 1.0f, 2.0f)));
+  EXPECT_EQ(grid.occupiedCells(cv::Rect2f(-2.0f, 0.0f, 4.0f, 5.0f)), 2);
+  EXPECT_EQ(grid.occupiedCells(cv::Rect2f(-1.05f, 3.95f, 0.1f, 0.1f)), 1);
+}
+
+TEST(OccupancyGrid, DecayForgetsAndSplatPixelsMatchesProjection) {
+  OccupancyGrid::Params p;
+  p.cell_size_m = 0.1f;
+  p.range_m = 5.0f;
+  p.decay = 0.5f;
+  p.occupied_threshold = 0.3f;
+  OccupancyGrid grid(p);
+
+  const Intrinsics in = Intrinsics::fromPinhole(800.f, 800.f, 640.f, 360.f);
+  const std::vector<cv::Point2f> uv{{760.f, 760.f}, {640.f, 360.f}};  // second is singular
+  grid.splatPixels(in, 1.2f, uv.data(), uv.size());
+  grid.commit();
+  ASSERT_EQ(grid.occupiedCount(), 1);
+  EXPECT_NEAR(grid.nearestOccupiedRange(), std::hypot(0.35f, 2.45f), 1e-5f);
+
+  grid.decay();   // 0.5: still occupied
+  grid.commit();
+  EXPECT_EQ(grid.occupiedCount(), 1);
+  grid.decay();   // 0.25: below threshold
+  grid.commit();
+  EXPECT_EQ(grid.occupiedCount(), 0);
+  EXPECT_FALSE(grid.isOccupiedWithin(5.0f));
+
+  for (int k = 0; k < 10; ++k) grid.splat({{0.0f, 0.0f, 1.0f}});
+  EXPECT_FLOAT_EQ(grid.at(10, 50), p.saturation);
+
+  grid.clear();
+  grid.commit();
+  EXPECT_EQ(grid.occupiedCount(), 0);
+}
+
+TEST(OccupancyGrid, DumpsForVisualization) {
+  OccupancyGrid::Params p;
+  p.cell_size_m = 0.5f;
+  p.range_m = 2.0f;
+  OccupancyGrid grid(p);
+  grid.splat({{0.1f, 0.0f, 0.1f}});
+  cv::Mat m;
+  grid.toMat(m);
+  ASSERT_EQ(m.rows, grid.rows());
+  ASSERT_EQ(m.cols, grid.cols());
+  EXPECT_EQ(m.type(), CV_32F);
+  EXPECT_FLOAT_EQ(m.at<float>(0, 4), 1.0f);
+  EXPECT_FLOAT_EQ(cv::sum(m)[0], 1.0f);
+}
+
+// ---------------- FrameArena / alloc_stats ----------------
+TEST(FrameArena, GrowsToHighWaterThenStopsOverflowing) {
+  FrameArena arena(256);
+  {
+    std::pmr::vector<cv::Point3f> pts(&arena);
+    pts.reserve(100);  // 1200 bytes: does not fit
+    EXPECT_EQ(arena.overflows(), 1u);
+  }
+  arena.reset();
+  EXPECT_GE(arena.capacity(), 1200u);
+
+  for (int frame = 0; frame < 3; ++frame) {
+    std::pmr::vector<cv::Point3f> pts(&arena);
+    pts.reserve(100);
+    auto* p = static_cast<unsigned char*>(arena.allocate(16, 64));
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p) % 64, 0u);
+    arena.reset();
+  }
+  EXPECT_EQ(arena.overflows(), 1u);
+  EXPECT_EQ(arena.used(), 0u);
+}
+
+TEST(AllocStats, SteadyStateFrameLoopDoesNotAllocate) {
+  if (!alloc_stats::enabled()) GTEST_SKIP() << "allocation hooks not linked";
+
+  {
+    alloc_stats::Scope probe;
+    auto* v = new std::vector<int>(10);
+    delete v;
+    EXPECT_EQ(probe.delta().allocations, 2u);
+    EXPECT_EQ(probe.delta().deallocations, 2u);
+    EXPECT_GE(probe.delta().bytes, sizeof(std::vector<int>) + 10 * sizeof(int));
+  }
+
+  const Intrinsics in = Intrinsics::fromPinhole(800.f, 800.f, 640.f, 360.f);
+  GroundTracker tracker;
+  OccupancyGrid grid;
+  FrameArena arena;
+  std::vector<cv::Point2f> uv(32);
+  std::vector<cv::Point3f> ground;
+  ground.reserve(uv.size());
+
+  auto frame = [&](int k) {
+    arena.reset();
+    for (size_t i = 0; i < uv.size(); ++i) {
+      uv[i] = {600.f + 10.f * static_cast<float>(i % 8) + 0.5f * k,
+               500.f + 40.f * static_cast<float>(i / 8)};
+    }
+    ground.resize(uv.size());
+    projectToGround(in, 1.2f, uv.data(), uv.size(), ground.data());
+
+    std::pmr::vector<cv::Point3f> near(&arena);
+    near.reserve(ground.size());
+    for (const auto& g : ground) if (g.z < 5.0f) near.push_back(g);
+
+    tracker.update(ground, 1.0f / 30.0f);
+    grid.decay();
+    grid.splat(near.data(), near.size());
+    grid.commit();
+    return grid.isOccupiedWithin(2.0f);
+  };
+
+  for (int k = 0; k < 5; ++k) frame(k);  // warm-up: buffers reach their size
+
+  alloc_stats::Scope steady;
+  for (int k = 5; k < 100; ++k) frame(k);
+  EXPECT_EQ(steady.delta().allocations, 0u);
+  EXPECT_EQ(steady.delta().bytes, 0u);
+  EXPECT_GT(tracker.size(), 0);
+}
+
+TEST(AllocStats, ProcessTotalsIncludeOtherThreads) {
+  if (!alloc_stats::enabled()) GTEST_SKIP() << "allocation hooks not linked";
+
+  std::atomic<bool> go{false};
+  std::thread worker([&] {
+    while (!go.load()) std::this_thread::yield();
+    delete new std::vector<int>(64);
+  });
+  alloc_stats::Scope mine;
+  alloc_stats::Scope all(alloc_stats::Scope::Threads::All);
+  go = true;
+  worker.join();
+  EXPECT_EQ(mine.delta().allocations, 0u);
+  EXPECT_GE(all.delta().allocations, 2u);
+  EXPECT_GE(all.delta().bytes, 64 * sizeof(int));
+}
+
+TEST(AllocStats, HeadlessHumanDetectorLoopDoesNotAllocate) {
+  if (!alloc_stats::enabled()) GTEST_SKIP() << "allocation hooks not linked";
+
+  // Distortion makes undistort() go through the remap tables.
+  const std::string csv = TempPath("alloc_loop.csv");
+  {
+    std::ofstream ofs(csv);
+    ofs << "300,0,160,\n0,300,120,\n0,0,1,\n-0.1,0.01,0,0,0\n";
+  }
+  HumanDetector::Params p;
+  p.show_window = false;
+  HumanDetector hd("unused", csv, p);
+  std::filesystem::remove(csv);
+
+  // Two different textured frames, alternated so every frame does real work.
+  cv::Mat frames[2];
+  for (int i = 0; i < 2; ++i) {
+    frames[i] = cv::Mat(240, 320, CV_8UC3, cv::Scalar(90, 90, 90));
+    cv::RNG rng(7 + i);
+    for (int r = 0; r < 30; ++r) {
+      const cv::Point a(rng.uniform(0, 300), rng.uniform(0, 220));
+      cv::rectangle(frames[i], a, a + cv::Point(rng.uniform(5, 40), rng.uniform(5, 40)),
+                    cv::Scalar::all(rng.uniform(0, 255)), cv::FILLED);
+    }
+  }
+  cv::Mat undistorted;
+  // Two overlapping ROIs (one shared response map) and a separate one.
+  const std::vector<cv::Rect> rois{{20, 20, 100, 80}, {90, 60, 100, 80}, {200, 120, 100, 100}};
+  std::size_t found = 0;
+  auto frame = [&](int k) {
+    hd.setFrame(frames[k % 2]);
+    hd.undistort(frames[k % 2], undistorted);
+    found = 0;
+    for (const auto& r : hd.detectInRois(rois)) found += r.features.size();
+  };
+
+  // Warm-up: remap tables, response maps, feature lists and every snapshot
+  // slot reach their steady size.
+  for (int k = 0; k < 8; ++k) frame(k);
+
+  alloc_stats::Scope all(alloc_stats::Scope::Threads::All);
+  for (int k = 8; k < 40; ++k) {
+    frame(k);
+    // Reported at setFrame(): covers the whole previous frame.
+    EXPECT_EQ(hd.lastFrameAllocations().allocations, 0u) << "frame " << k - 1;
+  }
+  EXPECT_EQ(all.delta().allocations, 0u);
+  EXPECT_GT(found, 0u);
+}
+
+// ---------------- Distortion models ----------------
+static Intrinsics DistortedIntrinsics() {
+  Intrinsics in = Intrinsics::fromPinhole(800.f, 790.f, 640.f, 360.f);
+  in.k1 = -0.28f; in.k2 = 0.09f; in.k3 = -0.01f;
+  in.p1 = 0.0012f; in.p2 = -0.0008f;
+  in.k4 = 0.05f; in.k5 = -0.02f; in.k6 = 0.004f;
+  return in;
+}
+
+TEST(DistortionModel, DetectsSimplestModelAndDropsUnusedTerms) {
+  Intrinsics in = Intrinsics::fromPinhole(800.f, 800.f, 640.f, 360.f);
+  EXPECT_EQ(distortion::detectKind(in), DistortionKind::None);
+  in.k1 = -0.2f;
+  EXPECT_EQ(distortion::detectKind(in), DistortionKind::Radial);
+  in.p2 = 1e-3f;
+  EXPECT_EQ(distortion::detectKind(in), DistortionKind::BrownConrady);
+  in.k6 = 1e-3f;
+  EXPECT_EQ(distortion::detectKind(in), DistortionKind::Rational);
+
+  // A model ignores the coefficients it does not have.
+  const Intrinsics full = DistortedIntrinsics();
+  Intrinsics radial_only = Intrinsics::fromPinhole(800.f, 790.f, 640.f, 360.f);
+  radial_only.k1 = full.k1; radial_only.k2 = full.k2; radial_only.k3 = full.k3;
+  const cv::Point2f uv(1100.f, 650.f);
+  const cv::Point2f a = distortion::distortPoint<distortion::RadialOnly>(full, uv);
+  const cv::Point2f b = distortion::distortPoint<distortion::Rational>(radial_only, uv);
+  EXPECT_NEAR(a.x, b.x, 1e-3f);
+  EXPECT_NEAR(a.y, b.y, 1e-3f);
+  const cv::Point2f id = distortion::distortPoint<distortion::NoDistortion>(full, uv);
+  EXPECT_FLOAT_EQ(id.x, uv.x);
+  EXPECT_FLOAT_EQ(id.y, uv.y);
+}
+
+TEST(DistortionModel, UndistortInvertsDistortForEveryModel) {
+  const Intrinsics in = DistortedIntrinsics();
+  const std::vector<cv::Point2f> ideal{{640.f, 360.f}, {900.f, 500.f}, {300.f, 150.f}, {1000.f, 100.f}};
+  auto roundTrip = [&](auto model, DistortionKind kind) {
+    using M = decltype(model);
+    std::vector<cv::Point2f> distorted(ideal.size()), back(ideal.size());
+    for (size_t i = 0; i < ideal.size(); ++i) distorted[i] = distortion::distortPoint<M>(in, ideal[i]);
+    distortion::undistortPoints(kind, in, distorted.data(), distorted.size(), back.data());
+    for (size_t i = 0; i < ideal.size(); ++i) {
+      EXPECT_NEAR(back[i].x, ideal[i].x, 0.05f) << static_cast<int>(kind) << " #" << i;
+      EXPECT_NEAR(back[i].y, ideal[i].y, 0.05f) << static_cast<int>(kind) << " #" << i;
+    }
+  };
+  roundTrip(distortion::NoDistortion{}, DistortionKind::None);
+  roundTrip(distortion::RadialOnly{}, DistortionKind::Radial);
+  roundTrip(distortion::BrownConrady{}, DistortionKind::BrownConrady);
+  roundTrip(distortion::Rational{}, DistortionKind::Rational);
+}
+
+TEST(DistortionModel, MapPointsIntoTheDistortedImage) {
+  const Intrinsics in = DistortedIntrinsics();
+  const Intrinsics dst = Intrinsics::fromPinhole(700.f, 700.f, 630.f, 350.f);
+  const int w = 64, h = 8;
+  const int first = 300, last = 308;  // a band of rows, as one parallel chunk sees it
+  std::vector<float> mx(static_cast<size_t>(last) * w), my(mx.size());
+  distortion::buildUndistortMap<distortion::BrownConrady>(in, dst, w, first, last,
+                                                          mx.data(), my.data(), w);
+  for (int v = first; v < last; v += 3) {
+    for (int u = 0; u < w; u += 21) {
+      // Pixel (u,v) of the new camera is the ray through the normalized point x,y.
+      const float x = (u - dst.cx) / dst.fx, y = (v - dst.cy) / dst.fy;
+      const cv::Point2f expect = distortion::distortPoint<distortion::BrownConrady>(
+          in, {in.fx * x + in.cx, in.fy * y + in.cy});
+      EXPECT_NEAR(mx[static_cast<size_t>(v) * w + u], expect.x, 1e-3f);
+      EXPECT_NEAR(my[static_cast<size_t>(v) * w + u], expect.y, 1e-3f);
+    }
+  }
+
+  std::vector<float> ix(static_cast<size_t>(h) * w), iy(ix.size());
+  distortion::buildUndistortMap<distortion::NoDistortion>(dst, dst, w, 0, h, ix.data(), iy.data(), w);
+  EXPECT_NEAR(ix[5 * w + 17], 17.f, 1e-3f);
+  EXPECT_NEAR(iy[5 * w + 17], 5.f, 1e-3f);
+}
+
+TEST(DistortionModel, CsvSelectsModelAtLoad) {
+  const auto rational = TempPath("intrinsics_rational.csv");
+  {
+    std::ofstream ofs(rational);
+    ofs << "800,0,640,\n0,800,360,\n0,0,1,\n"
+        << "-0.28,0.09,0.0012,-0.0008,-0.01,0.05,-0.02,0.004\n";
+  }
+  CameraModel cm(rational.string());
+  EXPECT_EQ(cm.D_mat.cols, 8);
+  EXPECT_EQ(cm.distortion_kind, DistortionKind::Rational);
+  EXPECT_FLOAT_EQ(cm.intrinsics.k6, 0.004f);
+
+  const auto rectified = TempPath("intrinsics_rectified.csv");
+  {
+    std::ofstream ofs(rectified);
+    ofs << "800,0,640,\n0,800,360,\n0,0,1,\n0,0,0,0,0\n";
+  }
+  CameraModel flat(rectified.string());
+  EXPECT_EQ(flat.D_mat.cols, 5);
+  EXPECT_EQ(flat.distortion_kind, DistortionKind::None);
+
+  const cv::Mat img(48, 64, CV_8UC3, cv::Scalar(1, 2, 3));
+  cv::Mat out;
+  flat.undistort(img, out);
+  EXPECT_EQ(cv::norm(img, out, cv::NORM_INF), 0.0);
+  std::filesystem::remove(rational);
+  std::filesystem::remove(rectified);
+}
+
+// ---------------- MotionGate ----------------
+TEST(MotionGate, FlagsOnlyBlocksThatChanged) {
+  MotionGate::Params p;
+  p.block_size = 16;
+  p.diff_threshold = 10.0;
+  MotionGate gate(p);
+
+  cv::Mat empty_floor(240, 320, CV_8UC3, cv::Scalar(90, 90, 90));
+  EXPECT_TRUE(gate.update(empty_floor));  // first frame: everything is new
+  EXPECT_EQ(gate.changedMask().size(), cv::Size(20, 15));
+  EXPECT_FALSE(gate.update(empty_floor));
+  EXPECT_EQ(gate.changedBlocks(), 0);
+  EXPECT_TRUE(gate.changedRegions().empty());
+
+  // Small sensor noise stays below the threshold.
+  cv::Mat noisy = empty_floor + cv::Scalar(3, 3, 3);
+  EXPECT_FALSE(gate.update(noisy));
+
+  // A bright object appears: one region covering it, aligned to blocks.
+  cv::Mat object = empty_floor.clone();
+  cv::rectangle(object, cv::Rect(100, 60, 40, 50), cv::Scalar(250, 250, 250), cv::FILLED);
+  EXPECT_TRUE(gate.update(object));
+  ASSERT_EQ(gate.changedRegions().size(), 1u);
+  const cv::Rect r = gate.changedRegions()[0];
+  EXPECT_EQ(r & cv::Rect(100, 60, 40, 50), cv::Rect(100, 60, 40, 50));
+  EXPECT_EQ(r.x % 16, 0);
+  EXPECT_LE(r.area(), 4 * 5 * 16 * 16);
+
+  // An object that stays put is absorbed into the background.
+  for (int k = 0; k < 200 && gate.update(object); ++k) {}
+  EXPECT_FALSE(gate.changed());
+
+  gate.reset();
+  EXPECT_TRUE(gate.update(object));
+}
+
+TEST(MotionGate, ReportsExactTilesWhenSizeIsNotABlockMultiple) {
+  MotionGate::Params p;
+  p.block_size = 16;
+  p.diff_threshold = 10.0;
+  // 100x70: the last block column is 4 px wide and the last block row 6 px tall.
+  const cv::Mat floor(70, 100, CV_8UC3, cv::Scalar(90, 90, 90));
+  struct Case { cv::Rect patch, region; };
+  const Case cases[] = {
+      {cv::Rect(88, 56, 8, 8), cv::Rect(80, 48, 16, 16)},  // inner tile next to the partial ones
+      {cv::Rect(97, 65, 3, 5), cv::Rect(96, 64, 4, 6)},    // partial corner tile
+  };
+  for (const Case& c : cases) {
+    MotionGate gate(p);
+    gate.update(floor);
+    EXPECT_EQ(gate.changedMask().size(), cv::Size(7, 5));
+    cv::Mat moved = floor.clone();
+    moved(c.patch).setTo(cv::Scalar(250, 250, 250));
+    EXPECT_TRUE(gate.update(moved));
+    ASSERT_EQ(gate.changedRegions().size(), 1u) << c.patch;
+    EXPECT_EQ(gate.changedRegions()[0], c.region) << c.patch;
+  }
+}
+
+TEST(MotionGate, DetectorSkipsStaticFramesAndReusesRoiResults) {
+  const auto csv = WriteTempIntrinsicsCSV(800.f, 800.f, 160.f, 120.f);
+  HumanDetector::Params p;
+  p.motion_gating = true;
+  p.motion_refresh_frames = 0;
+  HumanDetector hd("unused", csv, p);
+
+  cv::Mat bgr;
+  cv::cvtColor(TwoTextureImage(), bgr, cv::COLOR_GRAY2BGR);
+  const std::vector<cv::Rect> rois{{10, 10, 100, 100}, {200, 100, 100, 100}};
+
+  hd.setFrame(bgr);
+  EXPECT_TRUE(hd.frameChanged());
+  const auto first = hd.detectInRois(rois);
+  ASSERT_FALSE(first[0].features.empty());
+
+  hd.setFrame(bgr);
+  EXPECT_FALSE(hd.frameChanged());
+  EXPECT_EQ(hd.frameId(), 2u);
+  const auto& again = hd.detectInRois(rois);
+  EXPECT_EQ(again[0].features, first[0].features);
+  EXPECT_EQ(again[1].features, first[1].features);
+
+  // Blank out the left ROI only: it is re-detected, the right one is reused.
+  cv::Mat moved = bgr.clone();
+  moved(cv::Rect(0, 0, 150, 150)).setTo(cv::Scalar(100, 100, 100));
+  hd.setFrame(moved);
+  EXPECT_TRUE(hd.frameChanged());
+  const auto& after = hd.detectInRois(rois);
+  EXPECT_TRUE(after[0].features.empty());
+  EXPECT_EQ(after[1].features, first[1].features);
+}
+
+// ---------------- PeopleDetector ----------------
+TEST(PeopleDetector, BandsCoverEveryFeasiblePersonAndLittleElse) {
+  const Intrinsics in = Intrinsics::fromPinhole(500.f, 500.f, 320.f, 200.f);
+  const float h = 1.2f;
+  const cv::Size size(640, 480);
+  PeopleDetector::Params p;
+  std::vector<PeopleDetector::Band> bands;
+  PeopleDetector::planBands(in, h, size, p, bands);
+  ASSERT_FALSE(bands.empty());
+
+  const double half = std::sqrt(p.scale_step);
+  for (int v = 201; v < size.height; v += 7) {
+    for (float H = p.person_height_min_m; H <= p.person_height_max_m; H += 0.1f) {
+      const double px = H * (v - in.cy) / h;
+      if (px < p.min_person_px * half || 128.0 * px / 96.0 > size.height) continue;
+      const bool covered = std::any_of(bands.begin(), bands.end(), [&](const PeopleDetector::Band& b) {
+        const double bp = PeopleDetector::kPersonPx * b.scale;
+        const int top = v - static_cast<int>(std::lround((PeopleDetector::kTopPad + PeopleDetector::kPersonPx) * b.scale));
+        return v >= b.foot_min && v <= b.foot_max && px >= bp / half && px < bp * half &&
+               b.region.y <= std::max(0, top) && b.region.y + b.region.height >= v;
+      });
+      EXPECT_TRUE(covered) << "foot row " << v << ", height " << H;
+    }
+  }
+
+  // Nothing is searched above the horizon, and far less than a full pyramid
+  // over the same scales.
+  double constrained = 0.0, pyramid = 0.0;
+  for (const auto& b : bands) {
+    EXPECT_GT(b.foot_min, in.cy);
+    constrained += b.region.area() / (b.scale * b.scale);
+    pyramid += size.area() / (b.scale * b.scale);
+  }
+  EXPECT_LT(constrained, 0.5 * pyramid);
+
+  // Camera below the floor / no image: nothing to search.
+  PeopleDetector::planBands(in, 0.0f, size, p, bands);
+  EXPECT_TRUE(bands.empty());
+}
+
+TEST(PeopleDetector, SuppressKeepsStrongestOfOverlappingBoxes) {
+  std::vector<PeopleDetector::Detection> d(4);
+  d[0].box = {100, 100, 64, 128}; d[0].score = 0.5;
+  d[1].box = {104, 102, 64, 128}; d[1].score = 1.5;  // overlaps d[0]
+  d[2].box = {300, 100, 64, 128}; d[2].score = 0.8;  // separate
+  d[3].box = {110, 110, 80, 160}; d[3].score = 0.2;  // overlaps d[1]
+  PeopleDetector::suppress(d, 0.4);
+  ASSERT_EQ(d.size(), 2u);
+  EXPECT_DOUBLE_EQ(d[0].score, 1.5);
+  EXPECT_DOUBLE_EQ(d[1].score, 0.8);
+}
+
+TEST(PeopleDetector, EmptySceneYieldsNoPeople) {
+  PeopleDetector det;
+  const Intrinsics in = Intrinsics::fromPinhole(500.f, 500.f, 320.f, 200.f);
+  det.setGeometry(in, 1.2f, cv::Size(640, 480));
+  ASSERT_FALSE(det.bands().empty());
+  const cv::Mat floor_only(480, 640, CV_8UC1, cv::Scalar(120));
+  std::vector<PeopleDetector::Detection> out(3);
+  det.detect(floor_only, out);
+  EXPECT_TRUE(out.empty());
+}
+
+TEST(PeopleDetector, OutrunsUnconstrainedDetectMultiScale) {
+  // 720p, camera 1.2 m up: default detectMultiScale (every row, 1.05 ladder)
+  // against the banded search with default Params. Measured 7.8x on one core.
+  const Intrinsics in = Intrinsics::fromPinhole(900.f, 900.f, 640.f, 360.f);
+  cv::Mat gray(720, 1280, CV_8UC1);
+  cv::randu(gray, 0, 256);
+  cv::GaussianBlur(gray, gray, cv::Size(), 2.0);
+
+  PeopleDetector det;
+  det.setGeometry(in, 1.2f, gray.size());
+  cv::HOGDescriptor hog;
+  hog.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
+
+  auto bestOf3 = [](const std::function<void()>& run) {
+    double best = std::numeric_limits<double>::max();
+    for (int k = 0; k < 3; ++k) {
+      const auto t0 = std::chrono::steady_clock::now();
+      run();
+      best = std::min(best, std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - t0).count());
+    }
+    return best;
+  };
+  std::vector<PeopleDetector::Detection> found;
+  std::vector<cv::Rect> full;
+  const double banded_ms = bestOf3([&] { det.detect(gray, found); });
+  const double full_ms = bestOf3([&] { hog.detectMultiScale(gray, full); });
+  EXPECT_GT(full_ms / banded_ms, 5.0) << "banded " << banded_ms << " ms, full " << full_ms << " ms";
+}
+
+// A dark figure @p height_px tall, feet centred on @p foot (proportions of a
+// 96 px person).
+static void DrawPerson(cv::Mat& img, cv::Point foot, int height_px) {
+  const double s = height_px / 96.0;
+  const int top = foot.y - height_px;
+  auto P = [&](double x, double y) {
+    return cv::Point(static_cast<int>(std::lround(foot.x + x * s)), static_cast<int>(std::lround(top + y * s)));
+  };
+  const cv::Scalar ink(40);
+  cv::ellipse(img, P(0, 8), cv::Size(static_cast<int>(std::lround(6.5 * s)), static_cast<int>(std::lround(8 * s))),
+              0, 0, 360, ink, cv::FILLED);
+  cv::rectangle(img, P(-2.5, 14), P(2.5, 18), ink, cv::FILLED);
+  const std::vector<cv::Point> torso{P(-11, 18), P(11, 18), P(9, 52), P(-9, 52)};
+  cv::fillConvexPoly(img, torso, ink);
+  for (int side : {-1, 1}) {
+    const std::vector<cv::Point> arm{P(side * 11, 19), P(side * 15, 24), P(side * 14, 54),
+                                     P(side * 10.5, 54), P(side * 10, 26)};
+    const std::vector<cv::Point> leg{P(side * 1, 50), P(side * 9.5, 50), P(side * 11.5, 96), P(side * 5, 96)};
+    cv::fillConvexPoly(img, arm, ink);
+    cv::fillConvexPoly(img, leg, ink);
+  }
+}
+
+TEST(PeopleDetector, FindsRenderedPersonAtItsGroundPosition) {
+  // Camera 1 m up, looking level. A 1.6 m person 5 m ahead has feet on row
+  // cy + fy * h / Z = 180 and is 1.6 * (180 - cy) / h = 96 px tall: one HOG
+  // window at scale 1, on the stride grid of the scale-1 band (rows 52..206).
+  const Intrinsics in = Intrinsics::fromPinhole(300.f, 300.f, 160.f, 120.f);
+  const float h = 1.0f;
+  const cv::Point foot(160, 180);
+
+  // The detector's own descriptor of the figure stands in for the trained
+  // people SVM, so this pins the geometry (bands, window placement, foot row,
+  // back-projection, height) independently of the pretrained model.
+  cv::Mat window(PeopleDetector::kWinHeight, PeopleDetector::kWinWidth, CV_8UC1, cv::Scalar(170));
+  DrawPerson(window, {PeopleDetector::kWinWidth / 2, PeopleDetector::kTopPad + PeopleDetector::kPersonPx},
+             PeopleDetector::kPersonPx);
+  PeopleDetector::Params p;
+  PeopleDetector::computeDescriptor(window, p.svm_detector);
+  double energy = 0.0;
+  for (float w : p.svm_detector) energy += static_cast<double>(w) * w;
+  ASSERT_GT(energy, 0.0);
+  p.svm_detector.push_back(static_cast<float>(-0.5 * energy));  // bias: background scores < 0
+  p.min_person_px = PeopleDetector::kPersonPx;                   // a band at exactly scale 1
+
+  PeopleDetector det(p);
+  det.setGeometry(in, h, cv::Size(320, 240));
+  cv::Mat scene(240, 320, CV_8UC1, cv::Scalar(170));
+  DrawPerson(scene, foot, PeopleDetector::kPersonPx);
+  std::vector<PeopleDetector::Detection> out;
+  det.detect(scene, out);
+
+  ASSERT_FALSE(out.empty());
+  const PeopleDetector::Detection& d = out[0];
+  EXPECT_EQ(d.box, cv::Rect(foot.x - PeopleDetector::kWinWidth / 2,
+                            foot.y - PeopleDetector::kTopPad - PeopleDetector::kPersonPx,
+                            PeopleDetector::kWinWidth, PeopleDetector::kWinHeight));
+  EXPECT_FLOAT_EQ(d.foot.x, 160.f);
+  EXPECT_FLOAT_EQ(d.foot.y, 180.f);
+  EXPECT_NEAR(d.ground.z, 5.0f, 1e-4f);
+  EXPECT_NEAR(d.ground.x, 0.0f, 1e-4f);
+  EXPECT_NEAR(d.height_m, 1.6f, 1e-4f);
+  EXPECT_GT(d.score, 0.0);
+}
+
+TEST(AnnotatedRecorder, DrawOverlayMarksChosenPointAndPeople) {
+  cv::Mat img(120, 160, CV_8UC3, cv::Scalar(0, 0, 0));
+  Overlay ov;
+  ov.people.push_back(cv::Rect(10, 10, 40, 80));
+  ov.has_chosen = true;
+  ov.chosen = cv::Point2f(120.f, 60.f);
+  drawOverlay(img, ov);
+
+  EXPECT_EQ(img.at<cv::Vec3b>(10, 30), cv::Vec3b(255, 0, 255));  // people box edge
+  EXPECT_GT(img.at<cv::Vec3b>(60, 126)[2], 100);                 // red ring, radius 6
+  EXPECT_EQ(img.at<cv::Vec3b>(60, 120), cv::Vec3b(0, 0, 0));     // ring is hollow
+}
+
+TEST(AnnotatedRecorder, DropPolicyAccountsForEveryFrame) {
+  const std::string path = TempPath("recorder_test.avi");
+  cv::Mat frame(240, 320, CV_8UC3, cv::Scalar(40, 80, 120));
+  Overlay ov;
+  ov.features.assign(50, cv::Point2f(100.f, 100.f));
+
+  // A 1-frame queue fed as fast as possible: the caller never waits, and
+  // every submitted frame is either written or counted as dropped.
+  AnnotatedRecorder::Params p;
+  p.queue_size = 1;
+  p.policy = AnnotatedRecorder::DropPolicy::DropNewest;
+  AnnotatedRecorder fast(path, p);
+  int accepted = 0;
+  for (int i = 0; i < 100; ++i) accepted += fast.submit(frame, ov) ? 1 : 0;
+  fast.close();
+  ASSERT_TRUE(fast.ok());
+  const auto s = fast.stats();
+  EXPECT_EQ(s.submitted, 100u);
+  EXPECT_EQ(s.written + s.dropped, 100u);
+  EXPECT_EQ(s.written, static_cast<std::uint64_t>(accepted));
+  EXPECT_FALSE(fast.submit(frame, ov));  // closed
+
+  // Block never drops.
+  p.policy = AnnotatedRecorder::DropPolicy::Block;
+  AnnotatedRecorder lossless(path, p);
+  for (int i = 0; i < 20; ++i) EXPECT_TRUE(lossless.submit(frame, ov));
+  lossless.close();
+  EXPECT_EQ(lossless.stats().written, 20u);
+  EXPECT_EQ(lossless.stats().dropped, 0u);
+
+  cv::VideoCapture cap(path);
+  ASSERT_TRUE(cap.isOpened());
+  cv::Mat back;
+  ASSERT_TRUE(cap.read(back));
+  EXPECT_EQ(back.size(), frame.size());
+  cap.release();
+
+  // DropOldest never refuses a frame: older queued frames make room, so the
+  // last submitted frame is always the last one written.
+  p.policy = AnnotatedRecorder::DropPolicy::DropOldest;
+  const Overlay none;
+  const cv::Mat older(240, 320, CV_8UC3, cv::Scalar(20, 20, 20));
+  const cv::Mat last(240, 320, CV_8UC3, cv::Scalar(200, 220, 240));
+  AnnotatedRecorder latest(path, p);
+  for (int i = 0; i < 99; ++i) EXPECT_TRUE(latest.submit(older, none));
+  EXPECT_TRUE(latest.submit(last, none));
+  latest.close();
+  ASSERT_TRUE(latest.ok());
+  const auto l = latest.stats();
+  EXPECT_EQ(l.submitted, 100u);
+  EXPECT_EQ(l.written + l.dropped, 100u);
+
+  cv::VideoCapture replay(path);
+  ASSERT_TRUE(replay.isOpened());
+  std::uint64_t frames = 0;
+  cv::Mat final_frame;
+  while (replay.read(back)) {
+    ++frames;
+    back.copyTo(final_frame);
+  }
+  EXPECT_EQ(frames, l.written);
+  ASSERT_FALSE(final_frame.empty());
+  const cv::Scalar m = cv::mean(final_frame);
+  EXPECT_NEAR(m[0], 200.0, 8.0);
+  EXPECT_NEAR(m[1], 220.0, 8.0);
+  EXPECT_NEAR(m[2], 240.0, 8.0);
+  std::filesystem::remove(path);
+}
+
+TEST(AnnotatedRecorder, HeadlessDetectorRecordsWithoutAWindow) {
+  const auto csv = WriteTempIntrinsicsCSV(300.f, 300.f, 160.f, 120.f);
+  HumanDetector::Params p;
+  p.show_window = false;
+  HumanDetector hd("never_created", csv, p);
+  EXPECT_NO_THROW(hd.bindWindow());  // no window to attach a mouse callback to
+
+  const std::string path = TempPath("headless_record.avi");
+  AnnotatedRecorder rec(path);
+  hd.attachRecorder(&rec);
+  hd.setFrame(cv::Mat(240, 320, CV_8UC3, cv::Scalar(30, 60, 90)));
+  EXPECT_TRUE(hd.display().empty());  // headless runs never render
+  EXPECT_TRUE(hd.recordFrame());
+  rec.close();
+  EXPECT_TRUE(rec.ok());
+  EXPECT_EQ(rec.stats().written, 1u);
+  std::filesystem::remove(path);
+}
+
+TEST(ProjectionServer, AnswersBatchesLikeProjectToGround) {
+  const std::string path = TempPath("projection_test.sock");
+  ProjectionServer server(path);
+  const Intrinsics in = Intrinsics::fromPinhole(500.f, 500.f, 320.f, 240.f);
+  server.addCamera(7, in, 1.2f);
+  server.start();
+
+  ProjectionClient client(path);
+  std::vector<cv::Point2f> uv{{320.f, 340.f}, {100.f, 480.f}, {600.f, 240.f}};
+  std::vector<cv::Point3f> got;
+  ASSERT_TRUE(client.project(7, uv, got));
+  ASSERT_EQ(got.size(), uv.size());
+  cv::Point3f want;
+  ASSERT_TRUE(projectToGround(in, 1.2f, uv[0], &want));
+  EXPECT_FLOAT_EQ(got[0].z, want.z);
+  EXPECT_FLOAT_EQ(got[0].x, want.x);
+  ASSERT_TRUE(projectToGround(in, 1.2f, uv[1], &want));
+  EXPECT_FLOAT_EQ(got[1].x, want.x);
+  EXPECT_TRUE(std::isnan(got[2].z));  // on the horizon
+
+  EXPECT_FALSE(client.project(99, uv, got));  // unknown camera, connection stays usable
+  EXPECT_TRUE(client.project(7, {}, got));
+  EXPECT_TRUE(got.empty());
+
+  const auto s = server.stats();
+  EXPECT_EQ(s.requests, 3u);
+  EXPECT_EQ(s.points, 3u);
+  EXPECT_GT(s.latency_max_us, 0.0);
+  EXPECT_GT(client.lastLatencyUs(), 0.0);
+}
+
+TEST(ProjectionServer, CoalescesConcurrentClients) {
+  const std::string path = TempPath("projection_coalesce.sock");
+  ProjectionServer server(path);
+  const Intrinsics in = Intrinsics::fromPinhole(400.f, 400.f, 160.f, 120.f);
+  server.addCamera(1, in, 0.5f);
+
+  // Clients connect and send before the server thread runs, so their first
+  // requests are all waiting in the same poll() cycle.
+  constexpr int kClients = 4, kRequests = 50;
+  std::vector<std::unique_ptr<ProjectionClient>> clients;
+  for (int c = 0; c < kClients; ++c) clients.push_back(std::make_unique<ProjectionClient>(path));
+
+  std::atomic<int> mismatches{0};
+  std::vector<std::thread> threads;
+  for (int c = 0; c < kClients; ++c) {
+    threads.emplace_back([&, c] {
+      std::vector<cv::Point2f> uv(100);
+      std::vector<cv::Point3f> got;
+      for (int r = 0; r < kRequests; ++r) {
+        for (std::size_t i = 0; i < uv.size(); ++i) {
+          uv[i] = {static_cast<float>(i * 3 + c), 130.f + r + c};
+        }
+        if (!clients[c]->project(1, uv, got)) { ++mismatches; continue; }
+        for (std::size_t i = 0; i < uv.size(); ++i) {
+          cv::Point3f want;
+          projectToGround(in, 0.5f, uv[i], &want);
+          if (got[i].x != want.x || got[i].z != want.z) ++mismatches;
+        }
+      }
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  server.start();
+  for (auto& t : threads) t.join();
+
+  EXPECT_EQ(mismatches.load(), 0);
+  const auto s = server.stats();
+  EXPECT_EQ(s.requests, static_cast<std::uint64_t>(kClients * kRequests));
+  EXPECT_LT(s.batches, s.requests);
+  EXPECT_GT(s.coalesced, 0u);
+  EXPECT_LE(s.latency_p50_us, s.latency_p99_us);
+}
+
+TEST(ShardedProcessor, PlansKeyframeAlignedSegments) {
+  std::vector<ShardedProcessor::Segment> segs;
+  const std::vector<std::int64_t> keyframes{0, 250, 500, 750, 1000, 1250, 1500, 1750};
+
+  ShardedProcessor::planSegments(keyframes, 2000, 4, 100, segs);
+  ASSERT_EQ(segs.size(), 4u);
+  EXPECT_EQ(segs.front().begin, 0);
+  EXPECT_EQ(segs.back().end, 2000);
+  for (std::size_t i = 0; i < segs.size(); ++i) {
+    EXPECT_TRUE(std::binary_search(keyframes.begin(), keyframes.end(), segs[i].begin));
+    if (i > 0) {
+      EXPECT_EQ(segs[i].begin, segs[i - 1].end);  // contiguous, no overlap
+    }
+  }
+
+  // Sparse keyframes limit the cuts; short files are not split at all.
+  ShardedProcessor::planSegments({0, 900}, 2000, 8, 100, segs);
+  ASSERT_EQ(segs.size(), 2u);
+  EXPECT_EQ(segs[1].begin, 900);
+  ShardedProcessor::planSegments(keyframes, 150, 8, 100, segs);
+  ASSERT_EQ(segs.size(), 1u);
+  EXPECT_EQ(segs[0].end, 150);
+
+  // Without keyframe information any frame may start a segment.
+  ShardedProcessor::planSegments({}, 1000, 4, 100, segs);
+  ASSERT_EQ(segs.size(), 4u);
+  EXPECT_EQ(segs[1].begin, 250);
+}
+
+TEST(ShardedProcessor, StitchesTrackIdsAcrossBoundary) {
+  auto track = [](std::uint32_t id, float x, float z) {
+    GroundTracker::Track t;
+    t.id = id;
+    t.position = {x, z};
+    return t;
+  };
+  const std::vector<GroundTracker::Track> prev{track(7, 0.f, 3.f), track(9, 1.f, 3.f), track(12, -2.f, 6.f)};
+  const std::vector<GroundTracker::Track> next{track(1, 1.02f, 3.01f), track(2, 0.01f, 2.98f), track(3, 4.f, 4.f)};
+
+  std::unordered_map<std::uint32_t, std::uint32_t> ids;
+  ShardedProcessor::stitchTracks(prev, next, 0.5f, ids);
+  ASSERT_EQ(ids.size(), 2u);
+  EXPECT_EQ(ids.at(1), 9u);
+  EXPECT_EQ(ids.at(2), 7u);
+  EXPECT_EQ(ids.count(3), 0u);  // new track: gets a fresh id when merged
+}
+
+static std::string WriteMovingSquareVideo() {
+  // 240 frames, every one a keyframe (MJPG): a bright square drifting right
+  // on the ground, below the horizon of the intrinsics the tests use.
+  const std::string path = TempPath("sharded_test.avi");
+  cv::VideoWriter w(path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 30.0, cv::Size(320, 240));
+  if (!w.isOpened()) throw std::runtime_error("VideoWriter failed: " + path);
+  cv::Mat f(240, 320, CV_8UC3);
+  for (int i = 0; i < 240; ++i) {
+    f.setTo(cv::Scalar(30, 30, 30));
+    cv::rectangle(f, cv::Rect(40 + i / 2, 120 + (i % 60) / 6, 60, 60), cv::Scalar(230, 230, 230), cv::FILLED);
+    w.write(f);
+  }
+  return path;
+}
+
+static ShardedProcessor::Params MovingSquareParams() {
+  ShardedProcessor::Params p;
+  p.min_segment_frames = 40;
+  p.warmup_frames = 20;
+  p.keep_features = true;
+  p.camera_height_m = 1.0f;
+  p.zone.D_close_m = 2.5f;
+  p.zone.D_max_m = 4.0f;
+  p.corners.quality_level = 0.3;
+  p.tracker.gate_m = 0.3f;
+  return p;
+}
+
+TEST(ShardedProcessor, MatchesSerialRunOnSyntheticVideo) {
+  const std::string path = WriteMovingSquareVideo();
+  const Intrinsics in = Intrinsics::fromPinhole(300.f, 300.f, 160.f, 60.f);
+  ShardedProcessor::Params p = MovingSquareParams();
+
+  p.shards = 1;
+  ShardedProcessor::Result serial;
+  ASSERT_TRUE(ShardedProcessor(in, p).run(path, serial));
+  p.shards = 4;
+  ShardedProcessor::Result sharded;
+  ASSERT_TRUE(ShardedProcessor(in, p).run(path, sharded));
+  std::filesystem::remove(path);
+
+  // Every frame is a keyframe, so the plan is the even split at 60, 120, 180.
+  ASSERT_EQ(sharded.segments.size(), 4u);
+  EXPECT_EQ(sharded.segments[1].segment.begin, 60);
+  EXPECT_EQ(sharded.segments[1].warmup, 20);
+
+  // Per-frame outputs depend only on the decoded frame, so each shard's seek
+  // must land exactly where the serial decode was.
+  ASSERT_EQ(sharded.frames.size(), serial.frames.size());
+  for (std::size_t i = 0; i < serial.frames.size(); ++i) {
+    EXPECT_EQ(sharded.frames[i].frame_index, static_cast<std::int64_t>(i));
+    EXPECT_DOUBLE_EQ(sharded.frames[i].timestamp_ms, serial.frames[i].timestamp_ms);
+    EXPECT_EQ(sharded.frames[i].features, serial.frames[i].features);
+    EXPECT_EQ(sharded.frames[i].zone, serial.frames[i].zone);
+  }
+  ASSERT_EQ(sharded.events.size(), serial.events.size());
+  for (std::size_t i = 0; i < serial.events.size(); ++i) {
+    EXPECT_EQ(sharded.events[i].frame_index, serial.events[i].frame_index);
+  }
+}
+
+TEST(ShardedProcessor, NoWarmupGivesFreshIdsAtEachBoundary) {
+  const std::string path = WriteMovingSquareVideo();
+  const Intrinsics in = Intrinsics::fromPinhole(300.f, 300.f, 160.f, 60.f);
+  ShardedProcessor::Params p = MovingSquareParams();
+  p.shards = 4;
+  p.warmup_frames = 0;
+  ShardedProcessor::Result r;
+  ASSERT_TRUE(ShardedProcessor(in, p).run(path, r));
+  std::filesystem::remove(path);
+
+  ASSERT_EQ(r.segments.size(), 4u);
+  std::set<std::uint32_t> before;
+  for (const auto& s : r.segments) {
+    EXPECT_EQ(s.warmup, 0);
+    const auto& first = r.frames[static_cast<std::size_t>(s.segment.begin)];
+    ASSERT_FALSE(first.tracks.empty());  // every square corner starts a track
+    for (const auto& t : first.tracks) EXPECT_EQ(before.count(t.id), 0u) << "id " << t.id;
+    for (std::int64_t i = s.segment.begin; i < s.segment.end; ++i) {
+      for (const auto& t : r.frames[static_cast<std::size_t>(i)].tracks) before.insert(t.id);
+    }
+  }
+}
+
+TEST(ShardedProcessor, StreamsTheSameFramesToASink) {
+  const std::string path = WriteMovingSquareVideo();
+  const Intrinsics in = Intrinsics::fromPinhole(300.f, 300.f, 160.f, 60.f);
+  ShardedProcessor::Params p = MovingSquareParams();
+  p.shards = 2;
+  p.max_segment_frames = 50;  // 5 segments on 2 threads
+  ShardedProcessor proc(in, p);
+
+  ShardedProcessor::Result stored;
+  ASSERT_TRUE(proc.run(path, stored));
+  ShardedProcessor::Result streamed;
+  std::vector<ShardedProcessor::FrameResult> got;
+  ASSERT_TRUE(proc.run(path, streamed, [&](const ShardedProcessor::FrameResult& fr) { got.push_back(fr); }));
+  std::filesystem::remove(path);
+
+  EXPECT_TRUE(streamed.frames.empty());
+  ASSERT_EQ(streamed.segments.size(), 5u);
+  ASSERT_EQ(got.size(), stored.frames.size());
+  for (std::size_t i = 0; i < got.size(); ++i) {
+    EXPECT_EQ(got[i].frame_index, static_cast<std::int64_t>(i));
+    EXPECT_EQ(got[i].features, stored.frames[i].features);
+    ASSERT_EQ(got[i].tracks.size(), stored.frames[i].tracks.size());
+    for (std::size_t t = 0; t < got[i].tracks.size(); ++t) {
+      EXPECT_EQ(got[i].tracks[t].id, stored.frames[i].tracks[t].id);
+    }
+  }
+  ASSERT_EQ(streamed.events.size(), stored.events.size());
+  for (std::size_t i = 0; i < stored.events.size(); ++i) {
+    EXPECT_EQ(streamed.events[i].frame_index, stored.events[i].frame_index);
+  }
+}
+
+TEST(ChessboardSynth, RendersDetectableBoardAtKnownCorners) {
+  Intrinsics truth = Intrinsics::fromPinhole(600.f, 600.f, 320.f, 240.f);
+  truth.k1 = -0.15f;
+  truth.k2 = 0.03f;
+  ChessboardSynth synth(truth);
+
+  for (int i = 0; i < 5; ++i) {
+    cv::Mat frame, gray;
+    std::vector<cv::Point2f> expected, found;
+    synth.render(i, frame, &expected);
+    ASSERT_EQ(frame.size(), cv::Size(640, 480));
+    ASSERT_EQ(expected.size(), 48u);
+
+    cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    ASSERT_TRUE(cv::findChessboardCorners(gray, cv::Size(6, 8), found));
+    cv::cornerSubPix(gray, found, cv::Size(5, 5), cv::Size(-1, -1),
+                     cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 30, 0.001));
+    // Detection may start from either end of the board; compare as sets.
+    for (const auto& e : expected) {
+      float best = std::numeric_limits<float>::max();
+      for (const auto& f : found) best = std::min(best, std::hypot(e.x - f.x, e.y - f.y));
+      EXPECT_LT(best, 0.5f);
+    }
+  }
+
+  // Poses are a function of the frame index alone.
+  ChessboardSynth again(truth);
+  EXPECT_EQ(again.pose(3).tvec, synth.pose(3).tvec);
+}
+
+TEST(ChessboardSynth, CalibrationRecoversSyntheticIntrinsics) {
+  Intrinsics truth = Intrinsics::fromPinhole(600.f, 600.f, 320.f, 240.f);
+  truth.k1 = -0.15f;
+  truth.k2 = 0.03f;
+  truth.p1 = 0.001f;
+  truth.p2 = -0.0005f;
+  const std::string path = TempPath("calibration_bench.avi");
+
+  const CalibrationReport r = benchmarkCalibration(truth, 90, path);
+  std::filesystem::remove(path);
+
+  ASSERT_TRUE(r.ok) << r;
+  EXPECT_EQ(r.frames_decoded, 90) << r;
+  EXPECT_GT(r.hitRate(), 0.8) << r;
+  EXPECT_LT(r.rms_px, 0.5) << r;
+  EXPECT_LT(r.fx_err_pct, 1.0) << r;
+  EXPECT_LT(r.fy_err_pct, 1.0) << r;
+  EXPECT_LT(r.cx_err_px, 3.0) << r;
+  EXPECT_LT(r.cy_err_px, 3.0) << r;
+  EXPECT_LT(r.distortion_err_px, 1.0) << r;
+}